@@ -67,6 +67,17 @@ inline KmerInt kmer_revcomp(KmerInt kmer, int k) {
     return rc;
 }
 
+// Canonical k-mer: min(kmer, revcomp(kmer)).
+// *is_rc is set to true when the reverse complement was chosen
+// (false for palindromic k-mers, where both are equal).
+template <typename KmerInt>
+inline KmerInt kmer_canonical(KmerInt kmer, int k, bool* is_rc = nullptr) {
+    KmerInt rc = kmer_revcomp(kmer, k);
+    bool use_rc = rc < kmer;
+    if (is_rc) *is_rc = use_rc;
+    return use_rc ? rc : kmer;
+}
+
 // 256-element LUT: true for IUPAC ambiguity codes (R,Y,S,W,K,M,B,D,H,V,N)
 inline const bool* degenerate_base_table() {
     static const bool table[256] = {
@@ -0,0 +1,15 @@
+#pragma once
+
+namespace ikafssn {
+
+// Software prefetch hint for a read access (no-op on compilers without
+// __builtin_prefetch). Locality 1: data is used once, shortly after.
+inline void prefetch_read(const void* p) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p, 0, 1);
+#else
+    (void)p;
+#endif
+}
+
+} // namespace ikafssn
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 
 namespace ikafssn {
 
@@ -21,6 +22,8 @@ struct ChainResult {
     SeqPos s_start;
     SeqPos s_end;
     bool   is_reverse;
+    // Chain hits in query order (only with Stage2Config::keep_anchors)
+    std::vector<Hit> anchors;
 };
 
 // Returns 0 for k <= 8 (uint16_t), 1 for k >= 9 (uint32_t).
@@ -119,6 +119,8 @@ std::string build_options_text(const SearchRequest& req, const DbStats& stats,
     oss << "context_abs=" << req.context_abs << "\n";
     oss << "context_frac_x10000=" << req.context_frac_x10000 << "\n";
     oss << "max_degen_expand=" << req.max_degen_expand << "\n";
+    oss << "dust_level=" << req.dust_level << "\n";
+    oss << "has_dust_level=" << static_cast<int>(req.has_dust_level) << "\n";
     oss << "seqidlist_mode=" << static_cast<int>(req.seqidlist_mode) << "\n";
     oss << "db=" << req.db << "\n";
     oss << "db_total_sequences=" << stats.total_sequences << "\n";
@@ -57,7 +57,9 @@ static std::string build_request_json(const SearchRequest& req) {
     root["context_abs"] = req.context_abs;
     root["context_frac_x10000"] = req.context_frac_x10000;
     root["max_degen_expand"] = req.max_degen_expand;
+    if (req.has_dust_level) root["dust_level"] = req.dust_level;
     if (req.score_matrix != 0) root["stage3_score_matrix"] = req.score_matrix;
+    if (req.stage3_engine != 0) root["stage3_engine"] = req.stage3_engine;
     if (!req.db.empty())
         root["db"] = req.db;
 
@@ -140,6 +142,9 @@ static bool parse_response_json(const std::string& body,
             for (const auto& w : qr["warnings"]) {
                 if (w.asString() == "multi_degen") {
                     query_result.warnings |= kWarnMultiDegen;
+                } else if (w.asString() == "low_complexity") {
+                    query_result.warnings |= kWarnLowComplexity;
+                    query_result.masked_positions = qr.get("masked_positions", 0).asUInt();
                 }
             }
         }
@@ -80,7 +80,9 @@ static void print_usage(const char* prog) {
         "  -stage3_min_ppositive <num> Min percent positive filter (default: server default)\n"
         "  -stage3_min_npositive <int> Min positive-scoring positions filter (default: server default)\n"
         "  -stage3_score_matrix <name>  Score matrix: degmatch, dnafull, nuc44 (default: server default)\n"
+        "  -stage3_engine <parasail|edit>  Alignment engine (default: server default)\n"
         "  -max_degen_expand <int>  Max degenerate expansion (default: server default, max: 256)\n"
+        "  -dust_level <int>        DUST low-complexity masking level (default: server default, 0: disable)\n"
         "  -t <int>                 Template length for spaced seeds (0/13/15/16/18/21, default: 0)\n"
         "  -template_type <string>  Template type: coding, optimal, both (default: server default)\n"
         "  -outfmt <tab|json|sam|bam>  Output format (default: tab)\n"
@@ -227,6 +229,12 @@ static void collect_results(const SearchResponse& resp,
                 "those k-mers are ignored and not used in the search\n",
                 qr.qseqid.c_str());
         }
+        if (qr.warnings & kWarnLowComplexity) {
+            std::fprintf(stderr,
+                "Warning: query '%s' has %u low-complexity base(s) masked by DUST; "
+                "k-mers overlapping them are not used in the search\n",
+                qr.qseqid.c_str(), qr.masked_positions);
+        }
         for (const auto& hit : qr.hits) {
             OutputHit oh;
             oh.qseqid = qr.qseqid;
@@ -439,6 +447,15 @@ int main(int argc, char* argv[]) {
         }
         base_req.max_degen_expand = static_cast<uint16_t>(mde);
     }
+    if (cli.has("-dust_level")) {
+        int dl = cli.get_int("-dust_level", 0);
+        if (dl < 0 || dl > 1000) {
+            std::fprintf(stderr, "Error: -dust_level must be between 0 and 1000\n");
+            return 1;
+        }
+        base_req.dust_level = static_cast<uint16_t>(dl);
+        base_req.has_dust_level = 1;
+    }
     {
         int cli_t = cli.get_int("-t", 0);
         if (cli_t != 0 && cli_t != 13 && cli_t != 15 && cli_t != 16 && cli_t != 18 && cli_t != 21) {
@@ -479,6 +496,15 @@ int main(int argc, char* argv[]) {
             return 1;
         }
     }
+    if (cli.has("-stage3_engine")) {
+        std::string en = cli.get_string("-stage3_engine");
+        if (en == "parasail") base_req.stage3_engine = 1;
+        else if (en == "edit") base_req.stage3_engine = 2;
+        else {
+            std::fprintf(stderr, "Error: -stage3_engine must be parasail or edit\n");
+            return 1;
+        }
+    }
 
     // Context
     {
@@ -107,6 +107,10 @@ void HttpController::search(
     sreq.context_abs = j.get("context_abs", 0).asUInt();
     sreq.context_frac_x10000 = static_cast<uint16_t>(j.get("context_frac_x10000", 0).asUInt());
     sreq.max_degen_expand = static_cast<uint16_t>(j.get("max_degen_expand", 0).asUInt());
+    if (j.isMember("dust_level")) {
+        sreq.dust_level = static_cast<uint16_t>(j["dust_level"].asUInt());
+        sreq.has_dust_level = 1;
+    }
     if (j.isMember("stage3_score_matrix")) {
         auto val = j["stage3_score_matrix"];
         if (val.isString()) {
@@ -118,6 +122,22 @@ void HttpController::search(
             sreq.score_matrix = static_cast<uint8_t>(val.asInt());
         }
     }
+    if (j.isMember("stage3_engine")) {
+        auto val = j["stage3_engine"];
+        if (val.isString()) {
+            std::string en = val.asString();
+            if (en == "parasail") sreq.stage3_engine = 1;
+            else if (en == "edit") sreq.stage3_engine = 2;
+        } else if (val.isInt() && val.asInt() >= 1 && val.asInt() <= 2) {
+            sreq.stage3_engine = static_cast<uint8_t>(val.asInt());
+        }
+        if (sreq.stage3_engine == 0) {
+            callback(make_error_response(
+                drogon::k400BadRequest,
+                "stage3_engine must be parasail or edit"));
+            return;
+        }
+    }
     if (j.isMember("t")) {
         sreq.t = static_cast<uint8_t>(j["t"].asInt());
     }
@@ -264,6 +284,10 @@ void HttpController::search(
                 if (qr.warnings & kWarnMultiDegen) {
                     warn_arr.append("multi_degen");
                 }
+                if (qr.warnings & kWarnLowComplexity) {
+                    warn_arr.append("low_complexity");
+                    qobj["masked_positions"] = qr.masked_positions;
+                }
                 qobj["warnings"] = std::move(warn_arr);
             }
             results_arr.append(std::move(qobj));
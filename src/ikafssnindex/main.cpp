@@ -59,6 +59,8 @@ static void print_usage(const char* prog, const std::string& default_mem) {
         "                         16, 18, 21: requires -k 11 or 12\n"
         "  -template_type <str>   Template type: coding, optimal, or both (required with -t)\n"
         "                         both: builds coding and optimal indexes sequentially\n"
+        "  -canonical             Store canonical k-mers, min(kmer, revcomp), with a\n"
+        "                         per-posting strand bit (contiguous k-mers only)\n"
         "  -openvol <int>         Max volumes processed simultaneously\n"
         "                         (default: 1)\n"
         "  -threads <int>         Number of threads (default: all cores)\n"
@@ -219,6 +221,12 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    bool canonical = cli.has("-canonical");
+    if (canonical && spaced_t > 0) {
+        std::fprintf(stderr, "Error: -canonical is only supported for contiguous k-mers (-t 0)\n");
+        return 1;
+    }
+
     // Determine which template types to build.
     // "both" builds coding and optimal indexes sequentially.
     std::vector<TemplateType> build_types;
@@ -236,8 +244,9 @@ int main(int argc, char* argv[]) {
                     k, spaced_t, type_display.c_str(),
                     index_mode, mem_limit_str.c_str(), openvol, threads);
     } else {
-        logger.info("Parameters: k=%d, mode=%d, memory_limit=%s, openvol=%d, threads=%d",
-                    k, index_mode, mem_limit_str.c_str(), openvol, threads);
+        logger.info("Parameters: k=%d, mode=%d, canonical=%s, memory_limit=%s, openvol=%d, threads=%d",
+                    k, index_mode, canonical ? "yes" : "no",
+                    mem_limit_str.c_str(), openvol, threads);
     }
 
     // Extract DB base name from path
@@ -256,6 +265,7 @@ int main(int argc, char* argv[]) {
     config.max_degen_expand = max_degen_expand;
     config.t = spaced_t;
     config.template_type = static_cast<uint8_t>(spaced_type);
+    config.canonical = canonical;
     // When max_freq_build is active (not 1.0 = disabled), keep .tmp files for cross-volume filtering
     bool freq_filter_active = (max_freq_build != 1.0);
     config.keep_tmp = freq_filter_active;
@@ -308,6 +308,7 @@ int main(int argc, char* argv[]) {
     uint8_t vol_template_type = vol_files[0].template_type;
     // Determine table size from first volume's reader
     uint32_t tbl_size = 0;
+    bool canonical = false;
     {
         KixReader kix0;
         if (!kix0.open(vol_files[0].kix_path)) {
@@ -315,6 +316,7 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         tbl_size = kix0.table_size();
+        canonical = (kix0.header().flags & KIX_FLAG_CANONICAL) != 0;
         kix0.close();
     }
 
@@ -374,6 +376,9 @@ int main(int argc, char* argv[]) {
         std::printf("Template type:     %s\n",
                      template_type_to_string(static_cast<TemplateType>(vol_template_type)).c_str());
     }
+    if (canonical) {
+        std::printf("Canonical k-mers:  yes (strand-collapsed)\n");
+    }
     std::printf("Table size (4^k):  %lu\n", static_cast<unsigned long>(tbl_size));
     std::printf("Number of volumes: %zu\n\n", vol_stats.size());
 
@@ -14,6 +14,7 @@
 #include "search/stage3_alignment.hpp"
 #include "io/fasta_reader.hpp"
 #include "io/blastdb_reader.hpp"
+#include "io/blastdb_subject_source.hpp"
 #include "io/volume_discovery.hpp"
 #include "io/seqidlist_reader.hpp"
 #include "io/result_writer.hpp"
@@ -28,6 +29,7 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <memory>
 #include <set>
 #include <string>
 #include <thread>
@@ -65,21 +67,33 @@ static void print_usage(const char* prog) {
         "  -memory_limit <size>     madvise WILLNEED budget (default: half of RAM)\n"
         "                           Accepts K, M, G suffixes\n"
         "  -mode <1|2|3>            1=Stage1, 2=Stage1+2, 3=Stage1+2+3 (default: 2)\n"
-        "  -db <path>               BLAST DB path for mode 3 (default: same as -ix)\n"
+        "  -db <path>               BLAST DB path for mode 3 and Stage 2 rescan (default: same as -ix)\n"
         "  -stage1_score <1|2>      1=coverscore, 2=matchscore (default: 1)\n"
         "  -stage2_min_score <int>  Minimum chain score (default: 0 = adaptive)\n"
         "                           0 = use resolved Stage 1 threshold\n"
         "  -stage2_max_gap <int>    Chaining diagonal gap tolerance (default: 100)\n"
-        "  -stage2_max_lookback <int>  Chaining DP lookback window (default: 64, 0=unlimited)\n"
+        "  -stage2_max_lookback <int>  Chaining DP lookback window (default: 0=exact, no window)\n"
         "  -stage2_max_nhit_per_subject <int>  Max chains per subject (default: 1, 0=unlimited)\n"
         "  -stage1_max_freq <num>   High-frequency k-mer skip threshold (default: 0.5)\n"
         "                           0 < x < 1: fraction of total NSEQ across all volumes\n"
         "                           1 or 1.0: disable high-freq filtering entirely\n"
         "                           > 1: absolute count threshold; 0 = auto\n"
         "  -stage2_min_diag_hits <int>  Diagonal filter min hits (default: 1)\n"
+        "  -stage2_engine <auto|kpx|rescan>  Stage 2 hit source: .kpx position lists or\n"
+        "                           rescan of candidate sequences from -db (default: auto)\n"
+        "  -stage2_rescan_degen_expand <int>  Degenerate subject expansion for rescan;\n"
+        "                           must match ikafssnindex -max_degen_expand (default: 4)\n"
         "  -stage1_topn <int>       Stage 1 candidate limit, 0=unlimited (default: 0)\n"
         "  -stage1_min_score <num>  Stage 1 minimum score; integer or 0<P<1 fraction (default: 0.5)\n"
+        "  -stage1_max_postings <int>  Rare-first k-mer selection: posting-decode budget\n"
+        "                           per query strand, 0=unlimited (default: 0)\n"
+        "  -stage1_target_coverage <num>  Rare-first k-mer selection: stop once this fraction\n"
+        "                           of query positions is covered, 0=disabled (default: 0)\n"
         "  -num_results <int>       Max results per query, 0=unlimited (default: 0)\n"
+        "  -query_window <int>      Split queries longer than this into windows searched\n"
+        "                           in parallel, modes 2/3, 0=disabled (default: 0)\n"
+        "  -query_window_overlap <int>  Bases each window scores beyond its core in\n"
+        "                           Stage 1 (default: 1000)\n"
         "  -seqidlist <path>        Include only listed accessions\n"
         "  -negative_seqidlist <path>  Exclude listed accessions\n"
         "  -strand <-1|1|2>         Strand: 1=plus, -1=minus, 2=both (default: 2)\n"
@@ -91,8 +105,18 @@ static void print_usage(const char* prog) {
         "  -stage3_min_ppositive <num> Min percent positive filter for mode 3 (default: 0)\n"
         "  -stage3_min_npositive <int> Min positive-scoring positions filter for mode 3 (default: 0)\n"
         "  -stage3_score_matrix <name>  Score matrix: degmatch, dnafull, nuc44 (default: degmatch)\n"
+        "  -stage3_engine <parasail|edit>  Alignment engine: affine-gap parasail or\n"
+        "                           bit-parallel edit distance (default: parasail)\n"
         "  -stage3_fetch_threads <int>  Threads for BLAST DB fetch in mode 3 (default: min(8, threads))\n"
+        "  -stage3_ungapped <0|1>   Align single-diagonal chains without gaps (default: 1)\n"
+        "  -stage3_prefilter <0|1>  Skip traceback of hits that cannot pass min_npositive/min_ppositive (default: 1)\n"
+        "  -stage3_banded <0|1>     Band score-only alignment around the Stage 2 chain (default: 1)\n"
+        "  -stage3_batch_min_hits <int>  Batch score-only alignment of this many hits\n"
+        "                           on one subject region, 0=disabled (default: 8)\n"
+        "  -stage3_anchored <0|1>   Align through the Stage 2 chain k-mers, contiguous seeds only (default: 0)\n"
         "  -max_degen_expand <int>  Max degenerate expansion per k-mer (default: 16, max: 256, 0/1: disable)\n"
+        "  -dust_level <int>        DUST low-complexity query masking level, 0=disabled (default: 0; dustmasker: 20)\n"
+        "  -prefetch_distance <int> Posting prefetch look-ahead in k-mers, 0=disabled (default: 16)\n"
         "  -t <int>                 Template length for spaced seeds (0=contiguous, 13/15/18 for k=8-9, 16/18/21 for k=11-12; default: 0)\n"
         "  -template_type <string>  Template type: coding, optimal, both (default: both)\n"
         "  -outfmt <tab|json|sam|bam>  Output format (default: tab)\n"
@@ -107,6 +131,7 @@ struct VolumeData {
     KsxReader ksx;
     OidFilter filter;
     uint16_t volume_index;
+    std::unique_ptr<BlastDbSubjectSource> subjects;  // Stage 2 rescan (optional)
 };
 
 // A (query, volume) search job.
@@ -115,6 +140,12 @@ struct SearchJob {
     size_t volume_idx;
 };
 
+// One window of a windowed (query, volume) search job.
+struct WindowJob {
+    size_t merge_idx;   // index of the (query, volume) job
+    size_t window_idx;
+};
+
 int main(int argc, char* argv[]) {
     CliParser cli(argc, argv);
 
@@ -186,13 +217,60 @@ int main(int argc, char* argv[]) {
     double max_freq_raw = cli.get_double("-stage1_max_freq", 0.5);
     config.stage1.stage1_topn = static_cast<uint32_t>(cli.get_int("-stage1_topn", 0));
     config.stage1.stage1_score_type = static_cast<uint8_t>(cli.get_int("-stage1_score", 1));
+    {
+        double mp = cli.get_double("-stage1_max_postings", 0);
+        if (mp < 0) {
+            std::fprintf(stderr, "Error: -stage1_max_postings must be >= 0\n");
+            return 1;
+        }
+        config.stage1_max_postings = static_cast<uint64_t>(mp);
+        config.stage1_target_coverage = cli.get_double("-stage1_target_coverage", 0);
+        if (config.stage1_target_coverage < 0 || config.stage1_target_coverage > 1) {
+            std::fprintf(stderr, "Error: -stage1_target_coverage must be between 0 and 1\n");
+            return 1;
+        }
+    }
+    {
+        int pd = cli.get_int("-prefetch_distance", 16);
+        if (pd < 0) {
+            std::fprintf(stderr, "Error: -prefetch_distance must be >= 0\n");
+            return 1;
+        }
+        config.stage1.prefetch_distance = static_cast<uint32_t>(pd);
+    }
     config.stage2.max_gap = static_cast<uint32_t>(cli.get_int("-stage2_max_gap", 100));
-    config.stage2.chain_max_lookback = static_cast<uint32_t>(cli.get_int("-stage2_max_lookback", 64));
+    config.stage2.chain_max_lookback = static_cast<uint32_t>(cli.get_int("-stage2_max_lookback", 0));
     config.stage2.max_nhit_per_subject = static_cast<uint32_t>(cli.get_int("-stage2_max_nhit_per_subject", 1));
     config.stage2.min_diag_hits = static_cast<uint32_t>(cli.get_int("-stage2_min_diag_hits", 1));
     config.stage2.min_score = static_cast<uint32_t>(cli.get_int("-stage2_min_score", 0));
     config.num_results = static_cast<uint32_t>(cli.get_int("-num_results", 0));
     config.mode = static_cast<uint8_t>(cli.get_int("-mode", 2));
+    {
+        std::string engine = cli.get_string("-stage2_engine", "auto");
+        if (engine == "auto") config.stage2_engine = 0;
+        else if (engine == "kpx") config.stage2_engine = 1;
+        else if (engine == "rescan") config.stage2_engine = 2;
+        else {
+            std::fprintf(stderr, "Error: -stage2_engine must be auto, kpx, or rescan\n");
+            return 1;
+        }
+        int de = cli.get_int("-stage2_rescan_degen_expand", 4);
+        if (de < 0 || de > 256) {
+            std::fprintf(stderr, "Error: -stage2_rescan_degen_expand must be between 0 and 256\n");
+            return 1;
+        }
+        config.subject_max_degen_expand = static_cast<uint16_t>(de);
+    }
+    {
+        int window = cli.get_int("-query_window", 0);
+        int overlap = cli.get_int("-query_window_overlap", 1000);
+        if (window < 0 || overlap < 0) {
+            std::fprintf(stderr, "Error: -query_window and -query_window_overlap must be >= 0\n");
+            return 1;
+        }
+        config.query_window = static_cast<uint32_t>(window);
+        config.query_window_overlap = static_cast<uint32_t>(overlap);
+    }
     config.strand = static_cast<int8_t>(cli.get_int("-strand", 2));
     if (config.strand != -1 && config.strand != 1 && config.strand != 2) {
         std::fprintf(stderr, "Error: -strand must be -1, 1, or 2\n");
@@ -209,7 +287,7 @@ int main(int argc, char* argv[]) {
             return 1;
     }
 
-    // BLAST DB path for mode 3 (default: same as index prefix)
+    // BLAST DB path for mode 3 and Stage 2 rescan (default: same as index prefix)
     std::string db_path = cli.get_string("-db", ix_prefix);
 
     // Stage 3 config
@@ -217,6 +295,18 @@ int main(int argc, char* argv[]) {
     stage3_config.gapopen = cli.get_int("-stage3_gapopen", 10);
     stage3_config.gapext = cli.get_int("-stage3_gapext", 1);
     stage3_config.traceback = (cli.get_int("-stage3_traceback", 0) != 0);
+    stage3_config.ungapped = (cli.get_int("-stage3_ungapped", 1) != 0);
+    stage3_config.prefilter = (cli.get_int("-stage3_prefilter", 1) != 0);
+    stage3_config.banded = (cli.get_int("-stage3_banded", 1) != 0);
+    if (cli.has("-stage3_batch_min_hits")) {
+        int batch_min_hits = cli.get_int("-stage3_batch_min_hits", 8);
+        if (batch_min_hits < 0) {
+            std::fprintf(stderr, "Error: -stage3_batch_min_hits must be >= 0\n");
+            return 1;
+        }
+        stage3_config.batch_min_hits = static_cast<uint32_t>(batch_min_hits);
+    }
+    stage3_config.anchored = (cli.get_int("-stage3_anchored", 0) != 0);
     stage3_config.min_ppositive = cli.get_double("-stage3_min_ppositive", 0.0);
     stage3_config.min_npositive = static_cast<uint32_t>(cli.get_int("-stage3_min_npositive", 0));
     if (cli.has("-stage3_score_matrix")) {
@@ -228,6 +318,13 @@ int main(int argc, char* argv[]) {
             return 1;
         }
     }
+    if (cli.has("-stage3_engine")) {
+        stage3_config.engine = cli.get_string("-stage3_engine");
+        if (stage3_config.engine != "parasail" && stage3_config.engine != "edit") {
+            std::fprintf(stderr, "Error: -stage3_engine must be parasail or edit\n");
+            return 1;
+        }
+    }
     if (cli.has("-stage3_fetch_threads")) {
         stage3_config.fetch_threads = cli.get_int("-stage3_fetch_threads", 8);
         if (stage3_config.fetch_threads > num_threads) {
@@ -301,6 +398,14 @@ int main(int argc, char* argv[]) {
         }
         config.max_degen_expand = static_cast<uint16_t>(mde);
     }
+    {
+        int dl = cli.get_int("-dust_level", 0);
+        if (dl < 0 || dl > 1000) {
+            std::fprintf(stderr, "Error: -dust_level must be between 0 and 1000\n");
+            return 1;
+        }
+        config.dust_level = static_cast<uint16_t>(dl);
+    }
 
     int cli_t = cli.get_int("-t", 0);
     if (cli_t != 0 && cli_t != 13 && cli_t != 15 && cli_t != 16 && cli_t != 18 && cli_t != 21) {
@@ -425,7 +530,21 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // Anchored Stage 3 needs exact k-mer matches: contiguous seeds only
+    if (config.mode == 3 && stage3_config.anchored) {
+        if (spaced_t > 0) {
+            std::fprintf(stderr, "Warning: -stage3_anchored is ignored with spaced seeds (-t %d)\n",
+                         spaced_t);
+            stage3_config.anchored = false;
+        } else {
+            config.stage2.keep_anchors = true;
+            stage3_config.anchor_span = k;
+        }
+    }
+
     logger.info("Found %zu volume(s), k=%d, threads=%d", vol_files.size(), k, num_threads);
+    logger.info("Prefetch distance: %u k-mer(s)%s", config.stage1.prefetch_distance,
+                config.stage1.prefetch_distance == 0 ? " (disabled)" : "");
 
     // Read query FASTA or primer FASTA
     std::vector<FastaRecord> queries;
@@ -496,6 +615,17 @@ int main(int argc, char* argv[]) {
         logger.info("Loaded %zu accessions from seqidlist (exclude mode)", seqidlist.size());
     }
 
+    const bool is_both_mode = (spaced_t > 0 && spaced_type == TemplateType::kBoth);
+    const bool need_kpx = (config.mode != 1);
+    // Stage 2 subject rescan needs contiguous k-mers and one template
+    const bool rescan_capable = need_kpx && !is_both_mode && spaced_t == 0;
+    const bool allow_missing_kpx = rescan_capable && config.stage2_engine != 1;
+    if (config.stage2_engine == 2 && !rescan_capable) {
+        std::fprintf(stderr, "Error: -stage2_engine rescan requires -mode 2 or 3 "
+                             "and a contiguous (-t 0) index\n");
+        return 1;
+    }
+
     // Helper lambda: open a set of VolumeData from discovered volume files.
     auto open_volumes = [&](const std::vector<DiscoveredVolume>& vfiles,
                             std::vector<VolumeData>& vdata,
@@ -508,17 +638,19 @@ int main(int argc, char* argv[]) {
                 return false;
             }
             if (need_kpx) {
-                if (!vf.has_kpx) {
+                if (vf.has_kpx) {
+                    if (!vdata[vi].kpx.open(vf.kpx_path)) {
+                        std::fprintf(stderr, "Error: cannot open %s\n", vf.kpx_path.c_str());
+                        return false;
+                    }
+                } else if (!allow_missing_kpx) {
                     std::fprintf(stderr,
                         "Error: mode %d requires .kpx files, but %s was not found.\n"
                         "This index was built with -mode 1 (stage 1 only).\n",
                         config.mode, vf.kpx_path.c_str());
                     return false;
                 }
-                if (!vdata[vi].kpx.open(vf.kpx_path)) {
-                    std::fprintf(stderr, "Error: cannot open %s\n", vf.kpx_path.c_str());
-                    return false;
-                }
+                // else: Stage 2 rescans subject sequences instead (checked below)
             }
             if (!vdata[vi].ksx.open(vf.ksx_path)) {
                 std::fprintf(stderr, "Error: cannot open %s\n", vf.ksx_path.c_str());
@@ -532,9 +664,6 @@ int main(int argc, char* argv[]) {
         return true;
     };
 
-    const bool is_both_mode = (spaced_t > 0 && spaced_type == TemplateType::kBoth);
-    const bool need_kpx = (config.mode != 1);
-
     // Pre-open volumes.
     // For "both" mode: open coding and optimal volumes separately.
     // For non-both mode: open a single set of volumes.
@@ -549,6 +678,51 @@ int main(int argc, char* argv[]) {
         if (!open_volumes(vol_files, vol_data, need_kpx)) return 1;
     }
 
+    // Stage 2 subject rescan: open the BLAST DB volume matching each index
+    // volume (volume-local OIDs). Without .kpx it is the only Stage 2 engine.
+    if (allow_missing_kpx) {
+        bool missing_kpx = false;
+        bool canonical = false;
+        for (const auto& vd : vol_data) {
+            if (!vd.kpx.is_open()) missing_kpx = true;
+            if (vd.kix.header().flags & KIX_FLAG_CANONICAL) canonical = true;
+        }
+        auto blast_vols = canonical ? std::vector<std::string>{}
+                                    : BlastDbReader::find_volume_paths(db_path);
+        if (missing_kpx && blast_vols.empty()) {
+            std::fprintf(stderr,
+                "Error: mode %d requires .kpx files, or a BLAST DB (-db) of a "
+                "non-canonical index for Stage 2 rescan; none found at '%s'\n",
+                config.mode, db_path.c_str());
+            return 1;
+        }
+        if (config.stage2_engine == 2 && blast_vols.empty()) {
+            std::fprintf(stderr,
+                "Error: -stage2_engine rescan requires a non-canonical index "
+                "and a BLAST DB (-db)\n");
+            return 1;
+        }
+        for (auto& vd : vol_data) {
+            if (blast_vols.empty()) break;
+            if (vd.volume_index >= blast_vols.size()) {
+                std::fprintf(stderr, "Error: no BLAST DB volume for index volume %u\n",
+                             static_cast<unsigned>(vd.volume_index));
+                return 1;
+            }
+            vd.subjects = std::make_unique<BlastDbSubjectSource>();
+            if (!vd.subjects->open(blast_vols[vd.volume_index])) {
+                std::fprintf(stderr, "Error: cannot open BLAST DB volume %s\n",
+                             blast_vols[vd.volume_index].c_str());
+                return 1;
+            }
+        }
+        if (!blast_vols.empty()) {
+            logger.info("Stage 2 subject rescan enabled (%s)",
+                        config.stage2_engine == 2 ? "-stage2_engine rescan"
+                        : missing_kpx ? "no .kpx" : "auto");
+        }
+    }
+
     // Open shared .khx (non-fatal if missing).
     // For "both" mode: open separate KHX for coding and optimal.
     KhxReader shared_khx;       // non-both mode
@@ -757,6 +931,27 @@ int main(int argc, char* argv[]) {
         }
     };
 
+    // Helper: emit low-complexity masking warning
+    auto warn_masked = [&](size_t qi, uint32_t masked_positions) {
+        if (masked_positions > 0) {
+            std::fprintf(stderr,
+                "Warning: query '%s' has %u low-complexity base(s) masked by DUST; "
+                "k-mers overlapping them are not used in the search\n",
+                queries[qi].id.c_str(), masked_positions);
+        }
+    };
+
+    // Helper: report k-mers dropped by rare-first selection
+    uint64_t total_dropped_kmers = 0;
+    size_t num_dropped_queries = 0;
+    auto report_dropped = [&](size_t qi, uint32_t dropped) {
+        if (dropped == 0) return;
+        total_dropped_kmers += dropped;
+        num_dropped_queries++;
+        logger.debug("Query '%s': rare-first selection dropped %u k-mer(s)",
+                     queries[qi].id.c_str(), dropped);
+    };
+
     if (is_both_mode) {
         // Both mode: preprocess twice (coding + optimal)
         if (kmer_type_for(k, spaced_t) == 0) {
@@ -773,6 +968,9 @@ int main(int argc, char* argv[]) {
                     spaced_t, seed_masks_opt)});
                 warn_degen(qi, pp16_cod.back().qdata.has_multi_degen ||
                                pp16_opt.back().qdata.has_multi_degen);
+                warn_masked(qi, pp16_cod.back().qdata.num_masked_positions);
+                report_dropped(qi, pp16_cod.back().qdata.num_dropped_kmers +
+                                   pp16_opt.back().qdata.num_dropped_kmers);
             }
         } else {
             pp32_cod.reserve(queries.size());
@@ -788,6 +986,9 @@ int main(int argc, char* argv[]) {
                     spaced_t, seed_masks_opt)});
                 warn_degen(qi, pp32_cod.back().qdata.has_multi_degen ||
                                pp32_opt.back().qdata.has_multi_degen);
+                warn_masked(qi, pp32_cod.back().qdata.num_masked_positions);
+                report_dropped(qi, pp32_cod.back().qdata.num_dropped_kmers +
+                                   pp32_opt.back().qdata.num_dropped_kmers);
             }
         }
     } else {
@@ -801,6 +1002,8 @@ int main(int argc, char* argv[]) {
                     queries[qi].sequence, k, all_kix, khx_ptr, config,
                     spaced_t, seed_masks)});
                 warn_degen(qi, pp16.back().qdata.has_multi_degen);
+                warn_masked(qi, pp16.back().qdata.num_masked_positions);
+                report_dropped(qi, pp16.back().qdata.num_dropped_kmers);
             }
         } else {
             pp32.reserve(queries.size());
@@ -811,12 +1014,51 @@ int main(int argc, char* argv[]) {
                     queries[qi].sequence, k, all_kix, khx_ptr, config,
                     spaced_t, seed_masks)});
                 warn_degen(qi, pp32.back().qdata.has_multi_degen);
+                warn_masked(qi, pp32.back().qdata.num_masked_positions);
+                report_dropped(qi, pp32.back().qdata.num_dropped_kmers);
             }
         }
     }
 
+    if (total_dropped_kmers > 0) {
+        logger.info("Rare-first selection dropped %lu k-mer(s) in %zu query(ies)",
+                    static_cast<unsigned long>(total_dropped_kmers), num_dropped_queries);
+    }
+
+    // Long-query windows (-query_window, single-template modes 2/3): queries
+    // longer than one window are searched as (query, volume, window) jobs.
+    std::vector<std::vector<QueryWindow<uint16_t>>> win16;
+    std::vector<std::vector<QueryWindow<uint32_t>>> win32;
+    std::vector<bool> query_windowed(queries.size(), false);
+    size_t num_windowed = 0;
+    if (config.query_window > 0 && config.mode != 1 && !is_both_mode) {
+        auto split_all = [&](const auto& pp, auto& win) {
+            win.resize(pp.size());
+            for (size_t qi = 0; qi < queries.size(); qi++) {
+                if (query_skipped[qi]) continue;
+                size_t pp_idx = query_pp_idx[qi];
+                win[pp_idx] = split_query_windows(
+                    pp[pp_idx].qdata, static_cast<uint32_t>(queries[qi].sequence.size()),
+                    config);
+                if (!win[pp_idx].empty()) {
+                    query_windowed[qi] = true;
+                    num_windowed++;
+                }
+            }
+        };
+        if (kmer_type_for(k, spaced_t) == 0) {
+            split_all(pp16, win16);
+        } else {
+            split_all(pp32, win32);
+        }
+        if (num_windowed > 0) {
+            logger.info("Splitting %zu long query(ies) into %u-base windows",
+                        num_windowed, config.query_window);
+        }
+    }
+
     // Thread-local Stage1Buffer to avoid per-job allocation.
-    // For "both" mode: need two buffers per thread (coding + optimal).
+    // "both" mode scores both templates in one buffer.
     uint32_t max_num_seqs = 0;
     if (is_both_mode) {
         for (const auto& vd : vol_data_cod)
@@ -826,48 +1068,54 @@ int main(int argc, char* argv[]) {
             max_num_seqs = std::max(max_num_seqs, vd.kix.num_sequences());
     }
 
-    // Determine optimal tier from actual preprocessed k-mer counts
+    // Determine optimal tier from actual preprocessed k-mer counts and
+    // query positions
     uint32_t max_kmer_positions = 0;
+    uint32_t max_position_value = 0;
     if (is_both_mode) {
-        if (kmer_type_for(k, spaced_t) == 0) {
-            for (const auto& pp : pp16_cod) {
+        // Stage 1 scores are summed over both templates
+        auto both_positions = [&](const auto& cod, const auto& opt) {
+            for (size_t i = 0; i < cod.size(); i++) {
                 max_kmer_positions = std::max(max_kmer_positions,
-                    static_cast<uint32_t>(std::max(pp.qdata.fwd_positions.size(),
-                                                   pp.qdata.rc_positions.size())));
-            }
-            for (const auto& pp : pp16_opt) {
-                max_kmer_positions = std::max(max_kmer_positions,
-                    static_cast<uint32_t>(std::max(pp.qdata.fwd_positions.size(),
-                                                   pp.qdata.rc_positions.size())));
+                    static_cast<uint32_t>(std::max(
+                        cod[i].qdata.fwd_positions.size() + opt[i].qdata.fwd_positions.size(),
+                        cod[i].qdata.rc_positions.size() + opt[i].qdata.rc_positions.size())));
+                max_position_value = std::max({max_position_value,
+                    max_query_position(cod[i].qdata), max_query_position(opt[i].qdata)});
             }
+        };
+        if (kmer_type_for(k, spaced_t) == 0) {
+            both_positions(pp16_cod, pp16_opt);
         } else {
-            for (const auto& pp : pp32_cod) {
-                max_kmer_positions = std::max(max_kmer_positions,
-                    static_cast<uint32_t>(std::max(pp.qdata.fwd_positions.size(),
-                                                   pp.qdata.rc_positions.size())));
-            }
-            for (const auto& pp : pp32_opt) {
-                max_kmer_positions = std::max(max_kmer_positions,
-                    static_cast<uint32_t>(std::max(pp.qdata.fwd_positions.size(),
-                                                   pp.qdata.rc_positions.size())));
-            }
+            both_positions(pp32_cod, pp32_opt);
         }
     } else {
-        if (kmer_type_for(k, spaced_t) == 0) {
-            for (const auto& pp : pp16) {
+        // Windowed queries: window k-mer counts and (rebased) positions
+        auto note_positions = [&](const auto& pp, const auto& win) {
+            for (size_t i = 0; i < pp.size(); i++) {
+                if (i < win.size() && !win[i].empty()) {
+                    for (const auto& w : win[i]) {
+                        uint32_t extent = w.core_end + config.query_window_overlap;
+                        max_kmer_positions = std::max({max_kmer_positions, extent,
+                            static_cast<uint32_t>(std::max(w.qdata.fwd_positions.size(),
+                                                           w.qdata.rc_positions.size()))});
+                    }
+                    continue;
+                }
                 max_kmer_positions = std::max(max_kmer_positions,
-                    static_cast<uint32_t>(std::max(pp.qdata.fwd_positions.size(),
-                                                   pp.qdata.rc_positions.size())));
+                    static_cast<uint32_t>(std::max(pp[i].qdata.fwd_positions.size(),
+                                                   pp[i].qdata.rc_positions.size())));
+                max_position_value = std::max(max_position_value,
+                                              max_query_position(pp[i].qdata));
             }
+        };
+        if (kmer_type_for(k, spaced_t) == 0) {
+            note_positions(pp16, win16);
         } else {
-            for (const auto& pp : pp32) {
-                max_kmer_positions = std::max(max_kmer_positions,
-                    static_cast<uint32_t>(std::max(pp.qdata.fwd_positions.size(),
-                                                   pp.qdata.rc_positions.size())));
-            }
+            note_positions(pp32, win32);
         }
     }
-    Stage1Tier tier = select_tier(max_kmer_positions, max_kmer_positions);
+    Stage1Tier tier = select_tier(max_kmer_positions, max_position_value);
 
     tbb::enumerable_thread_specific<Stage1Buffer> tls_bufs(
         [max_num_seqs, tier]() {
@@ -877,15 +1125,6 @@ int main(int argc, char* argv[]) {
             return buf;
         });
 
-    // For "both" mode: a second set of thread-local buffers for the optimal side
-    tbb::enumerable_thread_specific<Stage1Buffer> tls_bufs_opt(
-        [max_num_seqs, tier]() {
-            Stage1Buffer buf;
-            buf.tier = tier;
-            buf.ensure_capacity(max_num_seqs);
-            return buf;
-        });
-
     // Thread-local hit collection (no mutex needed)
     tbb::combinable<std::vector<OutputHit>> tls_hits;
 
@@ -923,6 +1162,7 @@ int main(int argc, char* argv[]) {
                 oh.coverscore = cr.stage1_score;
             oh.volume = volume_index;
             oh.oid = cr.seq_id;
+            oh.anchors = cr.anchors;
             oh.qlen = static_cast<uint32_t>(query_seq.size());
             oh.slen = ksx.seq_length(cr.seq_id);
             local_hits.push_back(oh);
@@ -944,14 +1184,14 @@ int main(int argc, char* argv[]) {
                     auto& local_hits = tls_hits.local();
 
                     for (size_t qi = range.begin(); qi != range.end(); ++qi) {
-                        if (query_skipped[qi]) continue;
+                        if (query_skipped[qi] || query_windowed[qi]) continue;
                         const auto& query = queries[qi];
                         size_t pp_idx = query_pp_idx[qi];
+                        ScoreFloor score_floor;  // -num_results floor across volumes
 
                         for (size_t vi = 0; vi < num_volumes; vi++) {
                             SearchResult sr;
                             if (is_both_mode) {
-                                auto& buf_opt = tls_bufs_opt.local();
                                 const auto& vd_cod = vol_data_cod[vi];
                                 const auto& vd_opt = vol_data_opt[vi];
                                 if (kmer_type_for(k, spaced_t) == 0) {
@@ -961,7 +1201,7 @@ int main(int argc, char* argv[]) {
                                         k, vd_cod.kix, vd_cod.kpx,
                                         vd_opt.kix, vd_opt.kpx,
                                         vd_cod.ksx, vd_cod.filter, config,
-                                        &buf, &buf_opt);
+                                        &buf, &score_floor);
                                 } else {
                                     sr = search_volume_both<uint32_t>(
                                         query.id,
@@ -969,7 +1209,7 @@ int main(int argc, char* argv[]) {
                                         k, vd_cod.kix, vd_cod.kpx,
                                         vd_opt.kix, vd_opt.kpx,
                                         vd_cod.ksx, vd_cod.filter, config,
-                                        &buf, &buf_opt);
+                                        &buf, &score_floor);
                                 }
                                 if (!sr.hits.empty()) {
                                     collect_hits(sr, vd_cod.ksx, vd_cod.volume_index,
@@ -980,11 +1220,13 @@ int main(int argc, char* argv[]) {
                                 if (kmer_type_for(k, spaced_t) == 0) {
                                     sr = search_volume<uint16_t>(
                                         query.id, pp16[pp_idx].qdata, k,
-                                        vd.kix, vd.kpx, vd.ksx, vd.filter, config, &buf);
+                                        vd.kix, vd.kpx, vd.ksx, vd.filter, config, &buf,
+                                        vd.subjects.get(), &score_floor);
                                 } else {
                                     sr = search_volume<uint32_t>(
                                         query.id, pp32[pp_idx].qdata, k,
-                                        vd.kix, vd.kpx, vd.ksx, vd.filter, config, &buf);
+                                        vd.kix, vd.kpx, vd.ksx, vd.filter, config, &buf,
+                                        vd.subjects.get(), &score_floor);
                                 }
                                 if (!sr.hits.empty()) {
                                     collect_hits(sr, vd.ksx, vd.volume_index,
@@ -998,9 +1240,10 @@ int main(int argc, char* argv[]) {
     } else {
         // Path B: fine-grained parallelism (parallel_for_each over query x volume)
         std::vector<SearchJob> jobs;
+        std::vector<ScoreFloor> score_floors(queries.size());  // per query
         jobs.reserve(queries.size() * num_volumes);
         for (size_t qi = 0; qi < queries.size(); qi++) {
-            if (query_skipped[qi]) continue;
+            if (query_skipped[qi] || query_windowed[qi]) continue;
             for (size_t vi = 0; vi < num_volumes; vi++) {
                 jobs.push_back({qi, vi});
             }
@@ -1017,7 +1260,6 @@ int main(int argc, char* argv[]) {
 
                     SearchResult sr;
                     if (is_both_mode) {
-                        auto& buf_opt = tls_bufs_opt.local();
                         const auto& vd_cod = vol_data_cod[job.volume_idx];
                         const auto& vd_opt = vol_data_opt[job.volume_idx];
                         if (kmer_type_for(k, spaced_t) == 0) {
@@ -1027,7 +1269,8 @@ int main(int argc, char* argv[]) {
                                 k, vd_cod.kix, vd_cod.kpx,
                                 vd_opt.kix, vd_opt.kpx,
                                 vd_cod.ksx, vd_cod.filter, config,
-                                &buf, &buf_opt);
+                                &buf,
+                                &score_floors[job.query_idx]);
                         } else {
                             sr = search_volume_both<uint32_t>(
                                 query.id,
@@ -1035,7 +1278,8 @@ int main(int argc, char* argv[]) {
                                 k, vd_cod.kix, vd_cod.kpx,
                                 vd_opt.kix, vd_opt.kpx,
                                 vd_cod.ksx, vd_cod.filter, config,
-                                &buf, &buf_opt);
+                                &buf,
+                                &score_floors[job.query_idx]);
                         }
                         if (!sr.hits.empty()) {
                             auto& local_hits = tls_hits.local();
@@ -1047,11 +1291,13 @@ int main(int argc, char* argv[]) {
                         if (kmer_type_for(k, spaced_t) == 0) {
                             sr = search_volume<uint16_t>(
                                 query.id, pp16[pp_idx].qdata, k,
-                                vd.kix, vd.kpx, vd.ksx, vd.filter, config, &buf);
+                                vd.kix, vd.kpx, vd.ksx, vd.filter, config, &buf,
+                                vd.subjects.get(), &score_floors[job.query_idx]);
                         } else {
                             sr = search_volume<uint32_t>(
                                 query.id, pp32[pp_idx].qdata, k,
-                                vd.kix, vd.kpx, vd.ksx, vd.filter, config, &buf);
+                                vd.kix, vd.kpx, vd.ksx, vd.filter, config, &buf,
+                                vd.subjects.get(), &score_floors[job.query_idx]);
                         }
                         if (!sr.hits.empty()) {
                             auto& local_hits = tls_hits.local();
@@ -1063,6 +1309,72 @@ int main(int argc, char* argv[]) {
         });
     }
 
+    // Path C: long-query windows, parallel over (query, volume, window);
+    // the window results of each (query, volume) are then stitched
+    if (num_windowed > 0) {
+        std::vector<WindowJob> win_jobs;
+        std::vector<SearchJob> merge_jobs;
+        std::vector<std::vector<SearchResult>> win_parts;  // per merge job
+        for (size_t qi = 0; qi < queries.size(); qi++) {
+            if (!query_windowed[qi]) continue;
+            size_t pp_idx = query_pp_idx[qi];
+            size_t nw = (kmer_type_for(k, spaced_t) == 0)
+                ? win16[pp_idx].size() : win32[pp_idx].size();
+            for (size_t vi = 0; vi < num_volumes; vi++) {
+                for (size_t wi = 0; wi < nw; wi++) {
+                    win_jobs.push_back({merge_jobs.size(), wi});
+                }
+                merge_jobs.push_back({qi, vi});
+                win_parts.emplace_back(nw);
+            }
+        }
+
+        logger.info("Launching %zu window search job(s)...", win_jobs.size());
+        arena.execute([&] {
+            tbb::parallel_for_each(win_jobs.begin(), win_jobs.end(),
+                [&](const WindowJob& wj) {
+                    const auto& job = merge_jobs[wj.merge_idx];
+                    const auto& query = queries[job.query_idx];
+                    size_t pp_idx = query_pp_idx[job.query_idx];
+                    const auto& vd = vol_data[job.volume_idx];
+                    auto& buf = tls_bufs.local();
+                    auto& part = win_parts[wj.merge_idx][wj.window_idx];
+                    if (kmer_type_for(k, spaced_t) == 0) {
+                        part = search_volume_window<uint16_t>(
+                            query.id, win16[pp_idx][wj.window_idx], k,
+                            vd.kix, vd.kpx, vd.ksx, vd.filter, config, &buf,
+                            vd.subjects.get());
+                    } else {
+                        part = search_volume_window<uint32_t>(
+                            query.id, win32[pp_idx][wj.window_idx], k,
+                            vd.kix, vd.kpx, vd.ksx, vd.filter, config, &buf,
+                            vd.subjects.get());
+                    }
+                });
+
+            tbb::parallel_for(size_t(0), merge_jobs.size(), [&](size_t mi) {
+                const auto& job = merge_jobs[mi];
+                const auto& query = queries[job.query_idx];
+                size_t pp_idx = query_pp_idx[job.query_idx];
+                const auto& vd = vol_data[job.volume_idx];
+                SearchResult sr;
+                if (kmer_type_for(k, spaced_t) == 0) {
+                    sr = merge_window_results<uint16_t>(
+                        query.id, win16[pp_idx], win_parts[mi], k, config);
+                } else {
+                    sr = merge_window_results<uint32_t>(
+                        query.id, win32[pp_idx], win_parts[mi], k, config);
+                }
+                std::vector<SearchResult>().swap(win_parts[mi]);
+                if (!sr.hits.empty()) {
+                    auto& local_hits = tls_hits.local();
+                    collect_hits(sr, vd.ksx, vd.volume_index,
+                                 query.sequence, local_hits);
+                }
+            });
+        });
+    }
+
     // Merge thread-local hits
     std::vector<OutputHit> all_hits;
     tls_hits.combine_each([&all_hits](std::vector<OutputHit>& local) {
@@ -1074,6 +1386,7 @@ int main(int argc, char* argv[]) {
     // Stage 3 alignment (mode 3 only)
     if (config.mode == 3) {
         logger.info("Running Stage 3 alignment on %zu hits...", all_hits.size());
+        stage3_config.band_margin = config.stage2.max_gap;
         all_hits = run_stage3(all_hits, queries, db_path, stage3_config,
                               ctx_param.is_ratio, ctx_param.ratio, ctx_param.abs,
                               logger);
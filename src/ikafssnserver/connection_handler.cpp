@@ -55,7 +55,7 @@ void handle_connection(
         logger.debug("Search request: db=%s, k=%d, %zu queries, %zu seqids, mode=%d",
                       req.db.c_str(), req.k, req.queries.size(), req.seqids.size(), req.mode);
 
-        SearchResponse resp = process_search_request(req, *db, server, arena);
+        SearchResponse resp = process_search_request(req, *db, server, arena, logger);
 
         auto resp_payload = serialize(resp);
         if (!write_frame(client_fd, MsgType::kSearchResponse, resp_payload)) {
@@ -37,19 +37,27 @@ static void print_usage(const char* prog) {
         "  -max_queue_size <int>    Max concurrent query sequences globally (default: 1024)\n"
         "  -max_seqs_per_req <int>  Max sequences accepted per request (default: thread count)\n"
         "  -pid <path>              PID file path\n"
-        "  -db <path>               BLAST DB path for mode 3 (repeatable, paired with -ix;\n"
+        "  -db <path>               BLAST DB path for mode 3 and Stage 2 rescan (repeatable, paired with -ix;\n"
         "                           default: same as corresponding -ix prefix)\n"
         "  -stage2_min_score <int>  Default minimum chain score (default: 0 = adaptive)\n"
         "  -stage2_max_gap <int>    Default chaining gap tolerance (default: 100)\n"
-        "  -stage2_max_lookback <int>  Default chaining DP lookback window (default: 64, 0=unlimited)\n"
+        "  -stage2_max_lookback <int>  Default chaining DP lookback window (default: 0=exact, no window)\n"
         "  -stage2_max_nhit_per_subject <int>  Default max chains per subject (default: 1, 0=unlimited)\n"
         "  -stage1_max_freq <num>   Default high-freq k-mer skip threshold (default: 0.5)\n"
         "                           0 < x < 1: fraction of total NSEQ across all volumes\n"
         "                           1 or 1.0: disable high-freq filtering entirely\n"
         "                           > 1: absolute count threshold; 0 = auto\n"
         "  -stage2_min_diag_hits <int>  Default diagonal filter min hits (default: 1)\n"
+        "  -stage2_engine <auto|kpx|rescan>  Stage 2 hit source: .kpx position lists or\n"
+        "                           rescan of candidate sequences from -db (default: auto)\n"
+        "  -stage2_rescan_degen_expand <int>  Degenerate subject expansion for rescan;\n"
+        "                           must match ikafssnindex -max_degen_expand (default: 4)\n"
         "  -stage1_topn <int>       Default Stage 1 candidate limit (default: 0)\n"
         "  -stage1_min_score <num>  Default Stage 1 minimum score; integer or 0<P<1 fraction (default: 0.5)\n"
+        "  -stage1_max_postings <int>  Rare-first k-mer selection: posting-decode budget\n"
+        "                           per query strand, 0=unlimited (default: 0)\n"
+        "  -stage1_target_coverage <num>  Rare-first k-mer selection: query position\n"
+        "                           coverage target, 0=disabled (default: 0)\n"
         "  -num_results <int>       Default max results per query (default: 0)\n"
         "  -accept_qdegen <0|1>     Default accept queries with degenerate bases (default: 1)\n"
         "  -context <value>         Default context extension (int=bases, decimal=ratio, default: 2.0)\n"
@@ -58,9 +66,17 @@ static void print_usage(const char* prog) {
         "  -stage3_gapext <int>     Default gap extension penalty (default: 1)\n"
         "  -stage3_min_ppositive <num> Default min percent positive (default: 0)\n"
         "  -max_degen_expand <int>  Max degenerate expansion per k-mer (default: 16, max: 256, 0/1: disable)\n"
+        "  -dust_level <int>        DUST low-complexity query masking level, 0=disabled (default: 0; dustmasker: 20)\n"
+        "  -prefetch_distance <int> Posting prefetch look-ahead in k-mers, 0=disabled (default: 16)\n"
         "  -stage3_min_npositive <int> Default min positive-scoring positions (default: 0)\n"
         "  -stage3_score_matrix <name> Default score matrix: degmatch, dnafull, nuc44 (default: degmatch)\n"
+        "  -stage3_engine <parasail|edit>  Default alignment engine (default: parasail)\n"
         "  -stage3_fetch_threads <int>  Threads for BLAST DB fetch (default: min(8, threads))\n"
+        "  -stage3_ungapped <0|1>   Align single-diagonal chains without gaps (default: 1)\n"
+        "  -stage3_prefilter <0|1>  Skip traceback of hits that cannot pass min_npositive/min_ppositive (default: 1)\n"
+        "  -stage3_banded <0|1>     Band score-only alignment around the Stage 2 chain (default: 1)\n"
+        "  -stage3_batch_min_hits <int>  Batch score-only alignment of this many hits\n"
+        "                           on one subject region, 0=disabled (default: 8)\n"
         "  -memory_limit <size>     madvise WILLNEED budget (default: half of RAM)\n"
         "                           Accepts K, M, G suffixes\n"
         "  -shutdown_timeout <int>  Graceful shutdown timeout in seconds (default: 30)\n"
@@ -165,7 +181,7 @@ int main(int argc, char* argv[]) {
     config.search_config.stage2.max_gap =
         static_cast<uint32_t>(cli.get_int("-stage2_max_gap", 100));
     config.search_config.stage2.chain_max_lookback =
-        static_cast<uint32_t>(cli.get_int("-stage2_max_lookback", 64));
+        static_cast<uint32_t>(cli.get_int("-stage2_max_lookback", 0));
     config.search_config.stage2.max_nhit_per_subject =
         static_cast<uint32_t>(cli.get_int("-stage2_max_nhit_per_subject", 1));
     config.search_config.stage2.min_diag_hits =
@@ -184,11 +200,69 @@ int main(int argc, char* argv[]) {
         }
         config.search_config.max_degen_expand = static_cast<uint16_t>(mde);
     }
+    {
+        int dl = cli.get_int("-dust_level", 0);
+        if (dl < 0 || dl > 1000) {
+            std::fprintf(stderr, "Error: -dust_level must be between 0 and 1000\n");
+            return 1;
+        }
+        config.search_config.dust_level = static_cast<uint16_t>(dl);
+    }
+    {
+        double mp = cli.get_double("-stage1_max_postings", 0);
+        if (mp < 0) {
+            std::fprintf(stderr, "Error: -stage1_max_postings must be >= 0\n");
+            return 1;
+        }
+        config.search_config.stage1_max_postings = static_cast<uint64_t>(mp);
+        config.search_config.stage1_target_coverage =
+            cli.get_double("-stage1_target_coverage", 0);
+        if (config.search_config.stage1_target_coverage < 0 ||
+            config.search_config.stage1_target_coverage > 1) {
+            std::fprintf(stderr, "Error: -stage1_target_coverage must be between 0 and 1\n");
+            return 1;
+        }
+    }
+    {
+        int pd = cli.get_int("-prefetch_distance", 16);
+        if (pd < 0) {
+            std::fprintf(stderr, "Error: -prefetch_distance must be >= 0\n");
+            return 1;
+        }
+        config.search_config.stage1.prefetch_distance = static_cast<uint32_t>(pd);
+    }
+    {
+        std::string engine = cli.get_string("-stage2_engine", "auto");
+        if (engine == "auto") config.search_config.stage2_engine = 0;
+        else if (engine == "kpx") config.search_config.stage2_engine = 1;
+        else if (engine == "rescan") config.search_config.stage2_engine = 2;
+        else {
+            std::fprintf(stderr, "Error: -stage2_engine must be auto, kpx, or rescan\n");
+            return 1;
+        }
+        int de = cli.get_int("-stage2_rescan_degen_expand", 4);
+        if (de < 0 || de > 256) {
+            std::fprintf(stderr, "Error: -stage2_rescan_degen_expand must be between 0 and 256\n");
+            return 1;
+        }
+        config.search_config.subject_max_degen_expand = static_cast<uint16_t>(de);
+    }
 
     // Stage 3 config
     config.stage3_config.gapopen = cli.get_int("-stage3_gapopen", 10);
     config.stage3_config.gapext = cli.get_int("-stage3_gapext", 1);
     config.stage3_config.traceback = (cli.get_int("-stage3_traceback", 0) != 0);
+    config.stage3_config.ungapped = (cli.get_int("-stage3_ungapped", 1) != 0);
+    config.stage3_config.prefilter = (cli.get_int("-stage3_prefilter", 1) != 0);
+    config.stage3_config.banded = (cli.get_int("-stage3_banded", 1) != 0);
+    if (cli.has("-stage3_batch_min_hits")) {
+        int batch_min_hits = cli.get_int("-stage3_batch_min_hits", 8);
+        if (batch_min_hits < 0) {
+            std::fprintf(stderr, "Error: -stage3_batch_min_hits must be >= 0\n");
+            return 1;
+        }
+        config.stage3_config.batch_min_hits = static_cast<uint32_t>(batch_min_hits);
+    }
     config.stage3_config.min_ppositive = cli.get_double("-stage3_min_ppositive", 0.0);
     config.stage3_config.min_npositive = static_cast<uint32_t>(cli.get_int("-stage3_min_npositive", 0));
     if (cli.has("-stage3_score_matrix")) {
@@ -200,6 +274,13 @@ int main(int argc, char* argv[]) {
             return 1;
         }
     }
+    if (cli.has("-stage3_engine")) {
+        config.stage3_config.engine = cli.get_string("-stage3_engine");
+        if (config.stage3_config.engine != "parasail" && config.stage3_config.engine != "edit") {
+            std::fprintf(stderr, "Error: -stage3_engine must be parasail or edit\n");
+            return 1;
+        }
+    }
 
     // Resolve fetch_threads after num_threads is known
     int num_threads_resolved = resolve_threads(cli);
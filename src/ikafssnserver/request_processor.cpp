@@ -31,7 +31,8 @@ SearchResponse process_search_request(
     const SearchRequest& req,
     const DatabaseEntry& db,
     Server& server,
-    tbb::task_arena& arena) {
+    tbb::task_arena& arena,
+    const Logger& logger) {
 
     SearchResponse resp;
     resp.db = db.name;
@@ -110,6 +111,8 @@ SearchResponse process_search_request(
         config.strand = req.strand;
     if (req.max_degen_expand != 0)
         config.max_degen_expand = req.max_degen_expand;
+    if (req.has_dust_level)
+        config.dust_level = req.dust_level;
     config.t = t;
 
     // Resolve seed masks for spaced seed preprocessing.
@@ -158,6 +161,7 @@ SearchResponse process_search_request(
 
     // Resolve Stage 3 parameters from request (INT16_MIN = use server default)
     Stage3Config stage3_config = db.stage3_config;
+    stage3_config.band_margin = config.stage2.max_gap;
     if (req.stage3_traceback != 0)
         stage3_config.traceback = true;
     if (req.stage3_gapopen != INT16_MIN)
@@ -176,6 +180,13 @@ SearchResponse process_search_request(
             default: break;
         }
     }
+    if (req.stage3_engine != 0) {
+        switch (req.stage3_engine) {
+            case 1: stage3_config.engine = "parasail"; break;
+            case 2: stage3_config.engine = "edit"; break;
+            default: break;
+        }
+    }
 
     // Resolve context
     bool ctx_is_ratio = db.context_is_ratio;
@@ -265,6 +276,8 @@ SearchResponse process_search_request(
 
     std::vector<AcceptedQuery> accepted_queries;
     accepted_queries.reserve(static_cast<size_t>(acquired));
+    uint64_t total_dropped_kmers = 0;  // rare-first selection
+    size_t num_dropped_queries = 0;
 
     // Iterate in original order: include skipped and accepted, skip rejected
     for (size_t qi = 0; qi < req.queries.size(); qi++) {
@@ -282,6 +295,8 @@ SearchResponse process_search_request(
 
         // Preprocess this accepted query
         bool multi_degen = false;
+        uint32_t masked_positions = 0;
+        uint32_t dropped_kmers = 0;
         if (is_both_mode) {
             if (group.kmer_type == 0) {
                 query_pp_idx[qi] = pp16_cod.size();
@@ -293,6 +308,9 @@ SearchResponse process_search_request(
                     t, seed_masks_opt)});
                 multi_degen = pp16_cod.back().qdata.has_multi_degen ||
                               pp16_opt.back().qdata.has_multi_degen;
+                masked_positions = pp16_cod.back().qdata.num_masked_positions;
+                dropped_kmers = pp16_cod.back().qdata.num_dropped_kmers +
+                                pp16_opt.back().qdata.num_dropped_kmers;
             } else {
                 query_pp_idx[qi] = pp32_cod.size();
                 pp32_cod.push_back({preprocess_query<uint32_t>(
@@ -303,6 +321,9 @@ SearchResponse process_search_request(
                     t, seed_masks_opt)});
                 multi_degen = pp32_cod.back().qdata.has_multi_degen ||
                               pp32_opt.back().qdata.has_multi_degen;
+                masked_positions = pp32_cod.back().qdata.num_masked_positions;
+                dropped_kmers = pp32_cod.back().qdata.num_dropped_kmers +
+                                pp32_opt.back().qdata.num_dropped_kmers;
             }
         } else {
             if (group.kmer_type == 0) {
@@ -311,12 +332,16 @@ SearchResponse process_search_request(
                     req.queries[qi].sequence, k, all_kix, khx_ptr, config,
                     t, seed_masks)});
                 multi_degen = pp16.back().qdata.has_multi_degen;
+                masked_positions = pp16.back().qdata.num_masked_positions;
+                dropped_kmers = pp16.back().qdata.num_dropped_kmers;
             } else {
                 query_pp_idx[qi] = pp32.size();
                 pp32.push_back({preprocess_query<uint32_t>(
                     req.queries[qi].sequence, k, all_kix, khx_ptr, config,
                     t, seed_masks)});
                 multi_degen = pp32.back().qdata.has_multi_degen;
+                masked_positions = pp32.back().qdata.num_masked_positions;
+                dropped_kmers = pp32.back().qdata.num_dropped_kmers;
             }
         }
 
@@ -326,10 +351,24 @@ SearchResponse process_search_request(
         if (multi_degen) {
             qr.warnings |= kWarnMultiDegen;
         }
+        if (masked_positions > 0) {
+            qr.warnings |= kWarnLowComplexity;
+            qr.masked_positions = masked_positions;
+        }
+        if (dropped_kmers > 0) {
+            total_dropped_kmers += dropped_kmers;
+            num_dropped_queries++;
+            logger.debug("Query '%s': rare-first selection dropped %u k-mer(s)",
+                         req.queries[qi].qseqid.c_str(), dropped_kmers);
+        }
         resp.results.push_back(std::move(qr));
 
         accepted_queries.push_back({result_idx, qi});
     }
+    if (total_dropped_kmers > 0) {
+        logger.info("Rare-first selection dropped %lu k-mer(s) in %zu query(ies)",
+                    static_cast<unsigned long>(total_dropped_kmers), num_dropped_queries);
+    }
 
     // Thread-local Stage1Buffer to avoid per-job allocation
     uint32_t max_num_seqs = 0;
@@ -341,42 +380,39 @@ SearchResponse process_search_request(
             max_num_seqs = std::max(max_num_seqs, vol.kix.num_sequences());
     }
 
-    // Determine optimal tier from actual preprocessed k-mer counts
+    // Determine optimal tier from actual preprocessed k-mer counts and
+    // query positions
     uint32_t max_kmer_positions = 0;
+    uint32_t max_position_value = 0;
     if (is_both_mode) {
-        for (const auto& pp : pp16_cod) {
-            max_kmer_positions = std::max(max_kmer_positions,
-                static_cast<uint32_t>(std::max(pp.qdata.fwd_positions.size(),
-                                               pp.qdata.rc_positions.size())));
-        }
-        for (const auto& pp : pp16_opt) {
-            max_kmer_positions = std::max(max_kmer_positions,
-                static_cast<uint32_t>(std::max(pp.qdata.fwd_positions.size(),
-                                               pp.qdata.rc_positions.size())));
-        }
-        for (const auto& pp : pp32_cod) {
-            max_kmer_positions = std::max(max_kmer_positions,
-                static_cast<uint32_t>(std::max(pp.qdata.fwd_positions.size(),
-                                               pp.qdata.rc_positions.size())));
-        }
-        for (const auto& pp : pp32_opt) {
-            max_kmer_positions = std::max(max_kmer_positions,
-                static_cast<uint32_t>(std::max(pp.qdata.fwd_positions.size(),
-                                               pp.qdata.rc_positions.size())));
-        }
+        // Stage 1 scores are summed over both templates
+        auto both_positions = [&](const auto& cod, const auto& opt) {
+            for (size_t i = 0; i < cod.size(); i++) {
+                max_kmer_positions = std::max(max_kmer_positions,
+                    static_cast<uint32_t>(std::max(
+                        cod[i].qdata.fwd_positions.size() + opt[i].qdata.fwd_positions.size(),
+                        cod[i].qdata.rc_positions.size() + opt[i].qdata.rc_positions.size())));
+                max_position_value = std::max({max_position_value,
+                    max_query_position(cod[i].qdata), max_query_position(opt[i].qdata)});
+            }
+        };
+        both_positions(pp16_cod, pp16_opt);
+        both_positions(pp32_cod, pp32_opt);
     } else {
         for (const auto& pp : pp16) {
             max_kmer_positions = std::max(max_kmer_positions,
                 static_cast<uint32_t>(std::max(pp.qdata.fwd_positions.size(),
                                                pp.qdata.rc_positions.size())));
+            max_position_value = std::max(max_position_value, max_query_position(pp.qdata));
         }
         for (const auto& pp : pp32) {
             max_kmer_positions = std::max(max_kmer_positions,
                 static_cast<uint32_t>(std::max(pp.qdata.fwd_positions.size(),
                                                pp.qdata.rc_positions.size())));
+            max_position_value = std::max(max_position_value, max_query_position(pp.qdata));
         }
     }
-    Stage1Tier tier = select_tier(max_kmer_positions, max_kmer_positions);
+    Stage1Tier tier = select_tier(max_kmer_positions, max_position_value);
 
     tbb::enumerable_thread_specific<Stage1Buffer> tls_bufs(
         [max_num_seqs, tier]() {
@@ -386,15 +422,6 @@ SearchResponse process_search_request(
             return buf;
         });
 
-    // For both mode: second thread-local buffer for optimal template
-    tbb::enumerable_thread_specific<Stage1Buffer> tls_bufs_opt(
-        [max_num_seqs, tier]() {
-            Stage1Buffer buf;
-            buf.tier = tier;
-            buf.ensure_capacity(max_num_seqs);
-            return buf;
-        });
-
     // Thread-local hit collection: (result_idx, ResponseHit) pairs
     tbb::combinable<std::vector<std::pair<size_t, ResponseHit>>> tls_hits;
 
@@ -413,6 +440,7 @@ SearchResponse process_search_request(
                     const auto& aq = accepted_queries[i];
                     const auto& query = req.queries[aq.query_idx];
                     size_t pp_idx = query_pp_idx[aq.query_idx];
+                    ScoreFloor score_floor;
 
                     for (size_t vol_i = 0; vol_i < num_volumes; vol_i++) {
                         // Use coding group's ksx for accession lookup (both modes share the same DB)
@@ -426,7 +454,6 @@ SearchResponse process_search_request(
 
                         SearchResult sr;
                         if (is_both_mode) {
-                            auto& buf_opt = tls_bufs_opt.local();
                             const auto& vd_cod = group_cod->volumes[vol_i];
                             const auto& vd_opt = group_opt->volumes[vol_i];
                             if (group.kmer_type == 0) {
@@ -436,7 +463,7 @@ SearchResponse process_search_request(
                                     k, vd_cod.kix, vd_cod.kpx,
                                     vd_opt.kix, vd_opt.kpx,
                                     vd_cod.ksx, oid_filter, config,
-                                    &buf, &buf_opt);
+                                    &buf, &score_floor);
                             } else {
                                 sr = search_volume_both<uint32_t>(
                                     query.qseqid,
@@ -444,17 +471,19 @@ SearchResponse process_search_request(
                                     k, vd_cod.kix, vd_cod.kpx,
                                     vd_opt.kix, vd_opt.kpx,
                                     vd_cod.ksx, oid_filter, config,
-                                    &buf, &buf_opt);
+                                    &buf, &score_floor);
                             }
                         } else {
                             if (group.kmer_type == 0) {
                                 sr = search_volume<uint16_t>(
                                     query.qseqid, pp16[pp_idx].qdata, k,
-                                    vol.kix, vol.kpx, vol.ksx, oid_filter, config, &buf);
+                                    vol.kix, vol.kpx, vol.ksx, oid_filter, config, &buf,
+                                    vol.subjects.get(), &score_floor);
                             } else {
                                 sr = search_volume<uint32_t>(
                                     query.qseqid, pp32[pp_idx].qdata, k,
-                                    vol.kix, vol.kpx, vol.ksx, oid_filter, config, &buf);
+                                    vol.kix, vol.kpx, vol.ksx, oid_filter, config, &buf,
+                                    vol.subjects.get(), &score_floor);
                             }
                         }
 
@@ -532,7 +561,7 @@ SearchResponse process_search_request(
         }
 
         Logger logger(Logger::kInfo);
-        output_hits = run_stage3(output_hits, fasta_queries, db.db_path,
+        output_hits = run_stage3(output_hits, fasta_queries, *db.stage3_readers,
                                  stage3_config, ctx_is_ratio, ctx_ratio, ctx_abs, logger);
 
         // Write back to ResponseHit
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -10,6 +11,7 @@
 #include "index/kpx_reader.hpp"
 #include "index/ksx_reader.hpp"
 #include "index/khx_reader.hpp"
+#include "io/blastdb_subject_source.hpp"
 #include "search/oid_filter.hpp"
 #include "search/volume_searcher.hpp"
 #include "search/stage3_alignment.hpp"
@@ -29,6 +31,7 @@ struct ServerVolumeData {
     KsxReader ksx;
     uint16_t volume_index;
     uint64_t total_bases = 0;
+    std::unique_ptr<BlastDbSubjectSource> subjects;  // Stage 2 rescan (optional)
 };
 
 // A group of volumes for a specific k-mer size
@@ -43,11 +46,13 @@ struct KmerGroup {
 
 // Process a search request using loaded index data from a specific database.
 // Acquires per-sequence permits via server semaphore; rejected queries
-// are returned in resp.rejected_qseqids for client retry.
+// are returned in resp.rejected_qseqids for client retry. K-mers dropped
+// by rare-first selection are reported through logger.
 SearchResponse process_search_request(
     const SearchRequest& req,
     const DatabaseEntry& db,
     Server& server,
-    tbb::task_arena& arena);
+    tbb::task_arena& arena,
+    const Logger& logger);
 
 } // namespace ikafssn
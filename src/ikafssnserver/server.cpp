@@ -3,6 +3,8 @@
 #include "core/config.hpp"
 #include "core/spaced_seed.hpp"
 #include "core/version.hpp"
+#include "index/kix_format.hpp"
+#include "io/blastdb_reader.hpp"
 #include "io/volume_discovery.hpp"
 #include "util/common_init.hpp"
 #include "util/socket_utils.hpp"
@@ -51,6 +53,9 @@ bool Server::load_database(const std::string& ix_prefix, const std::string& db_p
     entry.ix_prefix = ix_prefix;
     entry.db_path = db_path;
     entry.max_mode = db_path.empty() ? 2 : 3;
+    if (!db_path.empty()) {
+        entry.stage3_readers = std::make_unique<BlastDbReaderPool>(db_path);
+    }
 
     bool all_have_kpx = true;
 
@@ -100,10 +105,43 @@ bool Server::load_database(const std::string& ix_prefix, const std::string& db_p
         group.volumes.push_back(std::move(svd));
     }
 
-    // Restrict max_mode if .kpx files are missing (mode 1 index)
-    if (!all_have_kpx) {
+    // Stage 2 subject rescan: contiguous non-canonical groups read candidate
+    // sequences from the BLAST DB volume of the same index (volume-local OIDs)
+    bool all_rescan = false;
+    if (!db_path.empty() && config.search_config.stage2_engine != 1) {
+        auto blast_vols = BlastDbReader::find_volume_paths(db_path);
+        all_rescan = !blast_vols.empty();
+        for (auto& group : entry.kmer_groups) {
+            bool capable = !blast_vols.empty() && group.t == 0;
+            for (const auto& vol : group.volumes) {
+                if ((vol.kix.header().flags & KIX_FLAG_CANONICAL) ||
+                    vol.volume_index >= blast_vols.size()) {
+                    capable = false;
+                }
+            }
+            if (!capable) {
+                all_rescan = false;
+                continue;
+            }
+            for (auto& vol : group.volumes) {
+                vol.subjects = std::make_unique<BlastDbSubjectSource>();
+                if (!vol.subjects->open(blast_vols[vol.volume_index])) {
+                    logger.error("Cannot open BLAST DB volume %s",
+                                 blast_vols[vol.volume_index].c_str());
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Restrict max_mode if .kpx files are missing (mode 1 index) and Stage 2
+    // cannot rescan subject sequences instead
+    if (!all_have_kpx && !all_rescan) {
         entry.max_mode = 1;
         logger.info("DB '%s': .kpx files missing, max_mode restricted to 1", db_name.c_str());
+    } else if (!all_have_kpx) {
+        logger.info("DB '%s': .kpx files missing, Stage 2 rescans BLAST DB sequences",
+                    db_name.c_str());
     }
 
     // Sort volumes within each group, then open shared .khx per group
@@ -343,6 +381,9 @@ int Server::run(const ServerConfig& config_in) {
                      max_queue_size_, max_seqs_per_req_);
     }
 
+    logger.info("Prefetch distance: %u k-mer(s)%s", config.search_config.stage1.prefetch_distance,
+                config.search_config.stage1.prefetch_distance == 0 ? " (disabled)" : "");
+
     // Log total mmap count
     size_t total_mmaps = 0;
     for (const auto& db : databases_) {
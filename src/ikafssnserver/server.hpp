@@ -2,6 +2,7 @@
 
 #include <atomic>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
@@ -9,6 +10,7 @@
 #include <vector>
 
 #include "ikafssnserver/request_processor.hpp"
+#include "io/blastdb_reader_pool.hpp"
 #include "search/stage3_alignment.hpp"
 #include "search/volume_searcher.hpp"
 #include "util/logger.hpp"
@@ -20,6 +22,7 @@ struct DatabaseEntry {
     std::string name;                       // DB name (basename of ix_prefix)
     std::string ix_prefix;                  // original (for logging)
     std::string db_path;                    // BLAST DB path (empty = max_mode 2)
+    std::unique_ptr<BlastDbReaderPool> stage3_readers;  // opened on first mode 3 request
     std::vector<KmerGroup> kmer_groups;
     int default_k = 0;                      // largest k for this DB
     uint8_t default_t = 0;
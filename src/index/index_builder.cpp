@@ -32,6 +32,7 @@
 namespace ikafssn {
 
 // Temporary entry for posting buffer.
+// In canonical mode, pos holds (pos << 1) | strand_bit.
 struct TempEntry {
     uint32_t kmer_value;
     uint32_t seq_id;
@@ -67,7 +68,8 @@ bool build_index(BlastDbReader& db,
     const int k = config.k;
     const uint32_t num_seqs = db.num_sequences();
 
-    logger.info("Building index: k=%d, sequences=%u", k, num_seqs);
+    logger.info("Building index: k=%d, sequences=%u%s", k, num_seqs,
+                config.canonical ? " (canonical)" : "");
 
     // File paths (.tmp during construction, renamed to final on success)
     std::string ksx_tmp = output_prefix + ".ksx.tmp";
@@ -88,6 +90,12 @@ bool build_index(BlastDbReader& db,
         for (uint32_t oid = 0; oid < num_seqs; oid++) {
             uint32_t slen = db.seq_length(oid);
             std::string acc = db.get_accession(oid);
+            // Canonical positions are stored as (pos << 1) | strand_bit
+            if (config.canonical && slen > (uint32_t(1) << 31)) {
+                logger.error("Sequence %s is %u bp; canonical indexes hold "
+                             "sequences of at most 2^31 bp", acc.c_str(), slen);
+                return false;
+            }
             ksx.add_sequence(slen, acc);
             prog.update(oid + 1);
         }
@@ -141,6 +149,19 @@ bool build_index(BlastDbReader& db,
                                     });
                             },
                             config.max_degen_expand);
+                    } else if (config.canonical) {
+                        scanner.scan(raw.ncbi2na_data, raw.seq_length, ambig,
+                            [&my_counts, k](uint32_t /*pos*/, KmerInt kmer) {
+                                my_counts[kmer_canonical(kmer, k)]++;
+                            },
+                            [&my_counts, k](uint32_t /*pos*/, KmerInt base_kmer,
+                                            const AmbigInfo* infos, int count) {
+                                expand_ambig_kmer_multi<KmerInt>(base_kmer, infos, count,
+                                    [&my_counts, k](KmerInt expanded) {
+                                        my_counts[kmer_canonical(expanded, k)]++;
+                                    });
+                            },
+                            config.max_degen_expand);
                     } else {
                         scanner.scan(raw.ncbi2na_data, raw.seq_length, ambig,
                             [&my_counts](uint32_t /*pos*/, KmerInt kmer) {
@@ -275,20 +296,26 @@ bool build_index(BlastDbReader& db,
                 for (uint32_t oid = range.begin(); oid < range.end(); oid++) {
                     auto raw = db.get_raw_sequence(oid);
                     auto ambig = AmbiguityParser::parse(raw.ambig_data, raw.ambig_bytes);
-                    auto normal_cb = [&](uint32_t pos, KmerInt kmer) {
+                    auto push_entry = [&](uint32_t pos, KmerInt kmer) {
+                        uint32_t stored_pos = pos;
+                        if (config.canonical) {
+                            bool is_rc;
+                            kmer = kmer_canonical(kmer, k, &is_rc);
+                            stored_pos = (pos << 1) | (is_rc ? 1u : 0u);
+                        }
                         uint32_t kval = static_cast<uint32_t>(kmer);
                         if (counts[kval] == 0) return;
                         if (static_cast<int>(partition_of(kval, partition_bits, effective_bits)) != p) return;
-                        my_buffer.push_back({kval, oid, pos});
+                        my_buffer.push_back({kval, oid, stored_pos});
+                    };
+                    auto normal_cb = [&](uint32_t pos, KmerInt kmer) {
+                        push_entry(pos, kmer);
                     };
                     auto ambig_cb = [&](uint32_t pos, KmerInt base_kmer,
                                         const AmbigInfo* infos, int count) {
                         expand_ambig_kmer_multi<KmerInt>(base_kmer, infos, count,
                             [&](KmerInt expanded) {
-                                uint32_t kval = static_cast<uint32_t>(expanded);
-                                if (counts[kval] == 0) return;
-                                if (static_cast<int>(partition_of(kval, partition_bits, effective_bits)) != p) return;
-                                my_buffer.push_back({kval, oid, pos});
+                                push_entry(pos, expanded);
                             });
                     };
                     if (config.t > 0) {
@@ -384,6 +411,10 @@ bool build_index(BlastDbReader& db,
                     uint32_t val;
                     if (new_seq) {
                         val = buffer[e].pos; // raw position (delta reset)
+                    } else if (config.canonical) {
+                        // Delta of positions, strand bit kept in LSB
+                        val = (((buffer[e].pos >> 1) - (prev_pos >> 1)) << 1)
+                              | (buffer[e].pos & 1u);
                     } else {
                         val = buffer[e].pos - prev_pos; // delta
                     }
@@ -449,7 +480,8 @@ bool build_index(BlastDbReader& db,
         kix_hdr.kmer_type = kmer_type_for(k, config.t);
         kix_hdr.num_sequences = num_seqs;
         kix_hdr.total_postings = total_postings;
-        kix_hdr.flags = KIX_FLAG_HAS_KSX | (kix_offset32 ? KIX_FLAG_OFFSET32 : 0);
+        kix_hdr.flags = KIX_FLAG_HAS_KSX | (kix_offset32 ? KIX_FLAG_OFFSET32 : 0)
+                      | (config.canonical ? KIX_FLAG_CANONICAL : 0);
         kix_hdr.volume_index = volume_index;
         kix_hdr.total_volumes = total_volumes;
         size_t name_len = std::min(db_name.size(), size_t(32));
@@ -496,6 +528,7 @@ bool build_index(BlastDbReader& db,
         kpx_hdr.template_type = config.template_type;
         kpx_hdr.total_postings = total_postings;
         kpx_hdr.offset_type = kpx_offset32 ? 0 : 1;
+        kpx_hdr.flags = config.canonical ? KPX_FLAG_STRAND_BIT : 0;
         std::fwrite(&kpx_hdr, sizeof(kpx_hdr), 1, wr);
 
         if (kpx_offset32) {
@@ -19,6 +19,7 @@ struct IndexBuilderConfig {
     int max_degen_expand = 4;           // max degenerate expansion per k-mer (0/1: disable)
     uint8_t t = 0;                      // template length (0=contiguous, 16/18/21=spaced)
     uint8_t template_type = 0;          // TemplateType enum value
+    bool canonical = false;             // true: store min(kmer, revcomp) with strand bit (t=0 only)
 };
 
 // Build .kix, .kpx, .ksx index files for a single BLAST DB volume.
@@ -151,6 +151,7 @@ static bool write_filtered_kpx(
     kpx_hdr.template_type = kpx_in.header().template_type;
     kpx_hdr.total_postings = new_total_postings;
     kpx_hdr.offset_type = use_offset32 ? 0 : 1;
+    kpx_hdr.flags = kpx_in.header().flags;
 
     std::fwrite(&kpx_hdr, sizeof(kpx_hdr), 1, kpx_fp);
 
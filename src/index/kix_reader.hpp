@@ -5,6 +5,7 @@
 #include <vector>
 #include "io/mmap_file.hpp"
 #include "index/kix_format.hpp"
+#include "core/prefetch.hpp"
 
 namespace ikafssn {
 
@@ -37,6 +38,17 @@ public:
         return offsets64_[kmer];
     }
 
+    // Prefetch the offset table entries for a k-mer (offsets[kmer], offsets[kmer+1]).
+    void prefetch_offset(uint32_t kmer) const {
+        if (offset32_) prefetch_read(offsets32_ + kmer);
+        else prefetch_read(offsets64_ + kmer);
+    }
+
+    // Prefetch the head of a k-mer's ID posting list (reads its offset entry).
+    void prefetch_posting(uint32_t kmer) const {
+        prefetch_read(posting_data_ + posting_offset(kmer));
+    }
+
     // Byte length of posting data for a k-mer
     uint64_t posting_byte_length(uint32_t kmer) const {
         return posting_offset(kmer + 1) - posting_offset(kmer);
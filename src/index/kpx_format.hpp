@@ -6,6 +6,13 @@ namespace ikafssn {
 
 inline constexpr char KPX_MAGIC[4] = {'K', 'M', 'P', 'X'};
 
+// Flag bits
+// KPX_FLAG_STRAND_BIT: each position value carries a strand bit in its LSB,
+// i.e. raw = (pos << 1) | strand and delta = ((pos - prev_pos) << 1) | strand,
+// where strand=1 means the stored canonical k-mer is the reverse complement
+// of the subject's forward k-mer at pos. Set for canonical indexes.
+inline constexpr uint8_t KPX_FLAG_STRAND_BIT = 0x01;
+
 #pragma pack(push, 1)
 struct KpxHeader {
     char     magic[4];        // 0x00: "KMPX"
@@ -15,7 +22,8 @@ struct KpxHeader {
     uint64_t total_postings;  // 0x08
     uint8_t  template_type;   // 0x10: TemplateType enum value (0=contiguous)
     uint8_t  offset_type;     // 0x11: 0=uint32 offsets, 1=uint64 offsets
-    uint8_t  reserved2[14];   // 0x12
+    uint8_t  flags;           // 0x12: KPX_FLAG_* bits
+    uint8_t  reserved2[13];   // 0x13
 };
 #pragma pack(pop)
 
@@ -4,6 +4,7 @@
 #include <string>
 #include "io/mmap_file.hpp"
 #include "index/kpx_format.hpp"
+#include "core/prefetch.hpp"
 
 namespace ikafssn {
 
@@ -30,6 +31,17 @@ public:
         return pos_offsets64_[kmer];
     }
 
+    // Prefetch the pos_offsets entry for a k-mer.
+    void prefetch_offset(uint32_t kmer) const {
+        if (offset32_) prefetch_read(pos_offsets32_ + kmer);
+        else prefetch_read(pos_offsets64_ + kmer);
+    }
+
+    // Prefetch the head of a k-mer's position posting list.
+    void prefetch_posting(uint32_t kmer) const {
+        prefetch_read(posting_data_ + pos_offset(kmer));
+    }
+
     // madvise budget API
     size_t willneed_size() const;
     void apply_madvise(bool willneed);
@@ -136,25 +136,33 @@ std::string BlastDbReader::get_sequence(uint32_t oid) const {
 }
 
 std::string BlastDbReader::get_subsequence(uint32_t oid, uint32_t start, uint32_t end) const {
-    if (!impl_->db) return {};
+    std::string result;
+    get_subsequence(oid, start, end, result);
+    return result;
+}
+
+bool BlastDbReader::get_subsequence(uint32_t oid, uint32_t start, uint32_t end,
+                                    std::string& result) const {
+    result.clear();
+    if (!impl_->db) return false;
 
     RawSequence raw = get_raw_sequence(oid);
     if (!raw.ncbi2na_data || raw.seq_length == 0) {
         if (raw.ncbi2na_data) ret_raw_sequence(raw);
-        return {};
+        return false;
     }
 
     // Clamp end to seq_length - 1
     if (end >= raw.seq_length) end = raw.seq_length - 1;
     if (start > end) {
         ret_raw_sequence(raw);
-        return {};
+        return false;
     }
 
     uint32_t len = end - start + 1;
 
     // Decode ncbi2na packed data for [start, end] only
-    std::string result(len, '\0');
+    result.resize(len);
     for (uint32_t i = start; i <= end; i++) {
         uint8_t byte = static_cast<uint8_t>(raw.ncbi2na_data[i >> 2]);
         uint8_t code = (byte >> (6 - 2 * (i & 3))) & 0x03;
@@ -200,7 +208,7 @@ std::string BlastDbReader::get_subsequence(uint32_t oid, uint32_t start, uint32_
     }
 
     ret_raw_sequence(raw);
-    return result;
+    return true;
 }
 
 std::string BlastDbReader::get_accession(uint32_t oid) const {
@@ -47,6 +47,11 @@ public:
     // Returns empty string if start > end (after clamping) or on error.
     std::string get_subsequence(uint32_t oid, uint32_t start, uint32_t end) const;
 
+    // As above, decoding into out (reusing its capacity).
+    // Returns false, with out empty, where the above returns an empty string.
+    bool get_subsequence(uint32_t oid, uint32_t start, uint32_t end,
+                         std::string& out) const;
+
     // Raw sequence data from BLAST DB (ncbi2na packed + ambiguity data).
     // Pointers are into mmap region; call ret_raw_sequence() when done.
     struct RawSequence {
@@ -0,0 +1,64 @@
+#include "io/blastdb_reader_pool.hpp"
+
+namespace ikafssn {
+
+bool BlastDbReaderPool::ensure_open(const Logger& logger) {
+    if (opened_.load(std::memory_order_acquire)) return true;
+
+    std::lock_guard<std::mutex> lock(open_mutex_);
+    if (opened_.load(std::memory_order_relaxed)) return true;
+
+    auto vol_paths = BlastDbReader::find_volume_paths(db_path_);
+    if (vol_paths.empty()) {
+        logger.error("Stage 3: no BLAST DB volumes found at '%s'", db_path_.c_str());
+        return false;
+    }
+
+    std::vector<BlastDbReader> readers(vol_paths.size());
+    for (size_t vi = 0; vi < vol_paths.size(); vi++) {
+        if (!readers[vi].open(vol_paths[vi])) {
+            logger.error("Stage 3: cannot open volume '%s'", vol_paths[vi].c_str());
+            return false;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> hlock(handles_mutex_);
+        handles_ = std::vector<Handles>(vol_paths.size());
+    }
+    vol_paths_ = std::move(vol_paths);
+    readers_ = std::move(readers);
+    opened_.store(true, std::memory_order_release);
+    return true;
+}
+
+std::unique_ptr<BlastDbReader> BlastDbReaderPool::acquire(size_t vi, size_t max_handles) {
+    {
+        std::lock_guard<std::mutex> lock(handles_mutex_);
+        Handles& h = handles_[vi];
+        if (!h.free.empty()) {
+            auto reader = std::move(h.free.back());
+            h.free.pop_back();
+            return reader;
+        }
+        if (h.opened >= max_handles) return nullptr;
+        h.opened++;
+    }
+
+    // Open outside the lock; other volumes' handles stay available
+    auto reader = std::make_unique<BlastDbReader>();
+    if (!reader->open(vol_paths_[vi])) {
+        std::lock_guard<std::mutex> lock(handles_mutex_);
+        handles_[vi].opened--;
+        return nullptr;
+    }
+    return reader;
+}
+
+void BlastDbReaderPool::release(size_t vi, std::unique_ptr<BlastDbReader> reader) {
+    if (!reader) return;
+    std::lock_guard<std::mutex> lock(handles_mutex_);
+    handles_[vi].free.push_back(std::move(reader));
+}
+
+} // namespace ikafssn
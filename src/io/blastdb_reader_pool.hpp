@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "io/blastdb_reader.hpp"
+#include "util/logger.hpp"
+
+namespace ikafssn {
+
+// All volumes of one BLAST DB, opened on first use and kept open across
+// Stage 3 runs (ikafssnserver keeps one per database). The readers are
+// only read from, so concurrent fetches share them, as BlastDbSubjectSource
+// does; ensure_open() may be called from any thread. Threads that fetch
+// many subjects of one volume can instead acquire() a private handle of
+// it, so that they do not contend inside a single CSeqDB.
+class BlastDbReaderPool {
+public:
+    explicit BlastDbReaderPool(std::string db_path) : db_path_(std::move(db_path)) {}
+
+    // Non-copyable, non-movable (owned via unique_ptr)
+    BlastDbReaderPool(const BlastDbReaderPool&) = delete;
+    BlastDbReaderPool& operator=(const BlastDbReaderPool&) = delete;
+
+    // Open every volume of the DB unless already open.
+    // Returns false (and logs) if no volume is found or one cannot be
+    // opened; a later call retries.
+    bool ensure_open(const Logger& logger);
+
+    const std::string& db_path() const { return db_path_; }
+
+    // Valid after ensure_open() returned true.
+    size_t num_volumes() const { return readers_.size(); }
+    const BlastDbReader& volume(size_t vi) const { return readers_[vi]; }
+
+    // A handle of volume vi for the calling thread only: a released one if
+    // any is free, else a newly opened one while fewer than max_handles
+    // are open for the volume. Returns nullptr (use volume(vi)) otherwise
+    // or if the open fails. Handles stay open for later calls once
+    // returned with release(). Valid after ensure_open() returned true.
+    std::unique_ptr<BlastDbReader> acquire(size_t vi, size_t max_handles);
+    void release(size_t vi, std::unique_ptr<BlastDbReader> reader);
+
+private:
+    struct Handles {
+        std::vector<std::unique_ptr<BlastDbReader>> free;
+        size_t opened = 0;
+    };
+
+    std::string db_path_;
+    std::mutex open_mutex_;
+    std::atomic<bool> opened_{false};
+    std::vector<std::string> vol_paths_;
+    std::vector<BlastDbReader> readers_;
+    std::mutex handles_mutex_;
+    std::vector<Handles> handles_;
+};
+
+} // namespace ikafssn
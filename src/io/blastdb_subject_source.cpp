@@ -0,0 +1,18 @@
+#include "io/blastdb_subject_source.hpp"
+
+namespace ikafssn {
+
+bool BlastDbSubjectSource::fetch(uint32_t oid, PackedSubject& out) const {
+    if (!db_.is_open() || oid >= db_.num_sequences()) return false;
+
+    auto raw = db_.get_raw_sequence(oid);
+    if (!raw.ncbi2na_data) return false;
+
+    out.ncbi2na.assign(raw.ncbi2na_data, raw.ncbi2na_data + raw.ncbi2na_bytes);
+    out.ambig = AmbiguityParser::parse(raw.ambig_data, raw.ambig_bytes);
+    out.length = raw.seq_length;
+    db_.ret_raw_sequence(raw);
+    return true;
+}
+
+} // namespace ikafssn
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+
+#include "io/blastdb_reader.hpp"
+#include "io/subject_source.hpp"
+
+namespace ikafssn {
+
+// SubjectSource over one BLAST DB volume (OIDs are volume-local, matching
+// the index volume built from it). Concurrent fetches share the reader,
+// as the index builder does.
+class BlastDbSubjectSource : public SubjectSource {
+public:
+    // Open the BLAST DB volume at vol_path.
+    // Returns true on success, false on error (message to stderr).
+    bool open(const std::string& vol_path) { return db_.open(vol_path); }
+
+    bool is_open() const { return db_.is_open(); }
+
+    bool fetch(uint32_t oid, PackedSubject& out) const override;
+
+private:
+    BlastDbReader db_;
+};
+
+} // namespace ikafssn
@@ -24,6 +24,7 @@ struct OutputHit {
     uint32_t chainscore = 0;
     uint16_t volume;
     uint32_t oid = 0;        // internal: BLAST DB OID (not written to output)
+    std::vector<Hit> anchors; // internal: Stage 2 chain hits (anchored Stage 3)
 
     // Stage 3 fields (populated only when mode == 3)
     int32_t alnscore = 0;
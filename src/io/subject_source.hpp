@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/ambiguity_parser.hpp"
+
+namespace ikafssn {
+
+// Packed (ncbi2na) subject sequence with its parsed ambiguity runs.
+struct PackedSubject {
+    std::vector<char> ncbi2na;            // 4 bases per byte, MSB first
+    std::vector<AmbiguityEntry> ambig;    // sorted by position
+    uint32_t length = 0;                  // sequence length in bases
+};
+
+// Source of packed subject sequences by volume-local OID, used by the
+// kpx-free Stage 2 engine. Implementations must allow concurrent fetch()
+// calls from multiple threads.
+class SubjectSource {
+public:
+    virtual ~SubjectSource() = default;
+
+    // Fetch subject oid into out (reusing its storage).
+    // Returns false if the sequence is unavailable.
+    virtual bool fetch(uint32_t oid, PackedSubject& out) const = 0;
+};
+
+} // namespace ikafssn
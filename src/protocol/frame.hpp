@@ -34,7 +34,7 @@ struct FrameHeader {
     uint32_t magic;           // FRAME_MAGIC
     uint32_t payload_size;    // payload size in bytes
     uint8_t  msg_type;        // MsgType
-    uint8_t  msg_version;     // message version (currently 8)
+    uint8_t  msg_version;     // message version (currently 9)
     uint16_t reserved;        // 0
 };
 static_assert(sizeof(FrameHeader) == 12, "FrameHeader must be 12 bytes");
@@ -52,6 +52,9 @@ struct SearchRequest {
     uint8_t  t = 0;               // template length (0/16/18/21)
     uint8_t  template_type = 0;   // 0=server default, 1=coding, 2=optimal, 3=both
     uint8_t  score_matrix = 0;   // 0=server default, 1=degmatch, 2=dnafull, 3=nuc44
+    uint16_t dust_level = 0;     // DUST masking level (see has_dust_level; 0 = disabled)
+    uint8_t  has_dust_level = 0; // 1 = dust_level was explicitly set by client
+    uint8_t  stage3_engine = 0;  // 0=server default, 1=parasail, 2=edit
     std::string db;                                // target database name (empty = error)
     std::vector<std::string> seqids;
     std::vector<QueryEntry> queries;
@@ -85,6 +88,7 @@ struct ResponseHit {
 // Per-query warning flags (bitmask)
 enum QueryWarning : uint8_t {
     kWarnMultiDegen = 0x01,  // k-mers exceeded max_degen_expand were skipped
+    kWarnLowComplexity = 0x02,  // low-complexity (DUST) query bases were masked
 };
 
 // Per-query result in the search response
@@ -93,6 +97,7 @@ struct QueryResult {
     std::vector<ResponseHit> hits;
     uint8_t skipped = 0;   // 0 = normal, 1 = skipped (degenerate bases)
     uint8_t warnings = 0;  // bitmask of QueryWarning flags
+    uint32_t masked_positions = 0;  // query bases masked by DUST (kWarnLowComplexity)
 };
 
 // Search response message (server -> client)
@@ -130,7 +130,9 @@ private:
 };
 
 // --- SearchRequest ---
-// Wire format (all fields in natural order, no backward-compat trailer):
+// Wire format (all fields in natural order, no backward-compat trailer;
+// fields inserted mid-message need a msg_version bump, see frame.cpp;
+// v9 added dust_level, has_dust_level and stage3_engine):
 //   u8   k
 //   u16  stage2_min_score
 //   u16  stage2_max_gap
@@ -160,6 +162,9 @@ private:
 //   u8   t
 //   u8   template_type
 //   u8   score_matrix
+//   u16  dust_level
+//   u8   has_dust_level
+//   u8   stage3_engine
 //   str16 db
 //   u32  num_seqids
 //     [str16 seqid] × num_seqids
@@ -199,6 +204,9 @@ std::vector<uint8_t> serialize(const SearchRequest& req) {
     put_u8(buf, req.t);
     put_u8(buf, req.template_type);
     put_u8(buf, req.score_matrix);
+    put_u16(buf, req.dust_level);
+    put_u8(buf, req.has_dust_level);
+    put_u8(buf, req.stage3_engine);
     put_str16(buf, req.db);
 
     put_u32(buf, static_cast<uint32_t>(req.seqids.size()));
@@ -253,6 +261,9 @@ bool deserialize(const std::vector<uint8_t>& data, SearchRequest& req) {
     if (!r.get_u8(req.t)) return false;
     if (!r.get_u8(req.template_type)) return false;
     if (!r.get_u8(req.score_matrix)) return false;
+    if (!r.get_u16(req.dust_level)) return false;
+    if (!r.get_u8(req.has_dust_level)) return false;
+    if (!r.get_u8(req.stage3_engine)) return false;
     if (!r.get_str16(req.db)) return false;
 
     uint32_t num_seqids;
@@ -293,6 +304,7 @@ bool deserialize(const std::vector<uint8_t>& data, SearchRequest& req) {
 //     str16 qseqid
 //     u8    skipped
 //     u8    warnings
+//     u32   masked_positions
 //     u16   num_hits
 //     for each hit:
 //       str16  sseqid
@@ -334,6 +346,7 @@ std::vector<uint8_t> serialize(const SearchResponse& resp) {
         put_str16(buf, qr.qseqid);
         put_u8(buf, qr.skipped);
         put_u8(buf, qr.warnings);
+        put_u32(buf, qr.masked_positions);
         put_u16(buf, static_cast<uint16_t>(qr.hits.size()));
         for (const auto& hit : qr.hits) {
             put_str16(buf, hit.sseqid);
@@ -387,6 +400,7 @@ bool deserialize(const std::vector<uint8_t>& data, SearchResponse& resp) {
         if (!r.get_str16(qr.qseqid)) return false;
         if (!r.get_u8(qr.skipped)) return false;
         if (!r.get_u8(qr.warnings)) return false;
+        if (!r.get_u32(qr.masked_positions)) return false;
 
         uint16_t num_hits;
         if (!r.get_u16(num_hits)) return false;
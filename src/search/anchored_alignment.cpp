@@ -0,0 +1,313 @@
+#include "search/anchored_alignment.hpp"
+
+#include <algorithm>
+#include <climits>
+
+namespace ikafssn {
+
+namespace {
+
+constexpr int NEG_INF = INT_MIN / 4;
+
+// Trace bits of one DP cell
+constexpr uint8_t kHFromE = 1;   // H taken from E (else diagonal or F)
+constexpr uint8_t kHFromF = 2;   // H taken from F
+constexpr uint8_t kEExtend = 4;  // E extended from the left E (else opened)
+constexpr uint8_t kFExtend = 8;  // F extended from the upper F (else opened)
+
+enum class SegmentMode {
+    kGlobal,     // both ends fixed (between anchors)
+    kFreeStart,  // free leading gaps, end fixed (left flank)
+    kFreeEnd,    // start fixed, free trailing gaps (right flank)
+};
+
+struct SegmentResult {
+    int score = 0;
+    int beg_q = 0, beg_r = 0;  // first aligned positions (segment coordinates)
+    int end_q = 0, end_r = 0;  // one past the last aligned positions
+};
+
+// Affine-gap DP of q[0, qn) against r[0, rn) with traceback. Appends the
+// alignment columns to ops: 'M' (both advance), 'I' (query advances) and
+// 'D' (ref advances).
+SegmentResult align_segment(const char* q, int qn, const char* r, int rn,
+                            SegmentMode mode, int gapopen, int gapext,
+                            const SubstitutionMatrix& matrix, std::string& ops) {
+    const bool free_start = (mode == SegmentMode::kFreeStart);
+    const size_t width = static_cast<size_t>(rn) + 1;
+    std::vector<uint8_t> trace((static_cast<size_t>(qn) + 1) * width, 0);
+    std::vector<int> h(width), f(width, NEG_INF);
+
+    // Row 0: leading ref gap (or free)
+    h[0] = 0;
+    int e = NEG_INF;
+    for (int j = 1; j <= rn; j++) {
+        if (free_start) {
+            h[j] = 0;
+        } else {
+            e = (j == 1) ? -gapopen : e - gapext;
+            h[j] = e;
+            trace[j] = kHFromE | (j > 1 ? kEExtend : 0);
+        }
+    }
+
+    // Free-end candidates in the last ref column
+    std::vector<int> last_col;
+    if (mode == SegmentMode::kFreeEnd) {
+        last_col.assign(static_cast<size_t>(qn) + 1, NEG_INF);
+        last_col[0] = h[rn];
+    }
+
+    int col0_f = NEG_INF;
+    for (int i = 1; i <= qn; i++) {
+        uint8_t* trow = trace.data() + static_cast<size_t>(i) * width;
+        const int* score_row = matrix.matrix +
+            matrix.mapper[static_cast<unsigned char>(q[i - 1])] * matrix.size;
+
+        int diag = h[0];
+        if (free_start) {
+            h[0] = 0;
+        } else {
+            col0_f = (i == 1) ? -gapopen : col0_f - gapext;
+            h[0] = col0_f;
+            trow[0] = kHFromF | (i > 1 ? kFExtend : 0);
+        }
+
+        e = NEG_INF;
+        for (int j = 1; j <= rn; j++) {
+            uint8_t t = 0;
+
+            // Gap in query (ref advances), from the left cell
+            int e_open = h[j - 1] - gapopen;
+            if (e - gapext > e_open) {
+                e -= gapext;
+                t |= kEExtend;
+            } else {
+                e = e_open;
+            }
+
+            // Gap in ref (query advances), from the upper cell
+            int f_open = h[j] - gapopen;
+            if (f[j] - gapext > f_open) {
+                f[j] -= gapext;
+                t |= kFExtend;
+            } else {
+                f[j] = f_open;
+            }
+
+            int best = diag + score_row[matrix.mapper[static_cast<unsigned char>(r[j - 1])]];
+            if (e > best) {
+                best = e;
+                t |= kHFromE;
+            }
+            if (f[j] > best) {
+                best = f[j];
+                t = static_cast<uint8_t>((t & ~kHFromE) | kHFromF);
+            }
+            diag = h[j];
+            h[j] = best;
+            trow[j] = t;
+        }
+        if (mode == SegmentMode::kFreeEnd) last_col[i] = h[rn];
+    }
+
+    // End cell: the corner, or for free trailing gaps the best cell of the
+    // last query row (first ref position on ties), then the last ref column
+    SegmentResult res;
+    int ei = qn, ej = rn;
+    res.score = h[rn];
+    if (mode == SegmentMode::kFreeEnd) {
+        res.score = NEG_INF;
+        for (int j = 0; j <= rn; j++) {
+            if (h[j] > res.score) {
+                res.score = h[j];
+                ej = j;
+            }
+        }
+        for (int i = 0; i <= qn; i++) {
+            if (last_col[i] > res.score) {
+                res.score = last_col[i];
+                ei = i;
+                ej = rn;
+            } else if (last_col[i] == res.score && ej == rn && i < ei) {
+                ei = i;
+            }
+        }
+    }
+    res.end_q = ei;
+    res.end_r = ej;
+
+    // Traceback (state 0: H, 1: E, 2: F)
+    std::string cols;
+    int i = ei, j = ej, state = 0;
+    while (i > 0 || j > 0) {
+        if (free_start && (i == 0 || j == 0)) break;
+        uint8_t t = trace[static_cast<size_t>(i) * width + j];
+        if (state == 0) {
+            if (t & kHFromE) {
+                state = 1;
+            } else if (t & kHFromF) {
+                state = 2;
+            } else {
+                cols += 'M';
+                i--;
+                j--;
+                continue;
+            }
+        }
+        if (state == 1) {
+            cols += 'D';
+            state = (t & kEExtend) ? 1 : 0;
+            j--;
+        } else {
+            cols += 'I';
+            state = (t & kFExtend) ? 2 : 0;
+            i--;
+        }
+    }
+    res.beg_q = i;
+    res.beg_r = j;
+    ops.append(cols.rbegin(), cols.rend());
+    return res;
+}
+
+// Exact-match run kept from the anchors
+struct AnchorRun {
+    int q;
+    int r;
+    int len;
+};
+
+std::vector<AnchorRun> collinear_runs(const std::vector<Hit>& anchors, int span,
+                                      int qlen, int rlen) {
+    std::vector<Hit> sorted(anchors);
+    std::sort(sorted.begin(), sorted.end(), [](const Hit& a, const Hit& b) {
+        if (a.s_pos != b.s_pos) return a.s_pos < b.s_pos;
+        return a.q_pos < b.q_pos;
+    });
+
+    std::vector<AnchorRun> runs;
+    for (const Hit& a : sorted) {
+        int64_t q = a.q_pos;
+        int64_t r = a.s_pos;
+        if (q + span > qlen || r + span > rlen) continue;
+        if (runs.empty()) {
+            runs.push_back({static_cast<int>(q), static_cast<int>(r), span});
+            continue;
+        }
+        AnchorRun& last = runs.back();
+        if (r - q == last.r - last.q && q <= last.q + last.len) {
+            // Same diagonal, overlapping or adjacent: extend
+            last.len = std::max<int>(last.len, static_cast<int>(q + span - last.q));
+            continue;
+        }
+        int64_t shift = std::max<int64_t>({0, last.q + last.len - q, last.r + last.len - r});
+        if (shift >= span) continue;
+        runs.push_back({static_cast<int>(q + shift), static_cast<int>(r + shift),
+                        static_cast<int>(span - shift)});
+    }
+    return runs;
+}
+
+} // namespace
+
+AnchoredAlignment anchored_sg_align(
+    const char* query, int qlen,
+    const char* ref, int rlen,
+    const std::vector<Hit>& anchors, int span,
+    int gapopen, int gapext,
+    const SubstitutionMatrix& matrix) {
+
+    AnchoredAlignment out;
+    if (qlen <= 0 || rlen <= 0 || span <= 0) return out;
+
+    std::vector<AnchorRun> runs = collinear_runs(anchors, span, qlen, rlen);
+    if (runs.empty()) return out;
+
+    // Columns of the whole alignment ('M', 'I', 'D')
+    std::string ops;
+    int score = 0;
+
+    const AnchorRun& first = runs.front();
+    SegmentResult left = align_segment(query, first.q, ref, first.r,
+                                       SegmentMode::kFreeStart, gapopen, gapext,
+                                       matrix, ops);
+    score += left.score;
+    out.beg_query = left.beg_q;
+    out.beg_ref = left.beg_r;
+
+    for (size_t n = 0; n < runs.size(); n++) {
+        const AnchorRun& run = runs[n];
+        if (n > 0) {
+            const AnchorRun& prev = runs[n - 1];
+            int qa = prev.q + prev.len;
+            int ra = prev.r + prev.len;
+            score += align_segment(query + qa, run.q - qa, ref + ra, run.r - ra,
+                                   SegmentMode::kGlobal, gapopen, gapext,
+                                   matrix, ops).score;
+        }
+        for (int x = 0; x < run.len; x++) {
+            score += matrix.matrix[
+                matrix.mapper[static_cast<unsigned char>(query[run.q + x])] * matrix.size +
+                matrix.mapper[static_cast<unsigned char>(ref[run.r + x])]];
+        }
+        ops.append(static_cast<size_t>(run.len), 'M');
+    }
+
+    const AnchorRun& last = runs.back();
+    int qe = last.q + last.len;
+    int re = last.r + last.len;
+    SegmentResult right = align_segment(query + qe, qlen - qe, ref + re, rlen - re,
+                                        SegmentMode::kFreeEnd, gapopen, gapext,
+                                        matrix, ops);
+    score += right.score;
+    out.end_query = qe + right.end_q - 1;
+    out.end_ref = re + right.end_r - 1;
+
+    // Stitch: CIGAR runs, aligned strings and match counts
+    int qi = out.beg_query;
+    int ri = out.beg_ref;
+    char run_op = 0;
+    uint32_t run_len = 0;
+    auto flush = [&]() {
+        if (run_len == 0) return;
+        out.cigar += std::to_string(run_len);
+        out.cigar += run_op;
+    };
+    out.qseq.reserve(ops.size());
+    out.sseq.reserve(ops.size());
+    for (char op : ops) {
+        char c;
+        if (op == 'M') {
+            int s = matrix.matrix[
+                matrix.mapper[static_cast<unsigned char>(query[qi])] * matrix.size +
+                matrix.mapper[static_cast<unsigned char>(ref[ri])]];
+            c = (s > 0) ? '=' : 'X';
+            if (s > 0) out.npositive++; else out.nnegative++;
+            out.qseq += query[qi++];
+            out.sseq += ref[ri++];
+        } else if (op == 'I') {
+            c = 'I';
+            out.qseq += query[qi++];
+            out.sseq += '-';
+        } else {
+            c = 'D';
+            out.qseq += '-';
+            out.sseq += ref[ri++];
+        }
+        if (c != run_op) {
+            flush();
+            run_op = c;
+            run_len = 0;
+        }
+        run_len++;
+    }
+    flush();
+
+    out.aln_len = static_cast<uint32_t>(ops.size());
+    out.score = score;
+    out.ok = true;
+    return out;
+}
+
+} // namespace ikafssn
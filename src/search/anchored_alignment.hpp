@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/types.hpp"
+#include "search/banded_alignment.hpp"
+
+namespace ikafssn {
+
+struct AnchoredAlignment {
+    bool ok = false;       // false: no usable anchor, run the full DP instead
+    int score = 0;
+    int beg_query = -1;    // 0-based inclusive, as parasail cigar->beg_query
+    int beg_ref = -1;      // 0-based inclusive, as parasail cigar->beg_ref
+    int end_query = -1;    // 0-based inclusive, as parasail result->end_query
+    int end_ref = -1;      // 0-based inclusive, as parasail result->end_ref
+    std::string cigar;     // =/X/I/D runs from (beg_query, beg_ref) to the end
+    std::string qseq;      // aligned query, '-' in gaps
+    std::string sseq;      // aligned ref, '-' in gaps
+    uint32_t npositive = 0;
+    uint32_t nnegative = 0;
+    uint32_t aln_len = 0;  // CIGAR length including gaps
+};
+
+// Semi-global alignment constrained to pass through exact-match anchors.
+// anchors are (query position, ref position) starts of matches of length
+// span, in the coordinates of query and ref (any order). Anchors are
+// sorted by ref position and trimmed where they overlap the previous one;
+// anchors that are not collinear with the kept ones are dropped.
+//
+// The kept anchors are emitted as match columns directly. Only the flanks
+// and the gaps between consecutive anchors are aligned by DP (with
+// traceback): the left flank with free leading gaps and the right flank
+// with free trailing gaps, following parasail_sg_trace_striped_profile_sat()
+// (a gap of length n costs gapopen + (n - 1) * gapext), and the gaps between
+// anchors globally. Match columns scoring > 0 are '=', the rest 'X'. The
+// unaligned ends are not part of the CIGAR.
+//
+// The result is the best alignment through the anchors, which can score
+// below the unconstrained optimum. Cost is the sum of the flank and gap DP
+// areas, near-linear when the anchors cover most of a high-identity hit.
+AnchoredAlignment anchored_sg_align(
+    const char* query, int qlen,
+    const char* ref, int rlen,
+    const std::vector<Hit>& anchors, int span,
+    int gapopen, int gapext,
+    const SubstitutionMatrix& matrix);
+
+} // namespace ikafssn
@@ -0,0 +1,151 @@
+#include "search/banded_alignment.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+namespace ikafssn {
+
+namespace {
+
+constexpr int NEG_INF = INT_MIN / 4;
+
+// One band cell: scores of the three DP states and whether an optimal path
+// into each state passed through a band edge cell.
+struct BandCell {
+    int h = NEG_INF;
+    int e = NEG_INF;   // gap in query (ref advances)
+    int f = NEG_INF;   // gap in ref (query advances)
+    bool h_edge = false;
+    bool e_edge = false;
+    bool f_edge = false;
+};
+
+// max(a, b) with the edge flags of every candidate that reaches it
+inline void take_max(int& v, bool& edge, int cand, bool cand_edge) {
+    if (cand > v) {
+        v = cand;
+        edge = cand_edge;
+    } else if (cand == v) {
+        edge = edge || cand_edge;
+    }
+}
+
+} // namespace
+
+BandedAlignment banded_sg_align(
+    const char* query, int qlen,
+    const char* ref, int rlen,
+    int dlo, int dhi,
+    int gapopen, int gapext,
+    const SubstitutionMatrix& matrix) {
+
+    BandedAlignment out;
+    if (qlen <= 0 || rlen <= 0) return out;
+
+    // Diagonals outside the matrix carry no cells
+    dlo = std::max(dlo, -qlen);
+    dhi = std::min(dhi, rlen);
+    if (dlo > dhi) return out;
+    const int width = dhi - dlo + 1;
+
+    // Band offset t of row i is ref position j = i + dlo + t, so the
+    // diagonal predecessor (i-1, j-1) has the same offset in the previous
+    // row, the upper one (i-1, j) offset t+1, the left one (i, j-1) t-1.
+    // Ref position -1 is the free-start column (H = 0).
+    std::vector<BandCell> prev(width + 1), cur(width + 1);
+    for (int t = 0; t < width; t++) {
+        int j = -1 + dlo + t;
+        if (j >= -1 && j < rlen) prev[t].h = 0;  // free-start row
+    }
+
+    std::vector<int> last_col_h(qlen, NEG_INF);
+    std::vector<bool> last_col_edge(qlen, false);
+    int row_best = NEG_INF;
+    int row_best_j = -1;
+    bool row_best_edge = false;
+
+    for (int i = 0; i < qlen; i++) {
+        const int* score_row = matrix.matrix +
+            matrix.mapper[static_cast<unsigned char>(query[i])] * matrix.size;
+
+        for (int t = 0; t < width; t++) {
+            BandCell& c = cur[t];
+            c = BandCell();
+            int j = i + dlo + t;
+            if (j < 0) {
+                if (j == -1) c.h = 0;  // free-start column
+                continue;
+            }
+            if (j >= rlen) continue;
+
+            // Edge cells: a predecessor lies outside the band
+            bool edge = (t == 0 && j > 0) || (t == width - 1 && i > 0);
+
+            // Gap in ref, from the upper cell (free-start row above row 0)
+            if (i > 0) {
+                const BandCell& up = prev[t + 1];
+                take_max(c.f, c.f_edge, up.f - gapext, up.f_edge);
+                take_max(c.f, c.f_edge, up.h - gapopen, up.h_edge);
+            } else {
+                c.f = -gapopen;
+            }
+
+            // Gap in query, from the left cell (free-start column left of 0)
+            if (t > 0) {
+                const BandCell& left = cur[t - 1];
+                take_max(c.e, c.e_edge, left.e - gapext, left.e_edge);
+                take_max(c.e, c.e_edge, left.h - gapopen, left.h_edge);
+            } else if (j == 0) {
+                c.e = -gapopen;
+            }
+
+            int diag = prev[t].h;
+            int sub = score_row[matrix.mapper[static_cast<unsigned char>(ref[j])]];
+            c.h = diag + sub;
+            c.h_edge = prev[t].h_edge;
+            take_max(c.h, c.h_edge, c.e, c.e_edge);
+            take_max(c.h, c.h_edge, c.f, c.f_edge);
+            c.h_edge = c.h_edge || edge;
+
+            if (i == qlen - 1 && c.h > row_best) {
+                row_best = c.h;
+                row_best_j = j;
+                row_best_edge = c.h_edge;
+            }
+            if (j == rlen - 1) {
+                last_col_h[i] = c.h;
+                last_col_edge[i] = c.h_edge;
+            }
+        }
+        std::swap(prev, cur);
+    }
+
+    // Last query row first, then the last ref column (parasail's order)
+    int best = row_best;
+    int end_query = qlen - 1;
+    int end_ref = row_best_j;
+    bool best_edge = row_best_edge;
+    for (int i = 0; i < qlen; i++) {
+        int h = last_col_h[i];
+        if (h == NEG_INF) continue;
+        if (h > best) {
+            best = h;
+            end_query = i;
+            end_ref = rlen - 1;
+            best_edge = last_col_edge[i];
+        } else if (h == best && end_ref == rlen - 1 && i < end_query) {
+            end_query = i;
+            best_edge = last_col_edge[i];
+        }
+    }
+    if (end_ref < 0) return out;
+
+    out.score = best;
+    out.end_query = end_query;
+    out.end_ref = end_ref;
+    out.in_band = !best_edge;
+    return out;
+}
+
+} // namespace ikafssn
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ikafssn {
+
+// Substitution matrix in parasail layout:
+//   score(a, b) = matrix[mapper[a] * size + mapper[b]]
+// (fields of parasail_matrix_t, so Stage 3 matrices are shared as-is).
+struct SubstitutionMatrix {
+    const int* matrix = nullptr;
+    const int* mapper = nullptr;   // 256 entries, indexed by unsigned char
+    int size = 0;
+};
+
+struct BandedAlignment {
+    int score = 0;
+    int end_query = -1;    // 0-based inclusive, as parasail result->end_query
+    int end_ref = -1;      // 0-based inclusive, as parasail result->end_ref
+    bool in_band = false;  // false: the result is not trusted (see below)
+};
+
+// Score-only semi-global alignment restricted to the diagonals
+// dlo <= j - i <= dhi (i = query position, j = ref position).
+// Recurrences, end gap rules and the end-position tie rule follow
+// parasail_sg_striped_profile_sat(): end gaps on both sequences are free,
+// a gap of length n costs gapopen + (n - 1) * gapext, and the best cell of
+// the last query row (first ref position on ties) is compared with the
+// last ref column.
+//
+// in_band is false when the band holds no end cell, or when an optimal
+// path to the reported end cell passes through a band edge cell (a cell
+// whose left or upper neighbour lies outside the band); the caller then
+// reruns the full DP. Runs in O(qlen * (dhi - dlo + 1)).
+BandedAlignment banded_sg_align(
+    const char* query, int qlen,
+    const char* ref, int rlen,
+    int dlo, int dhi,
+    int gapopen, int gapext,
+    const SubstitutionMatrix& matrix);
+
+} // namespace ikafssn
@@ -0,0 +1,205 @@
+#include "search/batch_alignment.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+
+namespace ikafssn {
+
+namespace {
+
+constexpr int L = kBatchLanes;
+
+// Align one group of at most kBatchLanes lanes (indices into lanes[],
+// spanning ref columns [c0, c1)) with scores of type T
+template <typename T>
+void align_group(const std::vector<BatchLane>& lanes,
+                 const std::vector<size_t>& group, int c0, int c1,
+                 const char* ref, int gapopen, int gapext,
+                 const SubstitutionMatrix& matrix,
+                 std::vector<BatchAlignment>& out) {
+    constexpr T NEG_INF = std::numeric_limits<T>::min() / 2;
+    const T gopen = static_cast<T>(gapopen);
+    const T gext = static_cast<T>(gapext);
+    const int n = static_cast<int>(group.size());
+    int maxlen = 0;
+    int qlen[L] = {};
+    int begin[L] = {};
+    int end[L] = {};
+    for (int l = 0; l < n; l++) {
+        const BatchLane& b = lanes[group[l]];
+        qlen[l] = b.qlen;
+        begin[l] = b.ref_begin;
+        end[l] = b.ref_end;
+        maxlen = std::max(maxlen, b.qlen);
+    }
+    // Padding lanes have no window and stay in the free-start state
+    for (int l = n; l < L; l++) begin[l] = end[l] = c0;
+
+    // Lane-interleaved query profile: prof[(r * maxlen + i) * L + l] is
+    // the score of query l's base i against matrix symbol r
+    const int size = matrix.size;
+    std::vector<T> prof(static_cast<size_t>(size) * maxlen * L, 0);
+    for (int l = 0; l < n; l++) {
+        const char* q = lanes[group[l]].query;
+        for (int i = 0; i < qlen[l]; i++) {
+            const int* row = matrix.matrix + matrix.mapper[static_cast<unsigned char>(q[i])] * size;
+            for (int r = 0; r < size; r++) {
+                prof[(static_cast<size_t>(r) * maxlen + i) * L + l] = static_cast<T>(row[r]);
+            }
+        }
+    }
+
+    // Per query row: H of the previous ref column and E (gap in query)
+    std::vector<T> hcol(static_cast<size_t>(maxlen) * L, 0);
+    std::vector<T> ecol(static_cast<size_t>(maxlen) * L, NEG_INF);
+    std::vector<T> last_col(static_cast<size_t>(maxlen) * L, NEG_INF);
+    int row_best[L];
+    int row_best_j[L];
+    std::fill(row_best, row_best + L, INT_MIN);
+    std::fill(row_best_j, row_best_j + L, -1);
+
+    for (int j = c0; j < c1; j++) {
+        const T* p = prof.data() +
+            static_cast<size_t>(matrix.mapper[static_cast<unsigned char>(ref[j])]) * maxlen * L;
+        T active[L];
+        T diag[L];
+        T hup[L];
+        T f[L];
+        for (int l = 0; l < L; l++) {
+            active[l] = (j >= begin[l] && j < end[l]) ? 1 : 0;
+            diag[l] = 0;      // free-start row
+            hup[l] = 0;
+            f[l] = NEG_INF;
+        }
+
+        for (int i = 0; i < maxlen; i++) {
+            T* hc = hcol.data() + static_cast<size_t>(i) * L;
+            T* ec = ecol.data() + static_cast<size_t>(i) * L;
+            const T* sc = p + static_cast<size_t>(i) * L;
+            for (int l = 0; l < L; l++) {
+                T hl = hc[l];
+                T e = std::max<T>(ec[l] - gext, hl - gopen);
+                T fv = std::max<T>(f[l] - gext, hup[l] - gopen);
+                T h = std::max<T>(diag[l] + sc[l], std::max(e, fv));
+                diag[l] = hl;
+                // Outside the window: the free-start column for the next
+                h = active[l] ? h : T(0);
+                e = active[l] ? e : NEG_INF;
+                hc[l] = h;
+                ec[l] = e;
+                f[l] = fv;
+                hup[l] = h;
+            }
+        }
+
+        for (int l = 0; l < n; l++) {
+            if (!active[l]) continue;
+            int h = hcol[static_cast<size_t>(qlen[l] - 1) * L + l];
+            if (h > row_best[l]) {
+                row_best[l] = h;
+                row_best_j[l] = j - begin[l];
+            }
+            if (j == end[l] - 1) {
+                for (int i = 0; i < qlen[l]; i++) {
+                    last_col[static_cast<size_t>(i) * L + l] = hcol[static_cast<size_t>(i) * L + l];
+                }
+            }
+        }
+    }
+
+    // Last query row first, then the last ref column (parasail's order)
+    for (int l = 0; l < n; l++) {
+        const int rlen = end[l] - begin[l];
+        int best = row_best[l];
+        int end_query = qlen[l] - 1;
+        int end_ref = row_best_j[l];
+        for (int i = 0; i < qlen[l]; i++) {
+            int h = last_col[static_cast<size_t>(i) * L + l];
+            if (h > best) {
+                best = h;
+                end_query = i;
+                end_ref = rlen - 1;
+            } else if (h == best && end_ref == rlen - 1 && i < end_query) {
+                end_query = i;
+            }
+        }
+        BatchAlignment& r = out[group[l]];
+        r.ok = true;
+        r.score = best;
+        r.end_query = end_query;
+        r.end_ref = end_ref;
+    }
+}
+
+} // namespace
+
+std::vector<BatchAlignment> batch_sg_align(
+    const std::vector<BatchLane>& lanes,
+    const char* ref,
+    int gapopen, int gapext,
+    const SubstitutionMatrix& matrix) {
+
+    std::vector<BatchAlignment> out(lanes.size());
+    int max_abs = 0;
+    for (int k = 0; k < matrix.size * matrix.size; k++) {
+        max_abs = std::max(max_abs, std::abs(matrix.matrix[k]));
+    }
+    std::vector<size_t> order;
+    order.reserve(lanes.size());
+    for (size_t k = 0; k < lanes.size(); k++) {
+        if (lanes[k].qlen > 0 && lanes[k].ref_begin < lanes[k].ref_end) order.push_back(k);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return lanes[a].ref_begin < lanes[b].ref_begin;
+    });
+
+    // Greedy groups: a lane joins while the group keeps at least half of
+    // its lane-columns (span * lanes) inside the lanes' own windows
+    std::vector<size_t> group;
+    int64_t cells = 0;
+    int span_begin = 0;
+    int span_end = 0;
+    int maxlen = 0;
+    auto flush = [&]() {
+        if (group.size() >= 2) {
+            // 16-bit scores (twice the lanes per vector) when no cell
+            // can leave [-2^14, 2^14]
+            int64_t bound = int64_t(max_abs + gapopen + gapext) *
+                            (maxlen + (span_end - span_begin));
+            if (bound < (1 << 14)) {
+                align_group<int16_t>(lanes, group, span_begin, span_end,
+                                     ref, gapopen, gapext, matrix, out);
+            } else {
+                align_group<int32_t>(lanes, group, span_begin, span_end,
+                                     ref, gapopen, gapext, matrix, out);
+            }
+        }
+        group.clear();
+        cells = 0;
+        maxlen = 0;
+    };
+    for (size_t k : order) {
+        const BatchLane& b = lanes[k];
+        const int64_t w = b.ref_end - b.ref_begin;
+        if (!group.empty()) {
+            int64_t span = std::max(span_end, b.ref_end) - span_begin;
+            int64_t n = static_cast<int64_t>(group.size()) + 1;
+            if (static_cast<int>(group.size()) == L || span * n > 2 * (cells + w)) flush();
+        }
+        if (group.empty()) {
+            span_begin = b.ref_begin;
+            span_end = b.ref_end;
+        }
+        group.push_back(k);
+        cells += w;
+        maxlen = std::max(maxlen, b.qlen);
+        span_end = std::max(span_end, b.ref_end);
+    }
+    flush();
+    return out;
+}
+
+} // namespace ikafssn
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include "search/banded_alignment.hpp"
+
+namespace ikafssn {
+
+// Queries aligned together by one batch_sg_align() group.
+constexpr int kBatchLanes = 16;
+
+// One query of a batch and its window [ref_begin, ref_end) of the shared
+// ref (the subject region its hit would be aligned against alone).
+struct BatchLane {
+    const char* query = nullptr;
+    int qlen = 0;
+    int ref_begin = 0;
+    int ref_end = 0;
+};
+
+struct BatchAlignment {
+    bool ok = false;     // false: not aligned here, align the lane alone
+    int score = 0;
+    int end_query = -1;  // 0-based inclusive
+    int end_ref = -1;    // 0-based inclusive, relative to ref_begin
+};
+
+// Score-only semi-global alignment of many queries against windows of one
+// ref, kBatchLanes queries at a time in an inter-sequence layout: the DP
+// state of each query row holds one value per lane, so every cell update
+// is a short loop over the lanes that the compiler vectorizes (16-bit
+// scores when the group's lengths cannot overflow them). Each lane
+// gets the result of banded_sg_align() over its whole window (score, end
+// positions and tie rules of parasail_sg_striped_profile_sat()); columns
+// outside a lane's window keep it in the free-start state.
+//
+// Lanes are grouped in ref_begin order while a group's ref span keeps at
+// least half of its lane-columns inside the lanes' windows. Lanes left
+// alone in a group, and lanes with an empty query or window, are returned
+// with ok = false. Results are in lane order.
+std::vector<BatchAlignment> batch_sg_align(
+    const std::vector<BatchLane>& lanes,
+    const char* ref,
+    int gapopen, int gapext,
+    const SubstitutionMatrix& matrix);
+
+} // namespace ikafssn
@@ -1,7 +1,13 @@
 #include "search/diagonal_filter.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <unordered_map>
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 namespace ikafssn {
 
 std::vector<Hit> diagonal_filter(const std::vector<Hit>& hits,
@@ -29,4 +35,152 @@ std::vector<Hit> diagonal_filter(const std::vector<Hit>& hits,
     return filtered;
 }
 
+static_assert(sizeof(Hit) == 8, "Hit must be two packed uint32_t");
+
+// Diagonal bias: (s_pos - q_pos) ^ DIAG_BIAS orders signed diagonals as uint32_t.
+static constexpr uint32_t DIAG_BIAS = 0x80000000u;
+
+// keys[i] = ((s_pos - q_pos) ^ DIAG_BIAS) << 32 | q_pos
+static void make_diag_keys(const Hit* hits, size_t n, uint64_t* keys) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    // [q, s] lanes -> [q, s - q]: subtract q shifted into the high half
+    const __m256i bias_avx = _mm256_set1_epi64x(static_cast<int64_t>(DIAG_BIAS) << 32);
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hits + i));
+        __m256i d = _mm256_sub_epi32(v, _mm256_slli_epi64(v, 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(keys + i),
+                            _mm256_xor_si256(d, bias_avx));
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i bias_sse = _mm_set1_epi64x(static_cast<int64_t>(DIAG_BIAS) << 32);
+    for (; i + 2 <= n; i += 2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hits + i));
+        __m128i d = _mm_sub_epi32(v, _mm_slli_epi64(v, 32));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(keys + i),
+                         _mm_xor_si128(d, bias_sse));
+    }
+#endif
+    for (; i < n; i++) {
+        uint32_t d = (hits[i].s_pos - hits[i].q_pos) ^ DIAG_BIAS;
+        keys[i] = (static_cast<uint64_t>(d) << 32) | hits[i].q_pos;
+    }
+}
+
+// keys[i] = q_pos << 32 | s_pos
+static void make_pos_keys(const Hit* hits, size_t n, uint64_t* keys) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hits + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(keys + i),
+                            _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+#endif
+#if defined(__SSE2__)
+    for (; i + 2 <= n; i += 2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hits + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(keys + i),
+                         _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+#endif
+    for (; i < n; i++) {
+        keys[i] = (static_cast<uint64_t>(hits[i].q_pos) << 32) | hits[i].s_pos;
+    }
+}
+
+static constexpr int RADIX_BITS = 11;
+static constexpr uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+static constexpr int RADIX_PASSES = (64 + RADIX_BITS - 1) / RADIX_BITS;
+static constexpr size_t RADIX_MIN_N = 256; // std::sort below this
+
+// LSD radix sort of keys[0..n) using tmp[0..n) as scratch; result in keys.
+// All digit histograms are built in one pass, and passes whose digit is the
+// same for every key (e.g. high bits of small positions) are skipped.
+static void radix_sort_keys(uint64_t* keys, uint64_t* tmp, size_t n) {
+    if (n < RADIX_MIN_N) {
+        std::sort(keys, keys + n);
+        return;
+    }
+
+    std::vector<uint32_t> hist(static_cast<size_t>(RADIX_PASSES) * RADIX_SIZE, 0);
+    for (size_t i = 0; i < n; i++) {
+        uint64_t k = keys[i];
+        for (int p = 0; p < RADIX_PASSES; p++) {
+            hist[p * RADIX_SIZE + ((k >> (p * RADIX_BITS)) & (RADIX_SIZE - 1))]++;
+        }
+    }
+
+    uint64_t* src = keys;
+    uint64_t* dst = tmp;
+    for (int p = 0; p < RADIX_PASSES; p++) {
+        const int shift = p * RADIX_BITS;
+        uint32_t* h = &hist[p * RADIX_SIZE];
+        if (h[(src[0] >> shift) & (RADIX_SIZE - 1)] == n) continue;
+
+        uint32_t sum = 0;
+        for (uint32_t d = 0; d < RADIX_SIZE; d++) {
+            uint32_t c = h[d];
+            h[d] = sum;
+            sum += c;
+        }
+        for (size_t i = 0; i < n; i++) {
+            uint64_t k = src[i];
+            dst[h[(k >> shift) & (RADIX_SIZE - 1)]++] = k;
+        }
+        std::swap(src, dst);
+    }
+    if (src != keys) std::memcpy(keys, src, n * sizeof(uint64_t));
+}
+
+size_t dedup_diagonal_filter(Hit* hits, size_t n, uint32_t min_diag_hits) {
+    if (n == 0) return 0;
+
+    std::vector<uint64_t> buf(2 * n);
+    uint64_t* keys = buf.data();
+    uint64_t* tmp = keys + n;
+    size_t m = 0;
+
+    if (min_diag_hits <= 1) {
+        // Dedup only: one sort by (q_pos, s_pos)
+        make_pos_keys(hits, n, keys);
+        radix_sort_keys(keys, tmp, n);
+        for (size_t i = 0; i < n; i++) {
+            if (i > 0 && keys[i] == keys[i - 1]) continue;
+            hits[m++] = {static_cast<uint32_t>(keys[i] >> 32),
+                         static_cast<uint32_t>(keys[i])};
+        }
+        return m;
+    }
+
+    // Sort by (diagonal, q_pos): duplicates are adjacent within each diagonal
+    // run, so one scan dedups, counts and keeps runs of >= min_diag_hits.
+    // Survivors are re-keyed as (q_pos, s_pos) into tmp.
+    make_diag_keys(hits, n, keys);
+    radix_sort_keys(keys, tmp, n);
+    size_t i = 0;
+    while (i < n) {
+        const uint32_t d = static_cast<uint32_t>(keys[i] >> 32);
+        const size_t run_start = m;
+        uint32_t distinct = 0;
+        size_t j = i;
+        for (; j < n && static_cast<uint32_t>(keys[j] >> 32) == d; j++) {
+            if (j > i && keys[j] == keys[j - 1]) continue;
+            uint32_t q = static_cast<uint32_t>(keys[j]);
+            uint32_t s = (d ^ DIAG_BIAS) + q;
+            tmp[m++] = (static_cast<uint64_t>(q) << 32) | s;
+            distinct++;
+        }
+        if (distinct < min_diag_hits) m = run_start;
+        i = j;
+    }
+
+    radix_sort_keys(tmp, keys, m);
+    for (size_t k = 0; k < m; k++) {
+        hits[k] = {static_cast<uint32_t>(tmp[k] >> 32), static_cast<uint32_t>(tmp[k])};
+    }
+    return m;
+}
+
 } // namespace ikafssn
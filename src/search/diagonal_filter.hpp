@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -13,4 +14,13 @@ namespace ikafssn {
 std::vector<Hit> diagonal_filter(const std::vector<Hit>& hits,
                                  uint32_t min_diag_hits);
 
+// Stage 2 pre-pass over hits[0..n), in place:
+// removes duplicate (q_pos, s_pos) pairs, drops hits on diagonals with fewer
+// than min_diag_hits distinct hits (min_diag_hits <= 1: no filtering), and
+// leaves the survivors in hits[0..return value) sorted by (q_pos, s_pos).
+// Hits are radix-sorted as 64-bit keys, (diagonal, q_pos) for the filter and
+// (q_pos, s_pos) for the output; diagonals are deduplicated and counted in
+// one linear scan. Key construction uses SSE2/AVX2 when available.
+size_t dedup_diagonal_filter(Hit* hits, size_t n, uint32_t min_diag_hits);
+
 } // namespace ikafssn
@@ -0,0 +1,77 @@
+#include "search/dust_masker.hpp"
+
+#include <algorithm>
+
+namespace ikafssn {
+
+static inline int dust_base_code(char c) {
+    switch (c) {
+    case 'A': case 'a': return 0;
+    case 'C': case 'c': return 1;
+    case 'G': case 'g': return 2;
+    case 'T': case 't': case 'U': case 'u': return 3;
+    default: return -1;
+    }
+}
+
+std::vector<uint8_t> dust_mask(const std::string& seq, uint32_t level,
+                               uint32_t window) {
+    const size_t n = seq.size();
+    std::vector<uint8_t> mask(n, 0);
+    if (level == 0 || n < 3) return mask;
+
+    // Triplet codes (0..63) by start position; -1 if any base is not ACGT
+    const size_t num_triplets = n - 2;
+    std::vector<int8_t> trip(num_triplets);
+    for (size_t j = 0; j < num_triplets; j++) {
+        int a = dust_base_code(seq[j]);
+        int b = dust_base_code(seq[j + 1]);
+        int c = dust_base_code(seq[j + 2]);
+        trip[j] = (a < 0 || b < 0 || c < 0)
+            ? static_cast<int8_t>(-1)
+            : static_cast<int8_t>((a << 4) | (b << 2) | c);
+    }
+
+    // Short queries are scored as a single window
+    const size_t wlen = std::max<size_t>(3, std::min<size_t>(window, n));
+    const size_t wtrip = wlen - 2; // triplets per window
+
+    uint32_t counts[64] = {};
+    uint64_t r = 0;  // sum_t c_t * (c_t - 1) / 2
+    uint64_t l = 0;  // number of valid triplets in window
+
+    auto add = [&](int8_t t) {
+        if (t < 0) return;
+        r += counts[t];
+        counts[t]++;
+        l++;
+    };
+    auto remove = [&](int8_t t) {
+        if (t < 0) return;
+        counts[t]--;
+        r -= counts[t];
+        l--;
+    };
+
+    // Difference array over bases: +1 at window start, -1 past window end
+    std::vector<int32_t> diff(n + 1, 0);
+    for (size_t j = 0; j < wtrip; j++) add(trip[j]);
+    for (size_t w = 0; ; w++) {
+        if (l >= 2 && r * 10 > static_cast<uint64_t>(level) * (l - 1)) {
+            diff[w]++;
+            diff[w + wlen]--;
+        }
+        if (w + wtrip >= num_triplets) break;
+        remove(trip[w]);
+        add(trip[w + wtrip]);
+    }
+
+    int32_t depth = 0;
+    for (size_t i = 0; i < n; i++) {
+        depth += diff[i];
+        mask[i] = (depth > 0) ? 1 : 0;
+    }
+    return mask;
+}
+
+} // namespace ikafssn
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ikafssn {
+
+// Windowed DUST low-complexity masker for query sequences.
+// A window of `window` bases is scored from its triplet counts c_t as
+//   score = sum_t c_t * (c_t - 1) / 2 / (l - 1)
+// (l = number of ACGT-only triplets in the window); every base of a window
+// with score > level / 10 is masked (level 20 = dustmasker default).
+// Triplets containing non-ACGT characters are not counted.
+// Runs in O(len) with an incrementally updated score.
+//
+// Returns a per-base mask (1 = masked) of size seq.size(); all zero when
+// level == 0 or the sequence is shorter than one triplet.
+std::vector<uint8_t> dust_mask(const std::string& seq, uint32_t level,
+                               uint32_t window = 64);
+
+} // namespace ikafssn
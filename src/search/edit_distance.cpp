@@ -0,0 +1,222 @@
+#include "search/edit_distance.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <climits>
+#include <vector>
+
+namespace ikafssn {
+
+namespace {
+
+// One ref column over one 64-row block (Hyyro's block step of Myers'
+// algorithm). pv / mv hold the +1 / -1 vertical deltas of the block, hin
+// the horizontal delta entering at its top row. Returns the horizontal
+// delta leaving at row out_bit.
+inline int advance_block(uint64_t& pv, uint64_t& mv, uint64_t eq,
+                         int hin, int out_bit) {
+    const uint64_t hneg = (hin < 0) ? 1 : 0;
+    const uint64_t xv = eq | mv;
+    eq |= hneg;
+    const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+    uint64_t ph = mv | ~(xh | pv);
+    uint64_t mh = pv & xh;
+    int hout = static_cast<int>((ph >> out_bit) & 1) - static_cast<int>((mh >> out_bit) & 1);
+    ph = (ph << 1) | ((hin > 0) ? 1 : 0);
+    mh = (mh << 1) | hneg;
+    pv = mh | ~(xv | ph);
+    mv = ph & xv;
+    return hout;
+}
+
+} // namespace
+
+EditAlignment edit_sg_align(
+    const char* query, int qlen,
+    const char* ref, int rlen,
+    int gapopen, int gapext,
+    const SubstitutionMatrix& matrix) {
+
+    EditAlignment out;
+    if (qlen <= 0 || rlen <= 0) return out;
+    const size_t nw = (static_cast<size_t>(qlen) + 63) / 64;
+    const int last_bit = (qlen - 1) % 64;
+
+    auto score_of = [&](char a, char b) {
+        return matrix.matrix[matrix.mapper[static_cast<unsigned char>(a)] * matrix.size +
+                             matrix.mapper[static_cast<unsigned char>(b)]];
+    };
+
+    // Match masks per matrix symbol: bit i set if score(query[i], c) > 0
+    std::vector<uint64_t> peq(static_cast<size_t>(matrix.size) * nw, 0);
+    for (int i = 0; i < qlen; i++) {
+        const int* row = matrix.matrix +
+            matrix.mapper[static_cast<unsigned char>(query[i])] * matrix.size;
+        for (int c = 0; c < matrix.size; c++) {
+            if (row[c] > 0) peq[static_cast<size_t>(c) * nw + i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+    auto match_of = [&](char c) {
+        return peq.data() +
+            static_cast<size_t>(matrix.mapper[static_cast<unsigned char>(c)]) * nw;
+    };
+
+    // Pass 1: distance of the whole query ending at each ref column. The
+    // top row is 0 everywhere (free ref start), the left column 0..qlen.
+    std::vector<uint64_t> pv(nw, ~uint64_t(0)), mv(nw, 0);
+    int dist = qlen;
+    int best = INT_MAX;
+    int best_j = 0;
+    for (int j = 0; j < rlen && best > 0; j++) {
+        const uint64_t* eq = match_of(ref[j]);
+        int h = 0;
+        for (size_t w = 0; w < nw; w++) {
+            h = advance_block(pv[w], mv[w], eq[w], h, (w + 1 == nw) ? last_bit : 63);
+        }
+        dist += h;
+        if (dist < best) {
+            best = dist;
+            best_j = j;
+        }
+    }
+
+    // Pass 2: an alignment with `best` edits spans at most qlen + best ref
+    // bases, so re-run over that window keeping every column's vectors.
+    const int ws = std::max(0, best_j + 1 - (qlen + best));
+    const int ncol = best_j + 1 - ws;
+    std::vector<uint64_t> col_pv(static_cast<size_t>(ncol) * nw);
+    std::vector<uint64_t> col_mv(static_cast<size_t>(ncol) * nw);
+    std::fill(pv.begin(), pv.end(), ~uint64_t(0));
+    std::fill(mv.begin(), mv.end(), 0);
+    for (int c = 0; c < ncol; c++) {
+        const uint64_t* eq = match_of(ref[ws + c]);
+        int h = 0;
+        for (size_t w = 0; w < nw; w++) {
+            h = advance_block(pv[w], mv[w], eq[w], h, (w + 1 == nw) ? last_bit : 63);
+        }
+        std::copy(pv.begin(), pv.end(), col_pv.begin() + static_cast<size_t>(c) * nw);
+        std::copy(mv.begin(), mv.end(), col_mv.begin() + static_cast<size_t>(c) * nw);
+    }
+
+    // D[i][c]: distance of query[0, i) ending at window column c (c = -1
+    // is the column before the window), summed from the vertical deltas.
+    auto value = [&](int i, int c) {
+        if (c < 0) return i;
+        const uint64_t* p = col_pv.data() + static_cast<size_t>(c) * nw;
+        const uint64_t* m = col_mv.data() + static_cast<size_t>(c) * nw;
+        int v = 0;
+        int w = 0;
+        for (; (w + 1) * 64 <= i; w++) {
+            v += static_cast<int>(std::bitset<64>(p[w]).count()) -
+                 static_cast<int>(std::bitset<64>(m[w]).count());
+        }
+        if (i % 64 != 0) {
+            const uint64_t keep = (uint64_t(1) << (i % 64)) - 1;
+            v += static_cast<int>(std::bitset<64>(p[w] & keep).count()) -
+                 static_cast<int>(std::bitset<64>(m[w] & keep).count());
+        }
+        return v;
+    };
+
+    // Traceback from (qlen, ncol - 1) to row 0
+    std::string ops;  // reversed: 'M' (aligned pair), 'I' (query only), 'D' (ref only)
+    ops.reserve(static_cast<size_t>(qlen + best));
+    int i = qlen;
+    int c = ncol - 1;
+    int d = value(i, c);
+    while (i > 0) {
+        if (c < 0) {
+            ops += 'I';
+            d--;
+            i--;
+            continue;
+        }
+        // Extend an open gap while it stays optimal, so that the indels
+        // of one event form a single run
+        const char last = ops.empty() ? 0 : ops.back();
+        if (last == 'I' && value(i - 1, c) + 1 == d) {
+            ops += 'I';
+            d--;
+            i--;
+            continue;
+        }
+        if (last == 'D' && value(i, c - 1) + 1 == d) {
+            ops += 'D';
+            d--;
+            c--;
+            continue;
+        }
+        const int diag = value(i - 1, c - 1);
+        const bool match = score_of(query[i - 1], ref[ws + c]) > 0;
+        if (diag + (match ? 0 : 1) == d) {
+            ops += 'M';
+            d = diag;
+            i--;
+            c--;
+        } else if (value(i - 1, c) + 1 == d) {
+            ops += 'I';
+            d--;
+            i--;
+        } else {
+            ops += 'D';
+            d--;
+            c--;
+        }
+    }
+    std::reverse(ops.begin(), ops.end());
+
+    out.distance = static_cast<uint32_t>(best);
+    out.beg_query = 0;
+    out.beg_ref = ws + c + 1;
+    out.end_query = qlen - 1;
+    out.end_ref = best_j;
+
+    // Rescore and stitch: CIGAR runs, aligned strings and match counts
+    int qi = 0;
+    int ri = out.beg_ref;
+    char run_op = 0;
+    uint32_t run_len = 0;
+    char prev = 0;
+    auto flush = [&]() {
+        if (run_len == 0) return;
+        out.cigar += std::to_string(run_len);
+        out.cigar += run_op;
+    };
+    out.qseq.reserve(ops.size());
+    out.sseq.reserve(ops.size());
+    for (char op : ops) {
+        char cig;
+        if (op == 'M') {
+            int s = score_of(query[qi], ref[ri]);
+            out.score += s;
+            cig = (s > 0) ? '=' : 'X';
+            if (s > 0) out.npositive++; else out.nnegative++;
+            out.qseq += query[qi++];
+            out.sseq += ref[ri++];
+        } else if (op == 'I') {
+            cig = 'I';
+            out.score -= (prev == 'I') ? gapext : gapopen;
+            out.qseq += query[qi++];
+            out.sseq += '-';
+        } else {
+            cig = 'D';
+            out.score -= (prev == 'D') ? gapext : gapopen;
+            out.qseq += '-';
+            out.sseq += ref[ri++];
+        }
+        prev = op;
+        if (cig != run_op) {
+            flush();
+            run_op = cig;
+            run_len = 0;
+        }
+        run_len++;
+    }
+    flush();
+
+    out.aln_len = static_cast<uint32_t>(ops.size());
+    out.ok = true;
+    return out;
+}
+
+} // namespace ikafssn
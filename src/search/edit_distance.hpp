@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "search/banded_alignment.hpp"
+
+namespace ikafssn {
+
+struct EditAlignment {
+    bool ok = false;       // false: empty query or subject
+    uint32_t distance = 0; // edit distance (substitutions + indel bases)
+    int score = 0;         // the alignment rescored with matrix and gaps
+    int beg_query = 0;     // always 0: the whole query is aligned
+    int beg_ref = 0;
+    int end_query = 0;     // always qlen - 1
+    int end_ref = 0;
+    std::string cigar;     // =/X/I/D runs
+    std::string qseq;      // aligned query with '-' for gaps
+    std::string sseq;      // aligned subject with '-' for gaps
+    uint32_t npositive = 0;
+    uint32_t nnegative = 0;
+    uint32_t aln_len = 0;
+};
+
+// Semi-global edit-distance alignment of the whole query against any
+// substring of ref (free gaps at both ends of ref only), by the Myers /
+// Hyyro bit-vector algorithm over 64-row blocks of the query. A column
+// matches when its matrix score is > 0, so IUPAC codes match every base
+// they include under degmatch. Every other column, and every gap base,
+// costs 1.
+//
+// The end column is the leftmost with the smallest distance. The path is
+// then traced back from vertical delta vectors stored over the last
+// qlen + distance ref columns only, preferring matches, then
+// substitutions, then query insertions, and extends an open gap first
+// so one indel event stays one run. O(rlen * ceil(qlen / 64)) word
+// operations; score is the matrix + gapopen/gapext score of that path,
+// which can be below the parasail_sg_*() score of the same pair.
+EditAlignment edit_sg_align(
+    const char* query, int qlen,
+    const char* ref, int rlen,
+    int gapopen, int gapext,
+    const SubstitutionMatrix& matrix);
+
+} // namespace ikafssn
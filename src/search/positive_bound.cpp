@@ -0,0 +1,51 @@
+#include "search/positive_bound.hpp"
+
+#include <bitset>
+#include <vector>
+
+namespace ikafssn {
+
+uint32_t max_positive_columns(const char* query, int qlen,
+                              const char* ref, int rlen,
+                              const SubstitutionMatrix& matrix) {
+    if (qlen <= 0 || rlen <= 0) return 0;
+    const size_t nw = (static_cast<size_t>(qlen) + 63) / 64;
+
+    // Match masks per matrix symbol: bit i set if score(query[i], c) > 0
+    std::vector<uint64_t> peq(static_cast<size_t>(matrix.size) * nw, 0);
+    for (int i = 0; i < qlen; i++) {
+        const int* row = matrix.matrix +
+            matrix.mapper[static_cast<unsigned char>(query[i])] * matrix.size;
+        for (int c = 0; c < matrix.size; c++) {
+            if (row[c] > 0) peq[static_cast<size_t>(c) * nw + i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+
+    // V has a 0 bit at each query row where the LCS grows; per ref base:
+    // U = V & match, V = (V + U) | (V - U) with the carry across words
+    std::vector<uint64_t> v(nw, ~uint64_t(0));
+    for (int j = 0; j < rlen; j++) {
+        const uint64_t* match = peq.data() +
+            static_cast<size_t>(matrix.mapper[static_cast<unsigned char>(ref[j])]) * nw;
+        uint64_t carry = 0;
+        for (size_t w = 0; w < nw; w++) {
+            uint64_t u = v[w] & match[w];
+            uint64_t sum = v[w] + u;
+            uint64_t c1 = (sum < v[w]) ? 1 : 0;
+            uint64_t sum2 = sum + carry;
+            uint64_t c2 = (sum2 < sum) ? 1 : 0;
+            v[w] = sum2 | (v[w] - u);
+            carry = c1 | c2;
+        }
+    }
+
+    uint32_t zeros = 0;
+    for (size_t w = 0; w < nw; w++) {
+        uint64_t bits = v[w];
+        if (w + 1 == nw && qlen % 64 != 0) bits |= ~uint64_t(0) << (qlen % 64);
+        zeros += static_cast<uint32_t>(64 - std::bitset<64>(bits).count());
+    }
+    return zeros;
+}
+
+} // namespace ikafssn
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+#include "search/banded_alignment.hpp"
+
+namespace ikafssn {
+
+// Largest number of positive-scoring columns (score > 0) that any
+// alignment of query against ref can have: the longest common subsequence
+// under that match relation. Bit-parallel over the query (Allison-Dix /
+// Hyyro row update), O(rlen * ceil(qlen / 64)) word operations.
+uint32_t max_positive_columns(const char* query, int qlen,
+                              const char* ref, int rlen,
+                              const SubstitutionMatrix& matrix);
+
+} // namespace ikafssn
@@ -28,6 +28,20 @@ public:
         return prev_pos_;
     }
 
+    // Decode next position from a strand-bit encoded .kpx (canonical index).
+    // The LSB of each stored value is the strand bit; *strand receives it.
+    uint32_t next_stranded(bool was_new_seq, uint8_t* strand) {
+        uint32_t val;
+        ptr_ += varint_decode(ptr_, val);
+        *strand = static_cast<uint8_t>(val & 1u);
+        if (was_new_seq) {
+            prev_pos_ = val >> 1;
+        } else {
+            prev_pos_ += val >> 1;
+        }
+        return prev_pos_;
+    }
+
     const uint8_t* ptr() const { return ptr_; }
 
 private:
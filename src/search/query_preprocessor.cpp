@@ -1,8 +1,10 @@
 #include "search/query_preprocessor.hpp"
 #include "search/volume_searcher.hpp"
 #include "search/stage1_filter.hpp"
+#include "search/dust_masker.hpp"
 #include "index/kix_reader.hpp"
 #include "index/khx_reader.hpp"
+#include "index/kix_format.hpp"
 #include "core/kmer_encoding.hpp"
 #include "core/spaced_seed.hpp"
 #include "core/config.hpp"
@@ -10,21 +12,39 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdio>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace ikafssn {
 
+// Prefix sum of a per-base mask: prefix[i] = number of masked bases in [0, i).
+static std::vector<uint32_t> mask_prefix_sum(const std::vector<uint8_t>& mask) {
+    std::vector<uint32_t> prefix(mask.size() + 1, 0);
+    for (size_t i = 0; i < mask.size(); i++) prefix[i + 1] = prefix[i] + mask[i];
+    return prefix;
+}
+
+// True if [pos, pos + span) contains a masked base (masked may be null).
+static inline bool span_masked(const std::vector<uint32_t>* masked,
+                               uint32_t pos, uint32_t span) {
+    return masked != nullptr && (*masked)[pos + span] != (*masked)[pos];
+}
+
 template <typename KmerInt>
 static std::vector<std::pair<uint32_t, KmerInt>>
 extract_kmers(const std::string& seq, int k, bool* has_multi_degen = nullptr,
-              int max_expansion = 16) {
+              int max_expansion = 16,
+              const std::vector<uint32_t>* masked = nullptr) {
     std::vector<std::pair<uint32_t, KmerInt>> kmers;
+    const uint32_t span = static_cast<uint32_t>(k);
     KmerScanner<KmerInt> scanner(k);
     scanner.scan_ambig(seq.data(), seq.size(),
         [&](uint32_t pos, KmerInt kmer) {
+            if (span_masked(masked, pos, span)) return;
             kmers.emplace_back(pos, kmer);
         },
         [&](uint32_t pos, KmerInt base_kmer, const AmbigInfo* infos, int count) {
+            if (span_masked(masked, pos, span)) return;
             expand_ambig_kmer_multi<KmerInt>(base_kmer, infos, count,
                 [&](KmerInt expanded) {
                     kmers.emplace_back(pos, expanded);
@@ -40,14 +60,18 @@ static std::vector<std::pair<uint32_t, KmerInt>>
 extract_kmers_spaced(const std::string& seq, int k,
                      const std::vector<uint32_t>& masks, int t,
                      bool* has_multi_degen = nullptr,
-                     int max_expansion = 16) {
+                     int max_expansion = 16,
+                     const std::vector<uint32_t>* masked = nullptr) {
     std::vector<std::pair<uint32_t, KmerInt>> kmers;
+    const uint32_t span = static_cast<uint32_t>(t);
     KmerScanner<KmerInt> scanner(k);
     scanner.scan_spaced_ambig(seq.data(), seq.size(), masks, t,
         [&](uint32_t pos, KmerInt kmer) {
+            if (span_masked(masked, pos, span)) return;
             kmers.emplace_back(pos, kmer);
         },
         [&](uint32_t pos, KmerInt base_kmer, const AmbigInfo* infos, int count) {
+            if (span_masked(masked, pos, span)) return;
             expand_ambig_kmer_multi<KmerInt>(base_kmer, infos, count,
                 [&](KmerInt expanded) {
                     kmers.emplace_back(pos, expanded);
@@ -58,6 +82,121 @@ extract_kmers_spaced(const std::string& seq, int k,
     return kmers;
 }
 
+// Locality order for SoA query k-mers: positions carrying a single k-mer are
+// sorted by k-mer value so that offset-table and posting-data accesses become
+// a monotone sweep over the index. Positions with several degenerate
+// expansions keep their original (grouped) order after them, so the Stage 1
+// last_pos de-dup still sees each same-position group contiguously; single
+// positions never share a q_pos with any other entry.
+// Input must have same-position entries adjacent (as produced by extract_kmers).
+template <typename KmerInt>
+static std::vector<uint32_t> locality_order(const std::vector<uint32_t>& positions,
+                                            const std::vector<KmerInt>& kmer_values) {
+    const size_t n = positions.size();
+    std::vector<uint32_t> singles, multis;
+    singles.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        bool multi = (i > 0 && positions[i - 1] == positions[i]) ||
+                     (i + 1 < n && positions[i + 1] == positions[i]);
+        (multi ? multis : singles).push_back(static_cast<uint32_t>(i));
+    }
+    std::sort(singles.begin(), singles.end(), [&](uint32_t a, uint32_t b) {
+        if (kmer_values[a] != kmer_values[b]) return kmer_values[a] < kmer_values[b];
+        return positions[a] < positions[b];
+    });
+    singles.insert(singles.end(), multis.begin(), multis.end());
+    return singles;
+}
+
+template <typename T>
+static void apply_order(std::vector<T>& v, const std::vector<uint32_t>& order) {
+    std::vector<T> out;
+    out.reserve(order.size());
+    for (uint32_t i : order) out.push_back(v[i]);
+    v = std::move(out);
+}
+
+// Rare-first selection: visit distinct k-mers in ascending global posting
+// count and keep each one whose postings (count x query occurrences) still
+// fit in the posting-decode budget, until the target fraction of query
+// positions is covered. Removes the other entries (order preserved) and
+// returns the number of entries dropped.
+template <typename KmerInt, typename KeyFn>
+static uint32_t select_rare_first(std::vector<uint32_t>& positions,
+                                  std::vector<KmerInt>& kmer_values,
+                                  const std::unordered_map<uint32_t, uint64_t>& counts,
+                                  KeyFn index_key,
+                                  uint64_t max_postings,
+                                  double target_coverage) {
+    const size_t n = positions.size();
+    if (n == 0) return 0;
+
+    std::unordered_map<uint32_t, std::vector<uint32_t>> entries_by_key;
+    for (size_t i = 0; i < n; i++) {
+        entries_by_key[index_key(kmer_values[i])].push_back(static_cast<uint32_t>(i));
+    }
+    std::vector<std::pair<uint64_t, uint32_t>> order; // (count, key)
+    order.reserve(entries_by_key.size());
+    for (const auto& [key, idx] : entries_by_key) {
+        auto it = counts.find(key);
+        order.emplace_back(it != counts.end() ? it->second : 0, key);
+    }
+    std::sort(order.begin(), order.end());
+
+    std::unordered_set<uint32_t> all_positions(positions.begin(), positions.end());
+    size_t coverage_goal = all_positions.size();
+    if (target_coverage > 0) {
+        coverage_goal = static_cast<size_t>(
+            std::ceil(target_coverage * static_cast<double>(all_positions.size())));
+    }
+
+    std::vector<bool> keep(n, false);
+    std::unordered_set<uint32_t> covered;
+    uint64_t cost = 0;
+    for (const auto& [count, key] : order) {
+        if (target_coverage > 0 && covered.size() >= coverage_goal) break;
+        const auto& idx = entries_by_key[key];
+        uint64_t key_cost = count * idx.size();
+        // key_cost is not monotonic in this order: a later key occurring
+        // fewer times in the query may still fit
+        if (max_postings > 0 && cost + key_cost > max_postings) continue;
+        cost += key_cost;
+        for (uint32_t i : idx) {
+            keep[i] = true;
+            covered.insert(positions[i]);
+        }
+    }
+
+    size_t w = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!keep[i]) continue;
+        positions[w] = positions[i];
+        kmer_values[w] = kmer_values[i];
+        w++;
+    }
+    positions.resize(w);
+    kmer_values.resize(w);
+    return static_cast<uint32_t>(n - w);
+}
+
+// Fractional Stage 1 threshold: ceil(Nqkmer * P) - Nhighfreq, where 0
+// (threshold <= 0) signals that the strand is skipped.
+static uint32_t resolve_frac_threshold(uint32_t Nqkmer, uint32_t Nhighfreq,
+                                       double frac, const char* strand_name) {
+    int32_t threshold = static_cast<int32_t>(
+        std::ceil(static_cast<double>(Nqkmer) * frac))
+        - static_cast<int32_t>(Nhighfreq);
+
+    if (threshold <= 0) {
+        std::fprintf(stderr,
+            "Warning: fractional min_stage1_score threshold <= 0 "
+            "(strand=%s, Nqkmer=%u, Nhighfreq=%u, P=%.4f)\n",
+            strand_name, Nqkmer, Nhighfreq, frac);
+        return 0; // signals: skip this strand
+    }
+    return static_cast<uint32_t>(threshold);
+}
+
 // Compute global max_freq: aggregate across all volumes if auto mode.
 static uint32_t compute_global_max_freq(
     uint32_t config_max_freq,
@@ -84,16 +223,39 @@ QueryKmerData<KmerInt> preprocess_query(
     const std::vector<uint32_t>& masks) {
 
     QueryKmerData<KmerInt> result;
+    result.canonical = (t == 0 && !all_kix.empty() &&
+                        (all_kix[0]->header().flags & KIX_FLAG_CANONICAL) != 0);
+
+    // Value under which a query k-mer is stored in the index
+    auto index_key = [&](KmerInt kmer) -> uint32_t {
+        return static_cast<uint32_t>(result.canonical ? kmer_canonical(kmer, k) : kmer);
+    };
+
+    // 0. DUST low-complexity masking: k-mers overlapping masked bases are skipped
+    std::vector<uint32_t> fwd_masked, rc_masked;
+    const std::vector<uint32_t>* fwd_masked_ptr = nullptr;
+    const std::vector<uint32_t>* rc_masked_ptr = nullptr;
+    if (config.dust_level > 0) {
+        auto mask = dust_mask(query_seq, config.dust_level, config.dust_window);
+        fwd_masked = mask_prefix_sum(mask);
+        result.num_masked_positions = fwd_masked.back();
+        if (result.num_masked_positions > 0) {
+            fwd_masked_ptr = &fwd_masked;
+            std::reverse(mask.begin(), mask.end());
+            rc_masked = mask_prefix_sum(mask);
+            rc_masked_ptr = &rc_masked;
+        }
+    }
 
     // 1. Extract forward k-mers
     std::vector<std::pair<uint32_t, KmerInt>> fwd_kmers;
     if (t > 0 && !masks.empty()) {
         fwd_kmers = extract_kmers_spaced<KmerInt>(query_seq, k, masks,
                         static_cast<int>(t), &result.has_multi_degen,
-                        static_cast<int>(config.max_degen_expand));
+                        static_cast<int>(config.max_degen_expand), fwd_masked_ptr);
     } else {
         fwd_kmers = extract_kmers<KmerInt>(query_seq, k, &result.has_multi_degen,
-                        static_cast<int>(config.max_degen_expand));
+                        static_cast<int>(config.max_degen_expand), fwd_masked_ptr);
     }
     if (fwd_kmers.empty()) return result;
 
@@ -104,7 +266,7 @@ QueryKmerData<KmerInt> preprocess_query(
         std::string rc_seq = reverse_complement_string(query_seq);
         auto rc_raw = extract_kmers_spaced<KmerInt>(rc_seq, k, masks,
                           static_cast<int>(t), &result.has_multi_degen,
-                          static_cast<int>(config.max_degen_expand));
+                          static_cast<int>(config.max_degen_expand), rc_masked_ptr);
         int span = static_cast<int>(t);
         rc_kmers.reserve(rc_raw.size());
         for (const auto& [pos, kmer] : rc_raw) {
@@ -126,6 +288,8 @@ QueryKmerData<KmerInt> preprocess_query(
 
     // 4-5. Build high-freq set and filter (skip entirely when disabled)
     std::unordered_set<uint32_t> highfreq_set;
+    const bool rare_first = (config.stage1_max_postings > 0 || config.stage1_target_coverage > 0);
+    std::unordered_map<uint32_t, uint64_t> kmer_counts; // global counts (rare-first only)
 
     // Helper: convert pair vector to SoA
     auto to_soa = [](const std::vector<std::pair<uint32_t, KmerInt>>& pairs,
@@ -147,10 +311,10 @@ QueryKmerData<KmerInt> preprocess_query(
         // Collect all distinct k-mer values from both strands
         std::unordered_set<uint32_t> all_query_kmer_values;
         for (const auto& [pos, kmer] : fwd_kmers) {
-            all_query_kmer_values.insert(static_cast<uint32_t>(kmer));
+            all_query_kmer_values.insert(index_key(kmer));
         }
         for (const auto& [pos, kmer] : rc_kmers) {
-            all_query_kmer_values.insert(static_cast<uint32_t>(kmer));
+            all_query_kmer_values.insert(index_key(kmer));
         }
 
         for (uint32_t kmer_idx : all_query_kmer_values) {
@@ -165,6 +329,7 @@ QueryKmerData<KmerInt> preprocess_query(
             for (const auto* kix : all_kix) {
                 total_count += kix->count_postings(kmer_idx);
             }
+            if (rare_first) kmer_counts[kmer_idx] = total_count;
             if (total_count > global_max_freq) {
                 highfreq_set.insert(kmer_idx);
             }
@@ -174,7 +339,7 @@ QueryKmerData<KmerInt> preprocess_query(
         result.fwd_positions.reserve(fwd_kmers.size());
         result.fwd_kmer_values.reserve(fwd_kmers.size());
         for (const auto& [pos, kmer] : fwd_kmers) {
-            if (highfreq_set.count(static_cast<uint32_t>(kmer)) == 0) {
+            if (highfreq_set.count(index_key(kmer)) == 0) {
                 result.fwd_positions.push_back(pos);
                 result.fwd_kmer_values.push_back(kmer);
             }
@@ -183,13 +348,53 @@ QueryKmerData<KmerInt> preprocess_query(
         result.rc_positions.reserve(rc_kmers.size());
         result.rc_kmer_values.reserve(rc_kmers.size());
         for (const auto& [pos, kmer] : rc_kmers) {
-            if (highfreq_set.count(static_cast<uint32_t>(kmer)) == 0) {
+            if (highfreq_set.count(index_key(kmer)) == 0) {
                 result.rc_positions.push_back(pos);
                 result.rc_kmer_values.push_back(kmer);
             }
         }
     }
 
+    // 5a. Rare-first selection under a posting budget / coverage target
+    uint32_t dropped_fwd = 0, dropped_rc = 0;
+    if (rare_first) {
+        if (global_max_freq == Stage1Config::MAX_FREQ_DISABLED) {
+            // Counts were not needed for high-freq filtering; collect them now
+            auto collect = [&](const std::vector<KmerInt>& kmer_values) {
+                for (KmerInt kmer : kmer_values) {
+                    uint32_t key = index_key(kmer);
+                    if (kmer_counts.count(key)) continue;
+                    uint64_t total_count = 0;
+                    for (const auto* kix : all_kix) total_count += kix->count_postings(key);
+                    kmer_counts[key] = total_count;
+                }
+            };
+            collect(result.fwd_kmer_values);
+            collect(result.rc_kmer_values);
+        }
+        dropped_fwd = select_rare_first(result.fwd_positions, result.fwd_kmer_values,
+                                        kmer_counts, index_key, config.stage1_max_postings,
+                                        config.stage1_target_coverage);
+        dropped_rc = select_rare_first(result.rc_positions, result.rc_kmer_values,
+                                       kmer_counts, index_key, config.stage1_max_postings,
+                                       config.stage1_target_coverage);
+        result.num_dropped_kmers = dropped_fwd + dropped_rc;
+    }
+
+    // 5b. Canonical index: derive strand-collapsed lookups from the fwd k-mers
+    if (result.canonical) {
+        size_t n = result.fwd_positions.size();
+        result.can_positions = result.fwd_positions;
+        result.can_kmer_values.resize(n);
+        result.can_strands.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            KmerInt kmer = result.fwd_kmer_values[i];
+            KmerInt rc = kmer_revcomp(kmer, k);
+            result.can_kmer_values[i] = std::min(kmer, rc);
+            result.can_strands[i] = (kmer == rc) ? 2 : (rc < kmer ? 1 : 0);
+        }
+    }
+
     // 6. Resolve per-strand thresholds
     const bool use_coverscore = (config.stage1.stage1_score_type == 1);
 
@@ -200,57 +405,51 @@ QueryKmerData<KmerInt> preprocess_query(
     if (config.min_stage1_score_frac > 0) {
         // Fractional threshold resolution
 
-        // Count Nqkmer per strand: count distinct positions (handles degenerate expansion)
-        auto count_nqkmer = [&](const std::vector<std::pair<uint32_t, KmerInt>>& kmers) -> uint32_t {
-            std::unordered_set<uint32_t> positions;
-            for (const auto& [pos, kmer] : kmers) positions.insert(pos);
-            return static_cast<uint32_t>(positions.size());
-        };
-
-        uint32_t Nqkmer_fwd = count_nqkmer(fwd_kmers);
-        uint32_t Nqkmer_rc = count_nqkmer(rc_kmers);
-
-        // Count Nhighfreq per strand: count position only if ALL expanded
-        // k-mers at that position are high-freq (adjacency guaranteed by extract_kmers)
-        auto count_nhighfreq = [&](const std::vector<std::pair<uint32_t, KmerInt>>& kmers) -> uint32_t {
-            uint32_t count = 0;
+        // Nqkmer positions per strand: distinct positions (handles degenerate
+        // expansion). Nhighfreq positions: those where ALL expanded k-mers
+        // are high-freq (adjacency guaranteed by extract_kmers)
+        auto collect_positions = [&](const std::vector<std::pair<uint32_t, KmerInt>>& kmers,
+                                     std::vector<uint32_t>& nqkmer,
+                                     std::vector<uint32_t>& nhighfreq) {
             size_t i = 0;
             while (i < kmers.size()) {
                 uint32_t cur_pos = kmers[i].first;
                 bool all_highfreq = true;
                 while (i < kmers.size() && kmers[i].first == cur_pos) {
-                    if (highfreq_set.count(static_cast<uint32_t>(kmers[i].second)) == 0)
+                    if (highfreq_set.count(index_key(kmers[i].second)) == 0)
                         all_highfreq = false;
                     i++;
                 }
-                if (all_highfreq) count++;
+                nqkmer.push_back(cur_pos);
+                if (all_highfreq) nhighfreq.push_back(cur_pos);
             }
-            return count;
         };
 
-        uint32_t Nhighfreq_fwd = count_nhighfreq(fwd_kmers);
-        uint32_t Nhighfreq_rc = count_nhighfreq(rc_kmers);
-
-        // Compute threshold per strand
-        auto resolve_threshold = [&](uint32_t Nqkmer, uint32_t Nhighfreq,
-                                     const char* strand_name) -> uint32_t {
-            int32_t threshold = static_cast<int32_t>(
-                std::ceil(static_cast<double>(Nqkmer) * config.min_stage1_score_frac))
-                - static_cast<int32_t>(Nhighfreq);
-
-            if (threshold <= 0) {
-                std::fprintf(stderr,
-                    "Warning: fractional min_stage1_score threshold <= 0 "
-                    "(strand=%s, Nqkmer=%u, Nhighfreq=%u, P=%.4f)\n",
-                    strand_name, Nqkmer, Nhighfreq,
-                    config.min_stage1_score_frac);
-                return 0; // signals: skip this strand
-            }
-            return static_cast<uint32_t>(threshold);
-        };
+        // Rare-first selection dropped k-mers: resolve against the selected set
+        if (dropped_fwd > 0) {
+            result.frac_nqkmer_fwd = result.fwd_positions;
+        } else {
+            collect_positions(fwd_kmers, result.frac_nqkmer_fwd, result.frac_nhighfreq_fwd);
+        }
+        if (dropped_rc > 0) {
+            result.frac_nqkmer_rc = result.rc_positions;
+        } else {
+            collect_positions(rc_kmers, result.frac_nqkmer_rc, result.frac_nhighfreq_rc);
+        }
+        for (auto* v : {&result.frac_nqkmer_fwd, &result.frac_nqkmer_rc,
+                        &result.frac_nhighfreq_fwd, &result.frac_nhighfreq_rc}) {
+            std::sort(v->begin(), v->end());
+            v->erase(std::unique(v->begin(), v->end()), v->end());
+        }
 
-        result.resolved_threshold_fwd = resolve_threshold(Nqkmer_fwd, Nhighfreq_fwd, "fwd");
-        result.resolved_threshold_rc = resolve_threshold(Nqkmer_rc, Nhighfreq_rc, "rc");
+        result.resolved_threshold_fwd = resolve_frac_threshold(
+            static_cast<uint32_t>(result.frac_nqkmer_fwd.size()),
+            static_cast<uint32_t>(result.frac_nhighfreq_fwd.size()),
+            config.min_stage1_score_frac, "fwd");
+        result.resolved_threshold_rc = resolve_frac_threshold(
+            static_cast<uint32_t>(result.frac_nqkmer_rc.size()),
+            static_cast<uint32_t>(result.frac_nhighfreq_rc.size()),
+            config.min_stage1_score_frac, "rc");
     }
 
     // 7. Resolve effective_min_score per strand
@@ -271,9 +470,105 @@ QueryKmerData<KmerInt> preprocess_query(
         }
     }
 
+    // 8. Reorder k-mers for index locality (Stage 1/2 scoring is order-independent)
+    {
+        auto order = locality_order(result.fwd_positions, result.fwd_kmer_values);
+        apply_order(result.fwd_positions, order);
+        apply_order(result.fwd_kmer_values, order);
+    }
+    {
+        auto order = locality_order(result.rc_positions, result.rc_kmer_values);
+        apply_order(result.rc_positions, order);
+        apply_order(result.rc_kmer_values, order);
+    }
+    if (result.canonical) {
+        auto order = locality_order(result.can_positions, result.can_kmer_values);
+        apply_order(result.can_positions, order);
+        apply_order(result.can_kmer_values, order);
+        apply_order(result.can_strands, order);
+    }
+
     return result;
 }
 
+template <typename KmerInt>
+std::vector<QueryWindow<KmerInt>> split_query_windows(
+    const QueryKmerData<KmerInt>& qdata, uint32_t query_len,
+    const SearchConfig& config) {
+
+    const uint32_t step = config.query_window;
+    const uint32_t overlap = config.query_window_overlap;
+    if (step == 0 || query_len <= step) return {};
+
+    // Copy the k-mers starting in [begin, end), rebased, keeping locality order
+    auto slice = [](const std::vector<uint32_t>& positions,
+                    const std::vector<KmerInt>& kmers,
+                    uint32_t begin, uint32_t end,
+                    std::vector<uint32_t>& out_pos, std::vector<KmerInt>& out_kmers,
+                    std::vector<size_t>* picked) {
+        for (size_t i = 0; i < positions.size(); i++) {
+            if (positions[i] < begin || positions[i] >= end) continue;
+            out_pos.push_back(positions[i] - begin);
+            out_kmers.push_back(kmers[i]);
+            if (picked) picked->push_back(i);
+        }
+    };
+
+    // Positions of a sorted list in [begin, end)
+    auto count_in = [](const std::vector<uint32_t>& sorted, uint32_t begin, uint32_t end) {
+        return static_cast<uint32_t>(
+            std::lower_bound(sorted.begin(), sorted.end(), end) -
+            std::lower_bound(sorted.begin(), sorted.end(), begin));
+    };
+
+    // Same rules as preprocess_query() steps 6-7, over the window's positions
+    auto resolve = [&](const std::vector<uint32_t>& nqkmer,
+                       const std::vector<uint32_t>& nhighfreq,
+                       uint32_t begin, uint32_t end, const char* strand_name,
+                       uint32_t& threshold, uint32_t& min_score) {
+        threshold = config.stage1.min_stage1_score;
+        if (config.min_stage1_score_frac > 0) {
+            threshold = resolve_frac_threshold(
+                count_in(nqkmer, begin, end), count_in(nhighfreq, begin, end),
+                config.min_stage1_score_frac, strand_name);
+        }
+        min_score = (config.stage2.min_score > 0) ? config.stage2.min_score : threshold;
+    };
+
+    std::vector<QueryWindow<KmerInt>> windows;
+    for (uint32_t core_b = 0; core_b < query_len; core_b += step) {
+        uint32_t core_e = core_b + std::min(step, query_len - core_b);
+        uint32_t begin = (core_b > overlap) ? core_b - overlap : 0;
+        uint32_t end = (query_len - core_e > overlap) ? core_e + overlap : query_len;
+
+        QueryWindow<KmerInt> w;
+        w.offset = begin;
+        w.core_begin = core_b - begin;
+        w.core_end = core_e - begin;
+        auto& wd = w.qdata;
+        wd.canonical = qdata.canonical;
+        wd.has_multi_degen = qdata.has_multi_degen;
+        slice(qdata.fwd_positions, qdata.fwd_kmer_values, begin, end,
+              wd.fwd_positions, wd.fwd_kmer_values, nullptr);
+        slice(qdata.rc_positions, qdata.rc_kmer_values, begin, end,
+              wd.rc_positions, wd.rc_kmer_values, nullptr);
+        if (qdata.canonical) {
+            std::vector<size_t> picked;
+            slice(qdata.can_positions, qdata.can_kmer_values, begin, end,
+                  wd.can_positions, wd.can_kmer_values, &picked);
+            for (size_t i : picked) wd.can_strands.push_back(qdata.can_strands[i]);
+        }
+        resolve(qdata.frac_nqkmer_fwd, qdata.frac_nhighfreq_fwd, begin, end, "fwd",
+                wd.resolved_threshold_fwd, w.min_score_fwd);
+        resolve(qdata.frac_nqkmer_rc, qdata.frac_nhighfreq_rc, begin, end, "rc",
+                wd.resolved_threshold_rc, w.min_score_rc);
+        wd.effective_min_score_fwd = (w.min_score_fwd + 1) / 2;
+        wd.effective_min_score_rc = (w.min_score_rc + 1) / 2;
+        windows.push_back(std::move(w));
+    }
+    return windows;
+}
+
 // Explicit template instantiations
 template QueryKmerData<uint16_t> preprocess_query<uint16_t>(
     const std::string&, int,
@@ -290,4 +585,9 @@ template QueryKmerData<uint32_t> preprocess_query<uint32_t>(
     uint8_t,
     const std::vector<uint32_t>&);
 
+template std::vector<QueryWindow<uint16_t>> split_query_windows<uint16_t>(
+    const QueryKmerData<uint16_t>&, uint32_t, const SearchConfig&);
+template std::vector<QueryWindow<uint32_t>> split_query_windows<uint32_t>(
+    const QueryKmerData<uint32_t>&, uint32_t, const SearchConfig&);
+
 } // namespace ikafssn
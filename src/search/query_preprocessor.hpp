@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -12,6 +13,8 @@ struct SearchConfig;
 
 // Pre-processed query k-mer data with global high-freq filtering applied.
 // Generated once per query before the volume loop.
+// K-mers are in locality order (sorted by k-mer value; positions with several
+// degenerate expansions grouped at the end), not in query-position order.
 template <typename KmerInt>
 struct QueryKmerData {
     std::vector<uint32_t> fwd_positions;  // query positions (high-freq removed)
@@ -23,10 +26,72 @@ struct QueryKmerData {
     uint32_t effective_min_score_fwd = 0;  // for Stage 2 (fwd)
     uint32_t effective_min_score_rc = 0;   // for Stage 2 (rc)
     bool has_multi_degen = false;  // true if any k-mer had 2+ degenerate bases (skipped)
+    uint32_t num_dropped_kmers = 0;  // k-mers dropped by rare-first selection (fwd + rc)
+    uint32_t num_masked_positions = 0;  // query bases masked as low-complexity (DUST)
+
+    // Fractional threshold inputs (min_stage1_score_frac > 0 only), sorted:
+    // the distinct query positions counted as Nqkmer and, among them, those
+    // counted as Nhighfreq. Kept so split_query_windows() can re-resolve the
+    // threshold over a window's positions.
+    std::vector<uint32_t> frac_nqkmer_fwd;
+    std::vector<uint32_t> frac_nqkmer_rc;
+    std::vector<uint32_t> frac_nhighfreq_fwd;
+    std::vector<uint32_t> frac_nhighfreq_rc;
+
+    // Canonical index (KIX_FLAG_CANONICAL): one strand-collapsed lookup per position.
+    bool canonical = false;
+    std::vector<uint32_t> can_positions;   // query positions (high-freq removed)
+    std::vector<KmerInt>  can_kmer_values; // canonical k-mer values
+    std::vector<uint8_t>  can_strands;     // 0=fwd k-mer is canonical, 1=rc is, 2=palindrome
+};
+
+// Largest query position kept in q (0 if none). Stage 1 deduplicates hits
+// by position, so its tier must hold this value as well as the k-mer count
+// (see select_tier()): rare-first selection and DUST masking keep few
+// k-mers of a long query.
+template <typename KmerInt>
+uint32_t max_query_position(const QueryKmerData<KmerInt>& q) {
+    uint32_t m = 0;
+    for (const auto* v : {&q.fwd_positions, &q.rc_positions, &q.can_positions}) {
+        if (!v->empty()) m = std::max(m, *std::max_element(v->begin(), v->end()));
+    }
+    return m;
+}
+
+// One window of a long query (see split_query_windows()). qdata holds the
+// k-mers of the window, with positions rebased to offset; Stage 2 chains
+// only the hits of the core [core_begin, core_end). A chain crossing a core
+// boundary is split between windows, so qdata's effective_min_score is half
+// of the window's minimum chain score (min_score_*), which is applied after
+// the parts are stitched (merge_window_results()).
+template <typename KmerInt>
+struct QueryWindow {
+    uint32_t offset = 0;      // whole-query position of window position 0
+    uint32_t core_begin = 0;  // core range, window positions
+    uint32_t core_end = 0;
+    uint32_t min_score_fwd = 0;
+    uint32_t min_score_rc = 0;
+    QueryKmerData<KmerInt> qdata;
 };
 
-// Pre-process a query sequence: extract k-mers, determine global high-freq
+// Split a preprocessed query of query_len bases into windows whose cores
+// tile the query in steps of config.query_window bases, each extended by
+// config.query_window_overlap bases on either side for Stage 1 scoring.
+// Thresholds are re-resolved per window: a fractional -stage1_min_score
+// applies the preprocess_query() rule, ceil(Nqkmer * P) - Nhighfreq, to the
+// positions in the window (a strand whose threshold is <= 0 is skipped);
+// an absolute one is kept.
+// Returns no windows if windowing is disabled or the query fits in one.
+template <typename KmerInt>
+std::vector<QueryWindow<KmerInt>> split_query_windows(
+    const QueryKmerData<KmerInt>& qdata, uint32_t query_len,
+    const SearchConfig& config);
+
+// Pre-process a query sequence: extract k-mers (dropping those that overlap
+// DUST-masked bases when config.dust_level > 0), determine global high-freq
 // k-mers across all volumes, filter them out, and resolve per-strand thresholds.
+// If the index is canonical (KIX_FLAG_CANONICAL on all_kix[0]), high-freq counts
+// are looked up by canonical value and the can_* arrays are filled as well.
 //
 // all_kix: pointers to KixReaders for ALL volumes (for global count aggregation).
 // khx: nullable pointer to shared KhxReader for build-time exclusion info.
@@ -54,4 +119,9 @@ extern template QueryKmerData<uint32_t> preprocess_query<uint32_t>(
     uint8_t,
     const std::vector<uint32_t>&);
 
+extern template std::vector<QueryWindow<uint16_t>> split_query_windows<uint16_t>(
+    const QueryKmerData<uint16_t>&, uint32_t, const SearchConfig&);
+extern template std::vector<QueryWindow<uint32_t>> split_query_windows<uint32_t>(
+    const QueryKmerData<uint32_t>&, uint32_t, const SearchConfig&);
+
 } // namespace ikafssn
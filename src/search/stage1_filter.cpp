@@ -1,7 +1,9 @@
 #include "search/stage1_filter.hpp"
 #include "search/oid_filter.hpp"
 #include "search/seq_id_decoder.hpp"
+#include "search/posting_decoder.hpp"
 #include "index/kix_reader.hpp"
+#include "index/kpx_reader.hpp"
 #include "core/config.hpp"
 #include "core/varint.hpp"
 
@@ -23,72 +25,129 @@ uint32_t compute_effective_max_freq(uint32_t config_max_freq,
     return max_freq;
 }
 
-// Internal implementation with KmerInt + Tier template dispatch.
-template <typename KmerInt, Stage1Tier Tier>
-static std::vector<Stage1Candidate> stage1_filter_impl(
+// Look-ahead prefetch for query k-mer qi: offset entries of k-mer qi+dist,
+// ID posting list head of k-mer qi+dist/2 (whose offset was prefetched earlier).
+// Reader = KixReader, or KpxReader for the position lists of the fused pass.
+template <typename Reader, typename KmerInt>
+static inline void prefetch_ahead(const Reader& reader, const KmerInt* kmers,
+                                  size_t n, size_t qi, uint32_t dist) {
+    if (dist == 0) return;
+    if (qi + dist < n) reader.prefetch_offset(kmers[qi + dist]);
+    if (dist >= 2 && qi + dist / 2 < n) reader.prefetch_posting(kmers[qi + dist / 2]);
+}
+
+// Score the postings of n query k-mers into buf (capacity already ensured).
+// Fused: also decode .kpx positions (kpx != nullptr) and append every
+// posting that passes the OID filter to buf.postings.
+template <typename KmerInt, Stage1Tier Tier, bool Fused>
+static void score_kmers(
     const uint32_t* positions, const KmerInt* kmers, size_t n,
     const KixReader& kix,
+    const KpxReader* kpx,
     const OidFilter& filter,
     const Stage1Config& config,
-    Stage1Buffer* buf) {
+    Stage1Buffer& buf) {
 
     using Entry = Stage1Entry<Tier>;
-    using ScoreT = decltype(Entry::score);
     using PosT = decltype(Entry::last_pos);
-    constexpr PosT SENTINEL = std::numeric_limits<PosT>::max();
-
-    uint32_t num_seqs = kix.num_sequences();
-    if (num_seqs == 0 || n == 0) return {};
 
     const uint8_t* posting_data = kix.posting_data();
     const bool use_coverscore = (config.stage1_score_type == 1);
+    auto* entries = reinterpret_cast<Entry*>(buf.data.data());
 
-    if (buf) {
-        buf->ensure_capacity(num_seqs);
-        auto* entries = reinterpret_cast<Entry*>(buf->data.data());
+    auto score_posting = [&](SeqId sid, PosT q_pos) {
+        if (entries[sid].score == 0) buf.dirty.push_back(sid);
+        if (entries[sid].last_pos != q_pos) {
+            entries[sid].score++;
+            entries[sid].last_pos = q_pos;
+        }
+    };
 
-        for (size_t qi = 0; qi < n; qi++) {
-            auto q_pos = static_cast<PosT>(positions[qi]);
-            auto kmer_idx = kmers[qi];
-            auto off = kix.posting_offset(kmer_idx);
-            auto end_off = kix.posting_offset(kmer_idx + 1);
-            if (off == end_off) continue;
+    for (size_t qi = 0; qi < n; qi++) {
+        prefetch_ahead(kix, kmers, n, qi, config.prefetch_distance);
+        if constexpr (Fused) prefetch_ahead(*kpx, kmers, n, qi, config.prefetch_distance);
+        auto q_pos = static_cast<PosT>(positions[qi]);
+        auto kmer_idx = kmers[qi];
+        auto off = kix.posting_offset(kmer_idx);
+        auto end_off = kix.posting_offset(kmer_idx + 1);
+        if (off == end_off) continue;
 
-            SeqIdDecoder decoder(posting_data + off, posting_data + end_off);
+        SeqIdDecoder decoder(posting_data + off, posting_data + end_off);
+        if constexpr (Fused) {
+            PosDecoder pos_decoder(kpx->posting_data() + kpx->pos_offset(kmer_idx));
+            while (decoder.has_more()) {
+                SeqId sid = decoder.next();
+                uint32_t s_pos = pos_decoder.next(decoder.was_new_seq());
+                if (!filter.pass(sid)) continue;
+                buf.postings.push_back({sid, positions[qi], s_pos});
+                if (use_coverscore && !decoder.was_new_seq()) continue;
+                score_posting(sid, q_pos);
+            }
+        } else {
             while (decoder.has_more()) {
                 SeqId sid = decoder.next();
                 if (use_coverscore && !decoder.was_new_seq()) continue;
                 if (!filter.pass(sid)) continue;
-                if (entries[sid].score == 0) buf->dirty.push_back(sid);
-                if (entries[sid].last_pos != q_pos) {
-                    entries[sid].score++;
-                    entries[sid].last_pos = q_pos;
-                }
+                score_posting(sid, q_pos);
             }
         }
+    }
+}
 
-        std::vector<Stage1Candidate> candidates;
-        for (uint32_t sid : buf->dirty) {
-            if (entries[sid].score >= config.min_stage1_score) {
-                candidates.push_back({sid, static_cast<uint32_t>(entries[sid].score)});
-            }
+// Gather the scored sequences of buf that reach min_stage1_score, reset the
+// touched entries and apply stage1_topn.
+template <Stage1Tier Tier>
+static std::vector<Stage1Candidate> collect_candidates(
+    const Stage1Config& config, Stage1Buffer& buf) {
+
+    auto* entries = reinterpret_cast<Stage1Entry<Tier>*>(buf.data.data());
+    std::vector<Stage1Candidate> candidates;
+    for (uint32_t sid : buf.dirty) {
+        if (entries[sid].score >= config.min_stage1_score) {
+            candidates.push_back({sid, static_cast<uint32_t>(entries[sid].score)});
         }
+    }
 
-        buf->clear_dirty_typed<Tier>();
+    buf.clear_dirty_typed<Tier>();
 
-        if (config.stage1_topn == 0) return candidates;
+    if (config.stage1_topn == 0) return candidates;
 
-        auto cmp = [](const Stage1Candidate& a, const Stage1Candidate& b) {
-            return a.score > b.score;
-        };
-        if (candidates.size() > config.stage1_topn) {
-            std::nth_element(candidates.begin(),
-                             candidates.begin() + config.stage1_topn,
-                             candidates.end(), cmp);
-            candidates.resize(config.stage1_topn);
-        }
-        std::sort(candidates.begin(), candidates.end(), cmp);
-        return candidates;
+    auto cmp = [](const Stage1Candidate& a, const Stage1Candidate& b) {
+        return a.score > b.score;
+    };
+    if (candidates.size() > config.stage1_topn) {
+        std::nth_element(candidates.begin(),
+                         candidates.begin() + config.stage1_topn,
+                         candidates.end(), cmp);
+        candidates.resize(config.stage1_topn);
+    }
+    std::sort(candidates.begin(), candidates.end(), cmp);
+    return candidates;
+}
+
+// Internal implementation with KmerInt + Tier template dispatch.
+// Fused: also decode .kpx positions (kpx != nullptr, buf != nullptr) and
+// append every posting that passes the OID filter to buf->postings.
+template <typename KmerInt, Stage1Tier Tier, bool Fused>
+static std::vector<Stage1Candidate> stage1_filter_impl(
+    const uint32_t* positions, const KmerInt* kmers, size_t n,
+    const KixReader& kix,
+    const KpxReader* kpx,
+    const OidFilter& filter,
+    const Stage1Config& config,
+    Stage1Buffer* buf) {
+
+    uint32_t num_seqs = kix.num_sequences();
+    if (num_seqs == 0 || n == 0) return {};
+
+    const uint8_t* posting_data = kix.posting_data();
+    const bool use_coverscore = (config.stage1_score_type == 1);
+
+    if (buf) {
+        buf->ensure_capacity(num_seqs);
+        score_kmers<KmerInt, Tier, Fused>(positions, kmers, n, kix, kpx,
+                                          filter, config, *buf);
+        return collect_candidates<Tier>(config, *buf);
     }
 
     // Fallback: allocate local T32 buffer (always safe)
@@ -99,6 +158,7 @@ static std::vector<Stage1Candidate> stage1_filter_impl(
     }
 
     for (size_t qi = 0; qi < n; qi++) {
+        prefetch_ahead(kix, kmers, n, qi, config.prefetch_distance);
         uint32_t q_pos = positions[qi];
         auto kmer_idx = kmers[qi];
         auto off = kix.posting_offset(kmer_idx);
@@ -139,6 +199,32 @@ static std::vector<Stage1Candidate> stage1_filter_impl(
     return candidates;
 }
 
+// Multi-template Stage 1: every template is scored into the same entries.
+// last_pos is reset between templates, so equal query positions of two
+// templates both count and each score is the sum of the per-template scores.
+template <typename KmerInt, Stage1Tier Tier>
+static std::vector<Stage1Candidate> stage1_filter_multi_impl(
+    const Stage1Template<KmerInt>* templates, size_t num_templates,
+    const OidFilter& filter,
+    const Stage1Config& config,
+    Stage1Buffer& buf) {
+
+    using Entry = Stage1Entry<Tier>;
+    using PosT = decltype(Entry::last_pos);
+
+    for (size_t t = 0; t < num_templates; t++) {
+        const auto& tp = templates[t];
+        if (tp.n == 0 || tp.kix->num_sequences() == 0) continue;
+        buf.ensure_capacity(tp.kix->num_sequences());
+        auto* entries = reinterpret_cast<Entry*>(buf.data.data());
+        for (uint32_t sid : buf.dirty)
+            entries[sid].last_pos = std::numeric_limits<PosT>::max();
+        score_kmers<KmerInt, Tier, false>(tp.positions, tp.kmers, tp.n, *tp.kix,
+                                          nullptr, filter, config, buf);
+    }
+    return collect_candidates<Tier>(config, buf);
+}
+
 // Public dispatch: selects tier from buffer (or uses T32 fallback).
 template <typename KmerInt>
 std::vector<Stage1Candidate> stage1_filter(
@@ -151,15 +237,80 @@ std::vector<Stage1Candidate> stage1_filter(
     Stage1Tier tier = buf ? buf->tier : Stage1Tier::T32;
     switch (tier) {
     case Stage1Tier::T8:
-        return stage1_filter_impl<KmerInt, Stage1Tier::T8>(
-            positions, kmers, n, kix, filter, config, buf);
+        return stage1_filter_impl<KmerInt, Stage1Tier::T8, false>(
+            positions, kmers, n, kix, nullptr, filter, config, buf);
+    case Stage1Tier::T16:
+        return stage1_filter_impl<KmerInt, Stage1Tier::T16, false>(
+            positions, kmers, n, kix, nullptr, filter, config, buf);
+    case Stage1Tier::T32:
+    default:
+        return stage1_filter_impl<KmerInt, Stage1Tier::T32, false>(
+            positions, kmers, n, kix, nullptr, filter, config, buf);
+    }
+}
+
+template <typename KmerInt>
+std::vector<Stage1Candidate> stage1_filter_fused(
+    const uint32_t* positions, const KmerInt* kmers, size_t n,
+    const KixReader& kix,
+    const KpxReader& kpx,
+    const OidFilter& filter,
+    const Stage1Config& config,
+    Stage1Buffer& buf) {
+
+    buf.postings.clear();
+    switch (buf.tier) {
+    case Stage1Tier::T8:
+        return stage1_filter_impl<KmerInt, Stage1Tier::T8, true>(
+            positions, kmers, n, kix, &kpx, filter, config, &buf);
+    case Stage1Tier::T16:
+        return stage1_filter_impl<KmerInt, Stage1Tier::T16, true>(
+            positions, kmers, n, kix, &kpx, filter, config, &buf);
+    case Stage1Tier::T32:
+    default:
+        return stage1_filter_impl<KmerInt, Stage1Tier::T32, true>(
+            positions, kmers, n, kix, &kpx, filter, config, &buf);
+    }
+}
+
+template <typename KmerInt>
+std::vector<Stage1Candidate> stage1_filter_multi(
+    const Stage1Template<KmerInt>* templates, size_t num_templates,
+    const OidFilter& filter,
+    const Stage1Config& config,
+    Stage1Buffer* buf) {
+
+    // Summed scores need a tier wide enough for all templates' k-mers, and
+    // the last_pos dedup one wide enough for every query position
+    size_t total_n = 0;
+    uint32_t max_pos = 0;
+    for (size_t t = 0; t < num_templates; t++) {
+        total_n += templates[t].n;
+        for (size_t i = 0; i < templates[t].n; i++) {
+            max_pos = std::max(max_pos, templates[t].positions[i]);
+        }
+    }
+    if (total_n == 0) return {};
+    uint32_t limit = static_cast<uint32_t>(
+        std::min<size_t>(total_n, std::numeric_limits<uint32_t>::max()));
+    Stage1Tier need = select_tier(limit, max_pos);
+
+    Stage1Buffer local_buf;
+    if (!buf || static_cast<uint8_t>(buf->tier) < static_cast<uint8_t>(need)) {
+        local_buf.tier = need;
+        buf = &local_buf;
+    }
+    switch (buf->tier) {
+    case Stage1Tier::T8:
+        return stage1_filter_multi_impl<KmerInt, Stage1Tier::T8>(
+            templates, num_templates, filter, config, *buf);
     case Stage1Tier::T16:
-        return stage1_filter_impl<KmerInt, Stage1Tier::T16>(
-            positions, kmers, n, kix, filter, config, buf);
+        return stage1_filter_multi_impl<KmerInt, Stage1Tier::T16>(
+            templates, num_templates, filter, config, *buf);
     case Stage1Tier::T32:
     default:
-        return stage1_filter_impl<KmerInt, Stage1Tier::T32>(
-            positions, kmers, n, kix, filter, config, buf);
+        return stage1_filter_multi_impl<KmerInt, Stage1Tier::T32>(
+            templates, num_templates, filter, config, *buf);
     }
 }
 
@@ -173,4 +324,20 @@ template std::vector<Stage1Candidate> stage1_filter<uint32_t>(
     const KixReader&, const OidFilter&, const Stage1Config&,
     Stage1Buffer*);
 
+template std::vector<Stage1Candidate> stage1_filter_fused<uint16_t>(
+    const uint32_t*, const uint16_t*, size_t,
+    const KixReader&, const KpxReader&, const OidFilter&, const Stage1Config&,
+    Stage1Buffer&);
+template std::vector<Stage1Candidate> stage1_filter_fused<uint32_t>(
+    const uint32_t*, const uint32_t*, size_t,
+    const KixReader&, const KpxReader&, const OidFilter&, const Stage1Config&,
+    Stage1Buffer&);
+
+template std::vector<Stage1Candidate> stage1_filter_multi<uint16_t>(
+    const Stage1Template<uint16_t>*, size_t,
+    const OidFilter&, const Stage1Config&, Stage1Buffer*);
+template std::vector<Stage1Candidate> stage1_filter_multi<uint32_t>(
+    const Stage1Template<uint32_t>*, size_t,
+    const OidFilter&, const Stage1Config&, Stage1Buffer*);
+
 } // namespace ikafssn
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <limits>
@@ -10,8 +11,16 @@
 namespace ikafssn {
 
 class KixReader;
+class KpxReader;
 class OidFilter;
 
+// One posting buffered by the fused Stage 1 + Stage 2 pass.
+struct PostingHit {
+    SeqId id;
+    uint32_t q_pos;
+    uint32_t s_pos;
+};
+
 // Tier selection for Stage1Buffer: controls entry size per sequence.
 enum class Stage1Tier : uint8_t { T8 = 0, T16 = 1, T32 = 2 };
 
@@ -44,6 +53,19 @@ struct Stage1Buffer {
     Stage1Tier tier = Stage1Tier::T32;
     uint32_t capacity = 0;           // num_seqs capacity
 
+    // Stage 2 workspace (see HitArena in volume_searcher.cpp); grown on
+    // demand and kept across queries, slot_of is all zero between uses.
+    // A hit arena above max_retained_hits is freed after use instead, so
+    // one query with a huge hit set does not pin its memory in every
+    // (thread-local) buffer for the lifetime of the worker.
+    size_t max_retained_hits = size_t(1) << 22;  // 32 MiB of Hit
+    std::vector<uint32_t> slot_of;   // seq ID -> candidate slot + 1 (0 = none)
+    std::vector<SeqId> slot_ids;     // candidate slot -> seq ID
+    std::vector<size_t> hit_begin;   // per hit list: count, then arena offset
+    std::vector<size_t> hit_end;     // per hit list: fill cursor / end offset
+    std::vector<Hit> hit_arena;      // all hit lists, contiguous per list
+    std::vector<PostingHit> postings; // fused Stage 1 + 2: postings in decode order
+
     void ensure_capacity(uint32_t num_seqs) {
         if (capacity >= num_seqs) return;
         capacity = num_seqs;
@@ -126,6 +148,10 @@ struct Stage1Config {
     uint32_t stage1_topn = 0;
     uint32_t min_stage1_score = 1;
     uint8_t  stage1_score_type = 1;
+    // Software prefetch look-ahead in query k-mers (0 = disabled).
+    // Offset entries are prefetched D k-mers ahead, posting list heads D/2 ahead.
+    // Also used by Stage 2 position collection for the .kpx counterparts.
+    uint32_t prefetch_distance = 16;
 };
 
 uint32_t compute_effective_max_freq(uint32_t config_max_freq,
@@ -140,6 +166,41 @@ std::vector<Stage1Candidate> stage1_filter(
     const Stage1Config& config,
     Stage1Buffer* buf = nullptr);
 
+// Fused Stage 1 + Stage 2 collection: returns the same candidates as
+// stage1_filter(), but decodes .kpx positions together with the IDs and
+// leaves every posting that passes the OID filter in buf.postings (in
+// query k-mer order), so Stage 2 needs no second decode of the lists.
+template <typename KmerInt>
+std::vector<Stage1Candidate> stage1_filter_fused(
+    const uint32_t* positions, const KmerInt* kmers, size_t n,
+    const KixReader& kix,
+    const KpxReader& kpx,
+    const OidFilter& filter,
+    const Stage1Config& config,
+    Stage1Buffer& buf);
+
+// One template's query k-mers and index, for stage1_filter_multi().
+template <typename KmerInt>
+struct Stage1Template {
+    const uint32_t* positions;
+    const KmerInt* kmers;
+    size_t n;
+    const KixReader* kix;
+};
+
+// Multi-template Stage 1 ("both" mode): scores the query k-mers of all
+// templates in one accumulator, so each candidate's score is the sum of its
+// stage1_filter() scores over the templates, and min_stage1_score /
+// stage1_topn apply to that sum. All templates must index the same volume.
+// Falls back to a local buffer if buf is null or its tier is too narrow
+// for the summed score or the largest query position.
+template <typename KmerInt>
+std::vector<Stage1Candidate> stage1_filter_multi(
+    const Stage1Template<KmerInt>* templates, size_t num_templates,
+    const OidFilter& filter,
+    const Stage1Config& config,
+    Stage1Buffer* buf = nullptr);
+
 extern template std::vector<Stage1Candidate> stage1_filter<uint16_t>(
     const uint32_t*, const uint16_t*, size_t,
     const KixReader&, const OidFilter&, const Stage1Config&,
@@ -149,4 +210,20 @@ extern template std::vector<Stage1Candidate> stage1_filter<uint32_t>(
     const KixReader&, const OidFilter&, const Stage1Config&,
     Stage1Buffer*);
 
+extern template std::vector<Stage1Candidate> stage1_filter_fused<uint16_t>(
+    const uint32_t*, const uint16_t*, size_t,
+    const KixReader&, const KpxReader&, const OidFilter&, const Stage1Config&,
+    Stage1Buffer&);
+extern template std::vector<Stage1Candidate> stage1_filter_fused<uint32_t>(
+    const uint32_t*, const uint32_t*, size_t,
+    const KixReader&, const KpxReader&, const OidFilter&, const Stage1Config&,
+    Stage1Buffer&);
+
+extern template std::vector<Stage1Candidate> stage1_filter_multi<uint16_t>(
+    const Stage1Template<uint16_t>*, size_t,
+    const OidFilter&, const Stage1Config&, Stage1Buffer*);
+extern template std::vector<Stage1Candidate> stage1_filter_multi<uint32_t>(
+    const Stage1Template<uint32_t>*, size_t,
+    const OidFilter&, const Stage1Config&, Stage1Buffer*);
+
 } // namespace ikafssn
@@ -7,65 +7,384 @@
 
 namespace ikafssn {
 
-std::vector<ChainResult> chain_hits(const std::vector<Hit>& raw_hits,
-                                    SeqId seq_id,
-                                    int span,
-                                    bool is_reverse,
-                                    const Stage2Config& config) {
-    if (raw_hits.empty()) return {};
+// Below this many hits the quadratic DP is cheaper than building the tree.
+static constexpr size_t EXACT_DP_MIN_HITS = 64;
+
+// Chaining DP with a bounded lookback window (lookback = 0: all predecessors).
+// hits must be sorted by (q_pos, s_pos).
+static void chain_dp_quadratic(const Hit* hits, size_t n, uint32_t max_gap,
+                               uint32_t lookback,
+                               std::vector<uint32_t>& dp,
+                               std::vector<int32_t>& prev) {
+    dp.assign(n, 1);
+    prev.assign(n, -1);
+
+    for (size_t i = 1; i < n; i++) {
+        size_t j_start = (lookback > 0 && i > lookback) ? (i - lookback) : 0;
+        for (size_t j = j_start; j < i; j++) {
+            if (hits[j].q_pos >= hits[i].q_pos) continue;
+            if (hits[j].s_pos >= hits[i].s_pos) continue;
+
+            int64_t gap_q = static_cast<int64_t>(hits[i].q_pos) - static_cast<int64_t>(hits[j].q_pos);
+            int64_t gap_s = static_cast<int64_t>(hits[i].s_pos) - static_cast<int64_t>(hits[j].s_pos);
+            int64_t diag_diff = std::abs(gap_s - gap_q);
+
+            if (diag_diff <= static_cast<int64_t>(max_gap)) {
+                if (dp[j] + 1 > dp[i]) {
+                    dp[i] = dp[j] + 1;
+                    prev[i] = static_cast<int32_t>(j);
+                }
+            }
+        }
+    }
+}
+
+// Exact chaining DP without a lookback window.
+// Hit j can precede hit i iff q_j < q_i, s_j < s_i and |d_i - d_j| <= max_gap
+// (d = s_pos - q_pos). Hits are visited in q_pos groups, so every inserted hit
+// satisfies q_j < q_i; the best predecessor is then a range max over
+// diagonals [d_i - max_gap, d_i + max_gap] restricted to s_j < s_i. This is
+// answered by a segment tree over diagonal ranks whose nodes hold a max
+// Fenwick tree over their sorted s_pos values: O(n log^2 n) instead of O(n^2).
+// Keys pack (score, ~index), so ties resolve to the lowest hit index exactly
+// as in chain_dp_quadratic().
+// hits must be sorted by (q_pos, s_pos).
+static void chain_dp_exact(const Hit* hits, size_t n, uint32_t max_gap,
+                           std::vector<uint32_t>& dp,
+                           std::vector<int32_t>& prev) {
+    dp.assign(n, 1);
+    prev.assign(n, -1);
+
+    auto diag_of = [&](size_t i) -> int64_t {
+        return static_cast<int64_t>(hits[i].s_pos) - static_cast<int64_t>(hits[i].q_pos);
+    };
+
+    // Diagonal ranks
+    std::vector<int64_t> diags(n);
+    for (size_t i = 0; i < n; i++) diags[i] = diag_of(i);
+    std::sort(diags.begin(), diags.end());
+    diags.erase(std::unique(diags.begin(), diags.end()), diags.end());
+    const size_t m = diags.size();
+    std::vector<uint32_t> rank(n);
+    for (size_t i = 0; i < n; i++) {
+        rank[i] = static_cast<uint32_t>(
+            std::lower_bound(diags.begin(), diags.end(), diag_of(i)) - diags.begin());
+    }
+
+    size_t sz = 1;
+    while (sz < m) sz <<= 1;
+
+    // Node lists: sorted s_pos of the hits whose rank lies in the node's range.
+    // Leaves first (hits ordered by (rank, s_pos)), then parents by merging.
+    std::vector<uint32_t> cnt(2 * sz, 0);
+    for (size_t i = 0; i < n; i++) cnt[sz + rank[i]]++;
+    for (size_t v = sz - 1; v >= 1; v--) cnt[v] = cnt[2 * v] + cnt[2 * v + 1];
+    std::vector<size_t> begin(2 * sz + 1, 0);
+    for (size_t v = 1; v < 2 * sz; v++) begin[v + 1] = begin[v] + cnt[v];
+
+    std::vector<uint32_t> svals(begin[2 * sz]);
+    {
+        std::vector<uint32_t> by_rank(n);
+        for (size_t i = 0; i < n; i++) by_rank[i] = static_cast<uint32_t>(i);
+        std::sort(by_rank.begin(), by_rank.end(), [&](uint32_t a, uint32_t b) {
+            if (rank[a] != rank[b]) return rank[a] < rank[b];
+            return hits[a].s_pos < hits[b].s_pos;
+        });
+        size_t w = begin[sz];
+        for (uint32_t i : by_rank) svals[w++] = hits[i].s_pos; // leaves are contiguous
+        for (size_t v = sz - 1; v >= 1; v--) {
+            std::merge(svals.begin() + begin[2 * v], svals.begin() + begin[2 * v + 1],
+                       svals.begin() + begin[2 * v + 1], svals.begin() + begin[2 * v + 2],
+                       svals.begin() + begin[v]);
+        }
+    }
+    std::vector<uint64_t> fen(svals.size(), 0); // per-node 1-based Fenwick max
+
+    auto make_key = [](uint32_t score, size_t idx) -> uint64_t {
+        return (static_cast<uint64_t>(score) << 32) |
+               (UINT32_MAX - static_cast<uint32_t>(idx));
+    };
+
+    auto insert = [&](size_t j) {
+        const uint64_t key = make_key(dp[j], j);
+        for (size_t v = sz + rank[j]; v >= 1; v >>= 1) {
+            auto first = svals.begin() + begin[v];
+            size_t len = cnt[v];
+            size_t p = static_cast<size_t>(
+                std::lower_bound(first, first + len, hits[j].s_pos) - first) + 1;
+            for (; p <= len; p += p & (~p + 1)) {
+                uint64_t& f = fen[begin[v] + p - 1];
+                if (key > f) f = key;
+            }
+        }
+    };
+
+    auto node_max = [&](size_t v, uint32_t s_limit) -> uint64_t {
+        auto first = svals.begin() + begin[v];
+        size_t p = static_cast<size_t>(
+            std::lower_bound(first, first + cnt[v], s_limit) - first);
+        uint64_t best = 0;
+        for (; p > 0; p -= p & (~p + 1)) {
+            best = std::max(best, fen[begin[v] + p - 1]);
+        }
+        return best;
+    };
+
+    auto query = [&](size_t i) -> uint64_t {
+        int64_t d = diag_of(i);
+        size_t lo = static_cast<size_t>(
+            std::lower_bound(diags.begin(), diags.end(), d - static_cast<int64_t>(max_gap)) - diags.begin());
+        size_t hi = static_cast<size_t>(
+            std::upper_bound(diags.begin(), diags.end(), d + static_cast<int64_t>(max_gap)) - diags.begin());
+        uint64_t best = 0;
+        for (size_t l = lo + sz, r = hi + sz; l < r; l >>= 1, r >>= 1) {
+            if (l & 1) best = std::max(best, node_max(l++, hits[i].s_pos));
+            if (r & 1) best = std::max(best, node_max(--r, hits[i].s_pos));
+        }
+        return best;
+    };
+
+    size_t g = 0;
+    while (g < n) {
+        size_t g_end = g;
+        while (g_end < n && hits[g_end].q_pos == hits[g].q_pos) g_end++;
+        for (size_t i = g; i < g_end; i++) {
+            uint64_t best = query(i);
+            if (best != 0) {
+                dp[i] = static_cast<uint32_t>(best >> 32) + 1;
+                prev[i] = static_cast<int32_t>(UINT32_MAX - static_cast<uint32_t>(best));
+            }
+        }
+        for (size_t i = g; i < g_end; i++) insert(i);
+        g = g_end;
+    }
+}
+
+// Exact DP over all hits (quadratic loop for small inputs).
+static void chain_dp_all(const Hit* hits, size_t n, uint32_t max_gap,
+                         std::vector<uint32_t>& dp,
+                         std::vector<int32_t>& prev) {
+    if (n < EXACT_DP_MIN_HITS) {
+        chain_dp_quadratic(hits, n, max_gap, 0, dp, prev);
+    } else {
+        chain_dp_exact(hits, n, max_gap, dp, prev);
+    }
+}
+
+// Extract up to max_chains disjoint chains in score order from a single DP
+// pass (exact DP only). Removing a chain can only lower the score of a hit
+// whose stored predecessor was removed or lowered, so after each chain only
+// those hits are re-scored, in index order, from the alive hits on diagonals
+// within max_gap. The tie-breaking of the exact DP is preserved, so the chains
+// are identical to re-running the DP on the remaining hits after every chain.
+// If re-scoring scans too many candidates, the DP is re-run on the alive hits.
+static std::vector<ChainResult> peel_chains(const Hit* hits, size_t n,
+                                            SeqId seq_id,
+                                            int span,
+                                            bool is_reverse,
+                                            const Stage2Config& config,
+                                            uint32_t max_chains) {
+    const uint32_t max_gap = config.max_gap;
+    std::vector<ChainResult> results;
+
+    std::vector<uint32_t> dp;
+    std::vector<int32_t> prev;
+    chain_dp_all(hits, n, max_gap, dp, prev);
+
+    std::vector<uint8_t> alive(n, 1);
+    size_t num_alive = n;
+
+    // Diagonal buckets for re-scoring: hit indices grouped by diagonal,
+    // ascending index (= ascending q_pos) within each bucket.
+    auto diag_of = [&](size_t i) -> int64_t {
+        return static_cast<int64_t>(hits[i].s_pos) - static_cast<int64_t>(hits[i].q_pos);
+    };
+    std::vector<int64_t> diags;
+    std::vector<size_t> bucket_begin;
+    std::vector<uint32_t> bucket;
+    std::vector<uint32_t> changed_at; // peel round in which dp[i] last changed
+    bool buckets_built = false;
+    auto build_buckets = [&]() {
+        std::vector<uint32_t> rank(n);
+        diags.resize(n);
+        for (size_t i = 0; i < n; i++) diags[i] = diag_of(i);
+        std::sort(diags.begin(), diags.end());
+        diags.erase(std::unique(diags.begin(), diags.end()), diags.end());
+        bucket_begin.assign(diags.size() + 1, 0);
+        for (size_t i = 0; i < n; i++) {
+            rank[i] = static_cast<uint32_t>(
+                std::lower_bound(diags.begin(), diags.end(), diag_of(i)) - diags.begin());
+            bucket_begin[rank[i] + 1]++;
+        }
+        for (size_t r = 0; r < diags.size(); r++) bucket_begin[r + 1] += bucket_begin[r];
+        bucket.resize(n);
+        std::vector<size_t> fill(bucket_begin.begin(), bucket_begin.end() - 1);
+        for (size_t i = 0; i < n; i++) bucket[fill[rank[i]]++] = static_cast<uint32_t>(i);
+        changed_at.assign(n, 0);
+        buckets_built = true;
+    };
+
+    // Re-run the DP on the alive hits (fallback when re-scoring gets large)
+    auto rerun_dp = [&]() {
+        std::vector<Hit> sub;
+        std::vector<uint32_t> orig;
+        sub.reserve(num_alive);
+        orig.reserve(num_alive);
+        for (size_t i = 0; i < n; i++) {
+            if (!alive[i]) continue;
+            sub.push_back(hits[i]);
+            orig.push_back(static_cast<uint32_t>(i));
+        }
+        std::vector<uint32_t> sub_dp;
+        std::vector<int32_t> sub_prev;
+        chain_dp_all(sub.data(), sub.size(), max_gap, sub_dp, sub_prev);
+        for (size_t k = 0; k < sub.size(); k++) {
+            dp[orig[k]] = sub_dp[k];
+            prev[orig[k]] = (sub_prev[k] >= 0)
+                ? static_cast<int32_t>(orig[static_cast<size_t>(sub_prev[k])]) : -1;
+        }
+    };
+
+    for (uint32_t iter = 0; iter < max_chains && num_alive > 0; iter++) {
+        // Best chain endpoint: highest score, lowest index
+        size_t best_idx = SIZE_MAX;
+        for (size_t i = 0; i < n; i++) {
+            if (alive[i] && (best_idx == SIZE_MAX || dp[i] > dp[best_idx])) best_idx = i;
+        }
+
+        uint32_t best_score = dp[best_idx];
+        if (best_score < config.min_score) break;
+
+        // Traceback: chain_indices[0] is the end, back() is the start
+        std::vector<size_t> chain_indices;
+        for (size_t idx = best_idx; idx != SIZE_MAX;
+             idx = (prev[idx] >= 0) ? static_cast<size_t>(prev[idx]) : SIZE_MAX) {
+            chain_indices.push_back(idx);
+        }
+        size_t chain_start_idx = chain_indices.back();
+        size_t chain_end_idx = chain_indices.front();
+
+        ChainResult cr{};
+        cr.seq_id = seq_id;
+        cr.chainscore = best_score;
+        cr.is_reverse = is_reverse;
+        cr.q_start = hits[chain_start_idx].q_pos;
+        cr.q_end = hits[chain_end_idx].q_pos + static_cast<uint32_t>(span);
+        cr.s_start = hits[chain_start_idx].s_pos;
+        cr.s_end = hits[chain_end_idx].s_pos + static_cast<uint32_t>(span);
+        if (config.keep_anchors) {
+            cr.anchors.reserve(chain_indices.size());
+            for (auto it = chain_indices.rbegin(); it != chain_indices.rend(); ++it) {
+                cr.anchors.push_back(hits[*it]);
+            }
+        }
+        results.push_back(std::move(cr));
+
+        if (iter + 1 >= max_chains) break;
+
+        for (size_t ci : chain_indices) alive[ci] = 0;
+        num_alive -= chain_indices.size();
+        if (num_alive == 0) break;
+
+        // Re-score hits whose predecessor was removed or lowered
+        if (!buckets_built) build_buckets();
+        const uint32_t round = iter + 1;
+        const size_t budget = 4 * n;
+        size_t scanned = 0;
+        bool fallback = false;
+        for (size_t i = chain_start_idx + 1; i < n; i++) {
+            if (!alive[i] || prev[i] < 0) continue;
+            size_t p = static_cast<size_t>(prev[i]);
+            if (alive[p] && changed_at[p] != round) continue;
+
+            int64_t d = diag_of(i);
+            size_t lo = static_cast<size_t>(
+                std::lower_bound(diags.begin(), diags.end(), d - static_cast<int64_t>(max_gap)) - diags.begin());
+            size_t hi = static_cast<size_t>(
+                std::upper_bound(diags.begin(), diags.end(), d + static_cast<int64_t>(max_gap)) - diags.begin());
+            uint32_t new_dp = 1;
+            int32_t new_prev = -1;
+            for (size_t r = lo; r < hi; r++) {
+                auto first = bucket.begin() + bucket_begin[r];
+                auto last = std::lower_bound(first, bucket.begin() + bucket_begin[r + 1],
+                                             static_cast<uint32_t>(i));
+                scanned += static_cast<size_t>(last - first);
+                for (auto it = first; it != last; ++it) {
+                    uint32_t j = *it;
+                    if (!alive[j]) continue;
+                    if (hits[j].q_pos >= hits[i].q_pos) continue;
+                    if (hits[j].s_pos >= hits[i].s_pos) continue;
+                    if (dp[j] + 1 > new_dp ||
+                        (dp[j] + 1 == new_dp && static_cast<int32_t>(j) < new_prev)) {
+                        new_dp = dp[j] + 1;
+                        new_prev = static_cast<int32_t>(j);
+                    }
+                }
+            }
+            if (new_dp != dp[i]) changed_at[i] = round;
+            dp[i] = new_dp;
+            prev[i] = new_prev;
 
-    // Step 1: deduplicate (q_pos, s_pos) pairs from degenerate base expansion
-    std::vector<Hit> deduped = raw_hits;
-    std::sort(deduped.begin(), deduped.end(), [](const Hit& a, const Hit& b) {
-        return a.q_pos < b.q_pos || (a.q_pos == b.q_pos && a.s_pos < b.s_pos);
-    });
-    deduped.erase(std::unique(deduped.begin(), deduped.end(),
-        [](const Hit& a, const Hit& b) {
-            return a.q_pos == b.q_pos && a.s_pos == b.s_pos;
-        }), deduped.end());
+            if (scanned > budget) {
+                fallback = true;
+                break;
+            }
+        }
+        if (fallback) rerun_dp();
+    }
 
-    // Step 2: diagonal filter
-    std::vector<Hit> hits = diagonal_filter(deduped, config.min_diag_hits);
-    if (hits.empty()) return {};
+    return results;
+}
+
+std::vector<ChainResult> chain_hits_inplace(Hit* raw_hits, size_t num_hits,
+                                            SeqId seq_id,
+                                            int span,
+                                            bool is_reverse,
+                                            const Stage2Config& config) {
+    if (num_hits == 0) return {};
 
-    // Already sorted by (q_pos, s_pos) from dedup step
+    // Step 0: long-query window, chain only the hits of the window core
+    if (config.core_q_begin > 0 || config.core_q_end != UINT32_MAX) {
+        Hit* end = std::remove_if(raw_hits, raw_hits + num_hits, [&](const Hit& h) {
+            return h.q_pos < config.core_q_begin || h.q_pos >= config.core_q_end;
+        });
+        num_hits = static_cast<size_t>(end - raw_hits);
+        if (num_hits == 0) return {};
+    }
+
+    // Steps 1-2: deduplicate (q_pos, s_pos) pairs from degenerate base
+    // expansion and apply the diagonal filter; survivors are left sorted
+    // by (q_pos, s_pos) at the front of raw_hits
+    size_t n_hits = dedup_diagonal_filter(raw_hits, num_hits, config.min_diag_hits);
+    if (n_hits == 0) return {};
+    const Hit* hits = raw_hits;
+
+    // Already sorted by (q_pos, s_pos) from the pre-pass
 
     // Determine max iterations
     uint32_t max_chains = config.max_nhit_per_subject;
     if (max_chains == 0) max_chains = UINT32_MAX; // unlimited
 
+    // Exact DP: one pass, chains peeled off in score order
+    if (config.chain_max_lookback == 0) {
+        return peel_chains(hits, n_hits, seq_id, span, is_reverse, config, max_chains);
+    }
+
+    // Lookback-window DP: the window depends on hit order, so the DP is
+    // re-run on the remaining hits for every chain.
     std::vector<ChainResult> results;
 
     // Working copy of hits for iterative removal
-    std::vector<Hit> remaining = std::move(hits);
+    std::vector<Hit> remaining(hits, hits + n_hits);
 
     for (uint32_t iter = 0; iter < max_chains; iter++) {
         size_t n = remaining.size();
         if (n == 0) break;
 
         // DP arrays
-        std::vector<uint32_t> dp(n, 1);
-        std::vector<int32_t> prev(n, -1);
-
-        for (size_t i = 1; i < n; i++) {
-            size_t j_start = (config.chain_max_lookback > 0 && i > config.chain_max_lookback)
-                              ? (i - config.chain_max_lookback) : 0;
-            for (size_t j = j_start; j < i; j++) {
-                if (remaining[j].q_pos >= remaining[i].q_pos) continue;
-                if (remaining[j].s_pos >= remaining[i].s_pos) continue;
-
-                int64_t gap_q = static_cast<int64_t>(remaining[i].q_pos) - static_cast<int64_t>(remaining[j].q_pos);
-                int64_t gap_s = static_cast<int64_t>(remaining[i].s_pos) - static_cast<int64_t>(remaining[j].s_pos);
-                int64_t diag_diff = std::abs(gap_s - gap_q);
-
-                if (diag_diff <= static_cast<int64_t>(config.max_gap)) {
-                    if (dp[j] + 1 > dp[i]) {
-                        dp[i] = dp[j] + 1;
-                        prev[i] = static_cast<int32_t>(j);
-                    }
-                }
-            }
-        }
+        std::vector<uint32_t> dp;
+        std::vector<int32_t> prev;
+        chain_dp_quadratic(remaining.data(), n, config.max_gap, config.chain_max_lookback, dp, prev);
 
         // Find best chain endpoint
         size_t best_idx = 0;
@@ -98,8 +417,14 @@ std::vector<ChainResult> chain_hits(const std::vector<Hit>& raw_hits,
         cr.q_end = remaining[chain_end_idx].q_pos + static_cast<uint32_t>(span);
         cr.s_start = remaining[chain_start_idx].s_pos;
         cr.s_end = remaining[chain_end_idx].s_pos + static_cast<uint32_t>(span);
+        if (config.keep_anchors) {
+            cr.anchors.reserve(chain_indices.size());
+            for (auto it = chain_indices.rbegin(); it != chain_indices.rend(); ++it) {
+                cr.anchors.push_back(remaining[*it]);
+            }
+        }
 
-        results.push_back(cr);
+        results.push_back(std::move(cr));
 
         // Early return for single chain (default path, no removal overhead)
         if (max_chains == 1) break;
@@ -123,4 +448,13 @@ std::vector<ChainResult> chain_hits(const std::vector<Hit>& raw_hits,
     return results;
 }
 
+std::vector<ChainResult> chain_hits(const std::vector<Hit>& hits,
+                                    SeqId seq_id,
+                                    int span,
+                                    bool is_reverse,
+                                    const Stage2Config& config) {
+    std::vector<Hit> work = hits;
+    return chain_hits_inplace(work.data(), work.size(), seq_id, span, is_reverse, config);
+}
+
 } // namespace ikafssn
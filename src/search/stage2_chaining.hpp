@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -11,16 +12,27 @@ struct Stage2Config {
     uint32_t max_gap = 100;         // max diagonal deviation between consecutive chain hits
     uint32_t min_diag_hits = 1;     // diagonal filter threshold (1 = disabled)
     uint32_t min_score = 0;         // minimum chain score to report (0 = adaptive)
-    uint32_t chain_max_lookback = 64; // chaining DP lookback window (0 = unlimited O(n²))
+    uint32_t chain_max_lookback = 0; // chaining DP lookback window (0 = exact, no window)
     uint32_t max_nhit_per_subject = 1; // max chains per subject (0 = unlimited)
+    // Long-query window core (see split_query_windows): only hits with
+    // core_q_begin <= q_pos < core_q_end are chained.
+    uint32_t core_q_begin = 0;
+    uint32_t core_q_end = UINT32_MAX;
+    // Keep the chain hits in ChainResult::anchors (anchored Stage 3)
+    bool keep_anchors = false;
 };
 
 // Run Stage 2 chaining on hits for a single candidate sequence.
-// 1. Apply diagonal filter
-// 2. Sort hits by q_pos (then s_pos)
-// 3. Run O(n^2) chaining DP
+// 0. Drop hits outside the window core [core_q_begin, core_q_end)
+// 1. Deduplicate hits and apply diagonal filter (radix-sort pre-pass,
+//    see dedup_diagonal_filter())
+// 2. Hits come out sorted by q_pos (then s_pos)
+// 3. Run chaining DP: exact O(n log^2 n) range-max DP over diagonals, or the
+//    O(n*B) lookback-window DP when chain_max_lookback = B > 0
 // 4. Traceback best chain
 // 5. If max_nhit_per_subject > 1 (or 0=unlimited), remove used hits and repeat
+//    (exact DP: scores are updated in place, only for hits whose predecessor
+//    was removed or lowered; lookback DP: re-run on the remaining hits)
 //
 // Returns vector of ChainResult (empty if no chain passes min_score).
 std::vector<ChainResult> chain_hits(const std::vector<Hit>& hits,
@@ -29,4 +41,12 @@ std::vector<ChainResult> chain_hits(const std::vector<Hit>& hits,
                                     bool is_reverse,
                                     const Stage2Config& config);
 
+// Same as chain_hits(), but sorts and deduplicates hits[0..n) in place
+// instead of copying them (e.g. ranges of a shared hit arena).
+std::vector<ChainResult> chain_hits_inplace(Hit* hits, size_t n,
+                                            SeqId seq_id,
+                                            int span,
+                                            bool is_reverse,
+                                            const Stage2Config& config);
+
 } // namespace ikafssn
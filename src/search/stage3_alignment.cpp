@@ -1,16 +1,26 @@
 #include "search/stage3_alignment.hpp"
+#include "search/banded_alignment.hpp"
+#include "search/anchored_alignment.hpp"
+#include "search/ungapped_alignment.hpp"
+#include "search/positive_bound.hpp"
+#include "search/edit_distance.hpp"
+#include "search/batch_alignment.hpp"
 #include "core/spaced_seed.hpp"
 #include "io/blastdb_reader.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstring>
+#include <memory>
+#include <numeric>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 
 #include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
 #include <tbb/parallel_for.h>
-#include <tbb/task_arena.h>
 
 #include <parasail.h>
 
@@ -54,21 +64,26 @@ std::vector<OutputHit> run_stage3(
     const Logger& logger)
 {
     if (hits.empty()) return {};
+    BlastDbReaderPool pool(db_path);
+    return run_stage3(hits, queries, pool, config,
+                      context_is_ratio, context_ratio, context_abs, logger);
+}
 
-    // 1. Open BLAST DB volumes
-    auto vol_paths = BlastDbReader::find_volume_paths(db_path);
-    if (vol_paths.empty()) {
-        logger.error("Stage 3: no BLAST DB volumes found at '%s'", db_path.c_str());
-        return {};
-    }
+std::vector<OutputHit> run_stage3(
+    std::vector<OutputHit>& hits,
+    const std::vector<FastaRecord>& queries,
+    BlastDbReaderPool& pool,
+    const Stage3Config& config,
+    bool context_is_ratio,
+    double context_ratio,
+    uint32_t context_abs,
+    const Logger& logger)
+{
+    if (hits.empty()) return {};
 
-    std::vector<BlastDbReader> readers(vol_paths.size());
-    for (size_t vi = 0; vi < vol_paths.size(); vi++) {
-        if (!readers[vi].open(vol_paths[vi])) {
-            logger.error("Stage 3: cannot open volume '%s'", vol_paths[vi].c_str());
-            return {};
-        }
-    }
+    // 1. BLAST DB volumes (opened once per pool)
+    if (!pool.ensure_open(logger)) return {};
+    const size_t num_readers = pool.num_volumes();
 
     // 2. Build query lookup: query_id -> index in queries[]
     std::unordered_map<std::string, size_t> query_map;
@@ -76,64 +91,54 @@ std::vector<OutputHit> run_stage3(
         query_map[queries[i].id] = i;
     }
 
-    // 3. Pre-fetch subject subsequences (volume-parallel)
-    // Group hits by volume index (using OutputHit.volume directly)
-    std::vector<std::vector<size_t>> hits_by_reader(readers.size());
-    std::vector<bool> hit_valid(hits.size(), true);
+    // 3. Group hits by volume index (using OutputHit.volume directly)
+    // and sort each volume's hits by OID for sequential mmap access. The
+    // subjects are fetched in step 5, right before their alignment.
+    std::vector<std::vector<size_t>> hits_by_reader(num_readers);
+    std::vector<uint8_t> hit_valid(hits.size(), 1);  // bytes: 5.5 clears them per group in parallel
     for (size_t i = 0; i < hits.size(); i++) {
-        if (hits[i].volume < readers.size()) {
-            hits_by_reader[hits[i].volume].push_back(i);
+        if (hits[i].volume < num_readers) {
+            if (query_map.count(hits[i].qseqid)) hits_by_reader[hits[i].volume].push_back(i);
         } else {
             logger.warn("Stage 3: hit volume %u out of range (max %zu), skipping",
-                        static_cast<unsigned>(hits[i].volume), readers.size());
+                        static_cast<unsigned>(hits[i].volume), num_readers);
             hit_valid[i] = false;
         }
     }
-
-    // Sort each volume's hit indices by OID for sequential mmap access
     for (auto& vol_hits : hits_by_reader) {
         std::sort(vol_hits.begin(), vol_hits.end(),
             [&hits](size_t a, size_t b) { return hits[a].oid < hits[b].oid; });
     }
 
-    std::vector<std::string> subject_subseqs(hits.size());
-    std::vector<uint32_t> ext_starts(hits.size(), 0);
-
-    int actual_fetch_threads = std::min(config.fetch_threads,
-                                         static_cast<int>(readers.size()));
-    if (actual_fetch_threads < 1) actual_fetch_threads = 1;
-
-    tbb::task_arena fetch_arena(actual_fetch_threads);
-    fetch_arena.execute([&] {
-        tbb::parallel_for(size_t(0), readers.size(), [&](size_t ri) {
-            for (size_t hit_idx : hits_by_reader[ri]) {
-                uint32_t oid = hits[hit_idx].oid;
-                uint32_t seq_len = readers[ri].seq_length(oid);
-
-                // Find query length for ratio context
-                uint32_t query_len = 0;
-                auto qit = query_map.find(hits[hit_idx].qseqid);
-                if (qit != query_map.end()) {
-                    query_len = static_cast<uint32_t>(queries[qit->second].sequence.size());
-                }
-
-                uint32_t ctx = context_is_ratio
-                    ? static_cast<uint32_t>(query_len * context_ratio)
-                    : context_abs;
-
-                uint32_t ext_start = (hits[hit_idx].sstart >= ctx)
-                    ? hits[hit_idx].sstart - ctx : 0;
-                uint32_t ext_end = std::min(hits[hit_idx].send + ctx, seq_len - 1);
+    // Split each volume's list into chunks, so that a single volume (or
+    // one holding most hits) is still fetched by many threads. A subject's
+    // hits stay in one chunk, so that their regions can be merged.
+    struct FetchChunk {
+        size_t volume;
+        size_t begin;
+        size_t end;
+    };
+    constexpr size_t kFetchChunk = 32;
+    std::vector<FetchChunk> chunks;
+    size_t num_fetch = 0;
+    for (size_t ri = 0; ri < num_readers; ri++) {
+        const auto& list = hits_by_reader[ri];
+        const size_t n = list.size();
+        for (size_t b = 0; b < n; ) {
+            size_t e = std::min(n, b + kFetchChunk);
+            while (e < n && hits[list[e]].oid == hits[list[e - 1]].oid) e++;
+            chunks.push_back({ri, b, e});
+            b = e;
+        }
+        num_fetch += n;
+    }
 
-                subject_subseqs[hit_idx] = readers[ri].get_subsequence(oid, ext_start, ext_end);
-                ext_starts[hit_idx] = ext_start;
-                hits[hit_idx].slen = seq_len;
-            }
-        });
-    });
+    std::vector<uint8_t> fetched(hits.size(), 0);  // subject region decoded
+    std::vector<uint32_t> ext_starts(hits.size(), 0);
 
     // 4. Build query profiles (per unique query_id x strand)
     // Key: (query_idx, is_reverse)
+    const bool use_edit = (config.engine == "edit");
     const parasail_matrix_t* matrix = parasail_matrix_lookup(config.score_matrix.c_str());
     if (!matrix) {
         logger.error("Stage 3: unknown score matrix '%s'", config.score_matrix.c_str());
@@ -149,7 +154,7 @@ std::vector<OutputHit> run_stage3(
 
     // Collect unique (query_idx, strand) pairs needed
     for (size_t i = 0; i < hits.size(); i++) {
-        if (!hit_valid[i] || subject_subseqs[i].empty()) continue;
+        if (!hit_valid[i]) continue;
         auto qit = query_map.find(hits[i].qseqid);
         if (qit == query_map.end()) continue;
         size_t qi = qit->second;
@@ -162,7 +167,9 @@ std::vector<OutputHit> run_stage3(
             } else {
                 pe.seq = queries[qi].sequence;
             }
-            if (config.traceback) {
+            if (use_edit) {
+                // The edit-distance engine aligns from pe.seq alone
+            } else if (config.traceback) {
                 pe.profile = parasail_profile_create_sat(
                     pe.seq.c_str(), static_cast<int>(pe.seq.size()), matrix);
             } else {
@@ -173,33 +180,292 @@ std::vector<OutputHit> run_stage3(
         }
     }
 
-    // 5. Parallel alignment
-    // Collect valid hit indices for parallel_for
-    std::vector<size_t> valid_indices;
-    valid_indices.reserve(hits.size());
+    // 4.5. Stage 2 chain diagonals (subject position - aligned query position)
+    // for the ungapped and banded alignments. Reverse-strand hits align the
+    // reverse-complemented query; their diagonals are exact within the
+    // k-mer span, which the band margin absorbs.
+    std::vector<int64_t> diag_lo(hits.size(), 0), diag_hi(hits.size(), 0);
     for (size_t i = 0; i < hits.size(); i++) {
-        if (hit_valid[i] && !subject_subseqs[i].empty()) {
-            auto qit = query_map.find(hits[i].qseqid);
-            if (qit != query_map.end()) {
-                valid_indices.push_back(i);
-            }
+        auto qit = query_map.find(hits[i].qseqid);
+        if (qit == query_map.end()) continue;
+        int64_t qlen = static_cast<int64_t>(queries[qit->second].sequence.size());
+        int64_t d1, d2;
+        if (hits[i].sstrand == '-') {
+            d1 = int64_t(hits[i].sstart) + hits[i].qstart - qlen;
+            d2 = int64_t(hits[i].send) + hits[i].qend - qlen;
+        } else {
+            d1 = int64_t(hits[i].sstart) - hits[i].qstart;
+            d2 = int64_t(hits[i].send) - hits[i].qend;
         }
+        diag_lo[i] = std::min(d1, d2);
+        diag_hi[i] = std::max(d1, d2);
     }
+    const SubstitutionMatrix band_matrix{matrix->matrix, matrix->mapper, matrix->size};
+
+    // Banded score-only alignment of hit idx against subj (starting at
+    // subject position ext_start). Returns false if the full DP is needed:
+    // the band is too wide to pay off (over a quarter of the subject
+    // region) or its result touches the band edge.
+    auto align_banded = [&](size_t idx, const std::string& qseq,
+                            const char* subj, int slen, uint32_t ext_start) {
+        if (!config.banded) return false;
+        int64_t qlen = static_cast<int64_t>(qseq.size());
+        int64_t dlo = std::max<int64_t>(diag_lo[idx] - config.band_margin - ext_start, -qlen);
+        int64_t dhi = std::min<int64_t>(diag_hi[idx] + config.band_margin - ext_start, slen);
+        if (dlo > dhi || (dhi - dlo + 1) * 4 > slen) return false;
+
+        BandedAlignment br = banded_sg_align(
+            qseq.data(), static_cast<int>(qlen), subj, slen,
+            static_cast<int>(dlo), static_cast<int>(dhi),
+            config.gapopen, config.gapext, band_matrix);
+        if (!br.in_band) return false;
+
+        hits[idx].alnscore = br.score;
+        hits[idx].qend = static_cast<uint32_t>(br.end_query);
+        hits[idx].send = ext_start + static_cast<uint32_t>(br.end_ref);
+        return true;
+    };
 
-    logger.debug("Stage 3: aligning %zu hits (%zu profiles)", valid_indices.size(), profiles.size());
+    // Gap-free alignment of hit idx on its Stage 2 chain diagonal. Forward
+    // chains qualify when they start and end on one diagonal; reverse chains
+    // (whose diagonals differ by the k-mer span at both ends) are tried on
+    // the middle diagonal. Returns false if the hit needs a gapped alignment.
+    auto align_ungapped = [&](size_t idx, const std::string& qseq,
+                              const char* subj, int slen, uint32_t ext_start) {
+        if (!config.ungapped) return false;
+        int64_t diag;
+        if (hits[idx].sstrand == '-') {
+            if ((diag_hi[idx] - diag_lo[idx]) % 2 != 0) return false;
+            diag = (diag_lo[idx] + diag_hi[idx]) / 2;
+        } else {
+            if (diag_lo[idx] != diag_hi[idx]) return false;
+            diag = diag_lo[idx];
+        }
+        diag -= ext_start;
 
-    tbb::parallel_for(size_t(0), valid_indices.size(), [&](size_t vi) {
-        size_t idx = valid_indices[vi];
-        auto qit = query_map.find(hits[idx].qseqid);
-        size_t qi = qit->second;
-        bool is_rev = (hits[idx].sstrand == '-');
-        std::string key = std::to_string(qi) + ":" + (is_rev ? "1" : "0");
-        const auto& pe = profiles.at(key);
+        const int qlen = static_cast<int>(qseq.size());
+        UngappedAlignment ua = ungapped_align(qseq.data(), qlen, subj, slen, diag,
+                                              config.gapopen, band_matrix,
+                                              config.traceback);
+        if (!ua.ok) return false;
 
-        const char* subj = subject_subseqs[idx].c_str();
-        int slen = static_cast<int>(subject_subseqs[idx].size());
+        hits[idx].alnscore = ua.score;
+        hits[idx].qend = static_cast<uint32_t>(qlen - 1);
+        hits[idx].send = ext_start + static_cast<uint32_t>(diag + qlen - 1);
+        if (config.traceback) {
+            hits[idx].qstart = 0;
+            hits[idx].sstart = ext_start + static_cast<uint32_t>(diag);
+            hits[idx].npositive = ua.npositive;
+            hits[idx].nnegative = ua.nnegative;
+            hits[idx].cigar = std::move(ua.cigar);
+            hits[idx].ppositive = 100.0 * ua.npositive / qlen;
+            hits[idx].qseq = qseq;
+            hits[idx].sseq.assign(subj + diag, static_cast<size_t>(qlen));
+        }
+        return true;
+    };
 
+    // Alignment of hit idx through its Stage 2 anchors. Reverse-strand
+    // anchors are converted to reverse-complemented query positions.
+    // Returns false if the hit has no usable anchor.
+    auto align_anchored = [&](size_t idx, const std::string& qseq,
+                              const char* subj, int slen, uint32_t ext_start) {
+        const auto& src = hits[idx].anchors;
+        if (!config.anchored || config.anchor_span <= 0 || src.empty()) return false;
+        const int64_t qlen = static_cast<int64_t>(qseq.size());
+        const bool is_rev = (hits[idx].sstrand == '-');
+        std::vector<Hit> anchors;
+        anchors.reserve(src.size());
+        for (const Hit& h : src) {
+            int64_t q = is_rev ? qlen - h.q_pos - config.anchor_span : h.q_pos;
+            if (q < 0 || h.s_pos < ext_start) continue;
+            anchors.push_back({static_cast<SeqPos>(q), h.s_pos - ext_start});
+        }
+
+        AnchoredAlignment aa = anchored_sg_align(
+            qseq.data(), static_cast<int>(qlen), subj, slen, anchors,
+            config.anchor_span, config.gapopen, config.gapext, band_matrix);
+        if (!aa.ok) return false;
+
+        hits[idx].alnscore = aa.score;
+        hits[idx].qend = static_cast<uint32_t>(aa.end_query);
+        hits[idx].send = ext_start + static_cast<uint32_t>(aa.end_ref);
+        if (config.traceback) {
+            hits[idx].qstart = static_cast<uint32_t>(aa.beg_query);
+            hits[idx].sstart = ext_start + static_cast<uint32_t>(aa.beg_ref);
+            hits[idx].npositive = aa.npositive;
+            hits[idx].nnegative = aa.nnegative;
+            hits[idx].cigar = std::move(aa.cigar);
+            hits[idx].ppositive = (aa.aln_len > 0) ? 100.0 * aa.npositive / aa.aln_len : 0.0;
+            hits[idx].qseq = std::move(aa.qseq);
+            hits[idx].sseq = std::move(aa.sseq);
+        }
+        return true;
+    };
+
+    // Edit-distance alignment of hit idx (-stage3_engine edit), used for
+    // every hit instead of the alignments above and below. The CIGAR and
+    // counts come from the same pass, so they are filled whenever
+    // traceback is on.
+    auto align_edit = [&](size_t idx, const std::string& qseq,
+                          const char* subj, int slen, uint32_t ext_start) {
+        EditAlignment ea = edit_sg_align(
+            qseq.data(), static_cast<int>(qseq.size()), subj, slen,
+            config.gapopen, config.gapext, band_matrix);
+        if (!ea.ok) return;
+
+        hits[idx].alnscore = ea.score;
+        hits[idx].qend = static_cast<uint32_t>(ea.end_query);
+        hits[idx].send = ext_start + static_cast<uint32_t>(ea.end_ref);
         if (config.traceback) {
+            hits[idx].qstart = static_cast<uint32_t>(ea.beg_query);
+            hits[idx].sstart = ext_start + static_cast<uint32_t>(ea.beg_ref);
+            hits[idx].npositive = ea.npositive;
+            hits[idx].nnegative = ea.nnegative;
+            hits[idx].cigar = std::move(ea.cigar);
+            hits[idx].ppositive = (ea.aln_len > 0) ? 100.0 * ea.npositive / ea.aln_len : 0.0;
+            hits[idx].qseq = std::move(ea.qseq);
+            hits[idx].sseq = std::move(ea.sseq);
+        }
+    };
+
+    // Full score-only DP of hit idx (alnscore, qend, send)
+    auto align_full = [&](size_t idx, const ProfileEntry& pe,
+                          const char* subj, int slen, uint32_t ext_start) {
+        parasail_result_t* result = parasail_sg_striped_profile_sat(
+            pe.profile, subj, slen, config.gapopen, config.gapext);
+        hits[idx].alnscore = result->score;
+        hits[idx].qend = static_cast<uint32_t>(result->end_query);
+        hits[idx].send = ext_start + static_cast<uint32_t>(result->end_ref);
+        // q_start and s_start remain from Stage 2 (approximate)
+        parasail_result_free(result);
+    };
+
+    // Score-only alignment of hit idx (alnscore, qend, send): banded when
+    // trusted, otherwise the full DP.
+    auto align_score_only = [&](size_t idx, const ProfileEntry& pe,
+                                const char* subj, int slen, uint32_t ext_start) {
+        if (align_banded(idx, pe.seq, subj, slen, ext_start)) return;
+        align_full(idx, pe, subj, slen, ext_start);
+    };
+
+    // Query index of each hit (SIZE_MAX: not among the queries), and an
+    // order on hits by (query, strand, volume, OID) in which the hits of
+    // one query on one subject strand are adjacent
+    std::vector<size_t> hit_query(hits.size(), SIZE_MAX);
+    for (size_t i = 0; i < hits.size(); i++) {
+        auto qit = query_map.find(hits[i].qseqid);
+        if (qit != query_map.end()) hit_query[i] = qit->second;
+    }
+    auto subject_less = [&](size_t a, size_t b) {
+        return std::make_tuple(hit_query[a], hits[a].sstrand, hits[a].volume, hits[a].oid) <
+               std::make_tuple(hit_query[b], hits[b].sstrand, hits[b].volume, hits[b].oid);
+    };
+
+    // Two-tier traceback: with -stage3_min_npositive / -stage3_min_ppositive
+    // a score-only pass gives the end cell and score, and a bit-parallel
+    // bound on the positive columns tells whether the hit can pass step 6
+    // at all; only hits that can are traced back. Hits sharing a subject
+    // strand with another hit of the same query are always traced back,
+    // since step 5.5 clamps them against each other's coordinates.
+    const bool has_context = context_is_ratio ? (context_ratio > 0) : (context_abs > 0);
+    const bool use_prefilter = !use_edit && config.traceback && config.prefilter &&
+        (config.min_npositive > 0 || config.min_ppositive > 0);
+    std::vector<uint8_t> shares_subject(hits.size(), 0);
+    if (use_prefilter && has_context) {
+        std::vector<size_t> by_subject(hits.size());
+        std::iota(by_subject.begin(), by_subject.end(), size_t(0));
+        std::sort(by_subject.begin(), by_subject.end(), subject_less);
+        for (size_t k = 1; k < by_subject.size(); k++) {
+            if (subject_less(by_subject[k - 1], by_subject[k])) continue;
+            shares_subject[by_subject[k - 1]] = shares_subject[by_subject[k]] = 1;
+        }
+    }
+    int max_matrix_score = 0;
+    for (int i = 0; i < matrix->size * matrix->size; i++) {
+        max_matrix_score = std::max(max_matrix_score, matrix->matrix[i]);
+    }
+    std::vector<uint8_t> prefiltered(hits.size(), 0);
+
+    // Returns false if hit idx cannot reach the positive filters.
+    // scored: alnscore, qend and send already hold the full score-only
+    // result. The bound needs the end cell of the full DP, which the
+    // traceback reproduces: a banded result trusted by in_band may end
+    // elsewhere with a lower score, so the band is not used here.
+    auto may_pass_filters = [&](size_t idx, const ProfileEntry& pe,
+                                const char* subj, int slen, uint32_t ext_start,
+                                bool scored) {
+        if (!use_prefilter || shares_subject[idx]) return true;
+        if (!scored) align_full(idx, pe, subj, slen, ext_start);
+        const int64_t eq = hits[idx].qend;
+        const int64_t er = static_cast<int64_t>(hits[idx].send) - ext_start;
+
+        // The alignment consumes at most eq + 1 query bases, and its gaps
+        // in the query cost gapopen + (n - 1) * gapext out of the score
+        // headroom, which bounds the subject span that can hold it.
+        int64_t headroom = int64_t(max_matrix_score) * (eq + 1) -
+                           hits[idx].alnscore - config.gapopen;
+        int64_t max_del = (headroom < 0) ? 0
+                        : (config.gapext > 0) ? headroom / config.gapext + 1 : er + 1;
+        int64_t ws = std::max<int64_t>(0, er + 1 - (eq + 1 + max_del));
+        uint32_t max_pos = max_positive_columns(
+            pe.seq.data(), static_cast<int>(eq + 1),
+            subj + ws, static_cast<int>(er + 1 - ws), band_matrix);
+        if (max_pos < config.min_npositive) return false;
+
+        // Semi-global alignments start on the first query or subject
+        // position, so they span at least min(eq, er) + 1 columns.
+        int64_t min_len = std::max<int64_t>(max_pos, std::min(eq, er) + 1);
+        double max_ppositive = (min_len > 0) ? 100.0 * max_pos / min_len : 0.0;
+        return !(config.min_ppositive > 0 && max_ppositive < config.min_ppositive);
+    };
+
+    // 5. Parallel fetch and alignment
+    // Each chunk decodes its subjects in OID order through a private
+    // reader handle of its volume (at most fetch_threads per volume; more
+    // concurrent chunks share the pool's reader) into the thread's
+    // reusable buffer, and aligns each one straight from that buffer.
+    // Overlapping context-extended ranges on one subject (e.g. many
+    // queries hitting one amplicon) are decoded once as their union.
+    logger.debug("Stage 3: fetching and aligning %zu hits in %zu chunks (%zu profiles)",
+                 num_fetch, chunks.size(), profiles.size());
+
+    auto profile_of = [&](size_t idx) -> const ProfileEntry& {
+        size_t qi = query_map.find(hits[idx].qseqid)->second;
+        bool is_rev = (hits[idx].sstrand == '-');
+        return profiles.at(std::to_string(qi) + ":" + (is_rev ? "1" : "0"));
+    };
+
+    // Alignments of hit idx against its subject region subj (slen bases
+    // from subject position ext_start) that need no DP over the region.
+    // Returns false if the hit needs align_dp().
+    auto align_direct = [&](size_t idx, const ProfileEntry& pe,
+                            const char* subj, int slen, uint32_t ext_start) {
+        fetched[idx] = 1;
+        ext_starts[idx] = ext_start;
+        if (use_edit) {
+            align_edit(idx, pe.seq, subj, slen, ext_start);
+            return true;
+        }
+        // Gap-free, or aligned through the Stage 2 anchors
+        return align_ungapped(idx, pe.seq, subj, slen, ext_start) ||
+               align_anchored(idx, pe.seq, subj, slen, ext_start);
+    };
+
+    // Hits whose DP is score-only at first: all of them without traceback,
+    // those the prefilter scores before tracing back with it
+    auto scores_first = [&](size_t idx) {
+        return !config.traceback || (use_prefilter && !shares_subject[idx]);
+    };
+
+    // DP alignment of hit idx. scored: alnscore, qend and send already
+    // hold its score-only result (banded or batch_sg_align()).
+    auto align_dp = [&](size_t idx, const ProfileEntry& pe,
+                        const char* subj, int slen, bool scored) {
+        if (config.traceback &&
+            !may_pass_filters(idx, pe, subj, slen, ext_starts[idx], scored)) {
+            prefiltered[idx] = 1;
+        } else if (config.traceback) {
             // Traceback alignment
             parasail_result_t* result = parasail_sg_trace_striped_profile_sat(
                 pe.profile, subj, slen, config.gapopen, config.gapext);
@@ -236,205 +502,297 @@ std::vector<OutputHit> run_stage3(
 
             parasail_cigar_free(cigar);
             parasail_result_free(result);
-        } else {
+        } else if (!scored) {
             // Score-only alignment (no traceback)
-            parasail_result_t* result = parasail_sg_striped_profile_sat(
-                pe.profile, subj, slen, config.gapopen, config.gapext);
+            align_score_only(idx, pe, subj, slen, ext_starts[idx]);
+        }
+    };
 
-            hits[idx].alnscore = result->score;
-            // Update end coordinates from alignment
-            hits[idx].qend = static_cast<uint32_t>(result->end_query);
-            hits[idx].send = ext_starts[idx] + static_cast<uint32_t>(result->end_ref);
-            // q_start and s_start remain from Stage 2 (approximate)
+    struct SubjectRange {
+        uint32_t start;
+        uint32_t end;
+        size_t hit;
+    };
+    const size_t max_handles = static_cast<size_t>(std::max(config.fetch_threads, 1));
+    tbb::enumerable_thread_specific<std::string> subject_buffers;
+    std::atomic<size_t> num_regions{0};
+    std::atomic<size_t> num_batched{0};
+    tbb::parallel_for(size_t(0), chunks.size(), [&](size_t ci) {
+        const FetchChunk& chunk = chunks[ci];
+        const auto& list = hits_by_reader[chunk.volume];
+        std::unique_ptr<BlastDbReader> handle = pool.acquire(chunk.volume, max_handles);
+        const BlastDbReader& reader = handle ? *handle : pool.volume(chunk.volume);
+        std::string& subject = subject_buffers.local();
+        std::vector<SubjectRange> ranges;
+        std::vector<BatchLane> lanes;
+        std::vector<size_t> lane_ranges;  // ranges[] index of each lane
+
+        for (size_t k = chunk.begin; k < chunk.end; ) {
+            // Context-extended ranges of this subject's hits
+            const uint32_t oid = hits[list[k]].oid;
+            const uint32_t seq_len = reader.seq_length(oid);
+            ranges.clear();
+            for (; k < chunk.end && hits[list[k]].oid == oid; k++) {
+                size_t idx = list[k];
+                hits[idx].slen = seq_len;
+                if (seq_len == 0) continue;
+
+                uint32_t query_len = static_cast<uint32_t>(
+                    queries[query_map.find(hits[idx].qseqid)->second].sequence.size());
+                uint32_t ctx = context_is_ratio
+                    ? static_cast<uint32_t>(query_len * context_ratio)
+                    : context_abs;
+                uint32_t ext_start = (hits[idx].sstart >= ctx)
+                    ? hits[idx].sstart - ctx : 0;
+                uint32_t ext_end = std::min(hits[idx].send + ctx, seq_len - 1);
+                if (ext_start <= ext_end) ranges.push_back({ext_start, ext_end, idx});
+            }
+            std::sort(ranges.begin(), ranges.end(),
+                [](const SubjectRange& x, const SubjectRange& y) { return x.start < y.start; });
+
+            // Fetch each union of overlapping ranges once; its hits align
+            // against views into the buffer
+            for (size_t r = 0; r < ranges.size(); ) {
+                uint32_t lo = ranges[r].start;
+                uint32_t hi = ranges[r].end;
+                size_t r_end = r + 1;
+                while (r_end < ranges.size() && ranges[r_end].start <= hi) {
+                    hi = std::max(hi, ranges[r_end].end);
+                    r_end++;
+                }
+                if (reader.get_subsequence(oid, lo, hi, subject)) {
+                    num_regions.fetch_add(1, std::memory_order_relaxed);
+                    // Many hits on one region: the score-only DPs run
+                    // batched, one query per lane. Without traceback a hit
+                    // tries its band first as when aligned alone, so only
+                    // hits the band does not settle join the lanes
+                    const bool batch = config.batch_min_hits > 0 &&
+                                       r_end - r >= config.batch_min_hits;
+                    lanes.clear();
+                    lane_ranges.clear();
+                    for (; r < r_end; r++) {
+                        const SubjectRange& sr = ranges[r];
+                        const char* subj = subject.data() + (sr.start - lo);
+                        const int slen = static_cast<int>(sr.end - sr.start + 1);
+                        const auto& pe = profile_of(sr.hit);
+                        if (align_direct(sr.hit, pe, subj, slen, sr.start)) continue;
+                        if (batch && scores_first(sr.hit)) {
+                            if (!config.traceback &&
+                                align_banded(sr.hit, pe.seq, subj, slen, sr.start)) {
+                                align_dp(sr.hit, pe, subj, slen, true);
+                                continue;
+                            }
+                            lanes.push_back({pe.seq.data(), static_cast<int>(pe.seq.size()),
+                                             static_cast<int>(sr.start - lo),
+                                             static_cast<int>(sr.end - lo + 1)});
+                            lane_ranges.push_back(r);
+                        } else {
+                            align_dp(sr.hit, pe, subj, slen, false);
+                        }
+                    }
 
-            parasail_result_free(result);
+                    std::vector<BatchAlignment> batched;
+                    if (batch && lanes.size() >= config.batch_min_hits) {
+                        batched = batch_sg_align(lanes, subject.data(), config.gapopen,
+                                                 config.gapext, band_matrix);
+                        num_batched.fetch_add(lanes.size(), std::memory_order_relaxed);
+                    }
+                    for (size_t lane = 0; lane < lane_ranges.size(); lane++) {
+                        const SubjectRange& sr = ranges[lane_ranges[lane]];
+                        const char* subj = subject.data() + (sr.start - lo);
+                        const int slen = static_cast<int>(sr.end - sr.start + 1);
+                        const auto& pe = profile_of(sr.hit);
+                        if (lane < batched.size() && batched[lane].ok) {
+                            hits[sr.hit].alnscore = batched[lane].score;
+                            hits[sr.hit].qend = static_cast<uint32_t>(batched[lane].end_query);
+                            hits[sr.hit].send = sr.start + static_cast<uint32_t>(batched[lane].end_ref);
+                        } else {
+                            // Too few lanes left to batch (the band was
+                            // already tried where it applies)
+                            align_full(sr.hit, pe, subj, slen, sr.start);
+                        }
+                        align_dp(sr.hit, pe, subj, slen, true);
+                    }
+                }
+                r = r_end;
+            }
         }
+        pool.release(chunk.volume, std::move(handle));
     });
+    logger.debug("Stage 3: %zu subject regions decoded, %zu hits aligned in batches",
+                 num_regions.load(), num_batched.load());
+
+    if (use_prefilter) {
+        size_t dropped = 0;
+        for (size_t i = 0; i < hits.size(); i++) {
+            if (!prefiltered[i]) continue;
+            hit_valid[i] = false;
+            dropped++;
+        }
+        logger.debug("Stage 3: %zu hits cannot reach the positive filters, traceback skipped",
+                     dropped);
+    }
 
     // 5.5. Overlap resolution for multi-chain hits (context > 0 only)
-    // When multiple chains exist for the same (qseqid, sseqid, sstrand),
+    // When multiple chains exist for the same (query, subject, strand),
     // context extension may cause overlapping alignment regions.
-    // Clamp the lower-scoring hit's context and re-align.
-    {
-        bool has_context = context_is_ratio ? (context_ratio > 0) : (context_abs > 0);
-        if (has_context) {
-            // Group hits by (qseqid, sseqid, sstrand)
-            struct HitGroup {
-                std::vector<size_t> indices;
-            };
-            std::unordered_map<std::string, HitGroup> groups;
-            for (size_t i = 0; i < hits.size(); i++) {
-                if (!hit_valid[i] || subject_subseqs[i].empty()) continue;
-                std::string key = hits[i].qseqid + "\t" + hits[i].sseqid + "\t" + hits[i].sstrand;
-                groups[key].indices.push_back(i);
-            }
-
-            for (auto& [key, group] : groups) {
-                if (group.indices.size() < 2) continue;
-
-                // Sort by sstart ascending
-                std::sort(group.indices.begin(), group.indices.end(),
-                    [&hits](size_t a, size_t b) {
-                        return hits[a].sstart < hits[b].sstart;
-                    });
+    // Clamp the lower-scoring hit's context and re-align. Groups share no
+    // hits and are resolved in parallel; each decodes its subject span
+    // once and re-aligns its clamped hits against views into it.
+    if (has_context) {
+        std::vector<size_t> order;
+        for (size_t i = 0; i < hits.size(); i++) {
+            if (hit_valid[i] && fetched[i] && hit_query[i] != SIZE_MAX) order.push_back(i);
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            if (subject_less(a, b)) return true;
+            if (subject_less(b, a)) return false;
+            return std::make_pair(hits[a].sstart, a) < std::make_pair(hits[b].sstart, b);
+        });
+        std::vector<std::pair<size_t, size_t>> group_ranges;  // [begin, end) in order
+        for (size_t b = 0; b < order.size(); ) {
+            size_t e = b + 1;
+            while (e < order.size() && !subject_less(order[b], order[e])) e++;
+            if (e - b >= 2) group_ranges.emplace_back(b, e);
+            b = e;
+        }
 
-                // Iterative overlap resolution
-                bool changed = true;
-                while (changed) {
-                    changed = false;
+        auto context_of = [&](size_t idx) {
+            uint32_t query_len = static_cast<uint32_t>(queries[hit_query[idx]].sequence.size());
+            return context_is_ratio ? static_cast<uint32_t>(query_len * context_ratio)
+                                    : context_abs;
+        };
+
+        tbb::parallel_for(size_t(0), group_ranges.size(), [&](size_t g) {
+            std::vector<size_t> group(order.begin() + group_ranges[g].first,
+                                      order.begin() + group_ranges[g].second);
+            const uint16_t vol = hits[group[0]].volume;
+            const uint32_t oid = hits[group[0]].oid;
+            uint32_t seq_len = hits[group[0]].slen;
+            if (seq_len == 0) seq_len = 1; // safety
+
+            // The group's context-extended span, decoded on the first
+            // re-alignment and widened only if a clamped window leaves it
+            uint32_t span_lo = UINT32_MAX;
+            uint32_t span_hi = 0;
+            for (size_t idx : group) {
+                span_lo = std::min(span_lo, ext_starts[idx]);
+                span_hi = std::max(span_hi, std::min(hits[idx].send + context_of(idx), seq_len - 1));
+            }
+            std::unique_ptr<BlastDbReader> handle;
+            std::string region;
+            bool have_region = false;
+            auto region_view = [&](uint32_t start, uint32_t end) -> const char* {
+                if (!have_region || start < span_lo || end > span_hi) {
+                    span_lo = std::min(span_lo, start);
+                    span_hi = std::max(span_hi, end);
+                    if (!handle) handle = pool.acquire(vol, max_handles);
+                    const BlastDbReader& reader = handle ? *handle : pool.volume(vol);
+                    have_region = reader.get_subsequence(oid, span_lo, span_hi, region);
+                    if (!have_region) return nullptr;
+                }
+                return region.data() + (start - span_lo);
+            };
 
-                    for (size_t gi = 0; gi + 1 < group.indices.size(); gi++) {
-                        size_t idx_a = group.indices[gi];
-                        size_t idx_b = group.indices[gi + 1];
+            // Iterative overlap resolution
+            bool changed = true;
+            while (changed) {
+                changed = false;
 
-                        if (!hit_valid[idx_a] || !hit_valid[idx_b]) continue;
+                for (size_t gi = 0; gi + 1 < group.size(); gi++) {
+                    size_t idx_a = group[gi];
+                    size_t idx_b = group[gi + 1];
 
-                        // Check overlap: hit_a.send >= hit_b.sstart
-                        if (hits[idx_a].send < hits[idx_b].sstart) continue;
+                    if (!hit_valid[idx_a] || !hit_valid[idx_b]) continue;
 
-                        // Determine which has higher chainscore (keep that one intact)
-                        size_t keep_idx, clamp_idx;
-                        if (hits[idx_a].chainscore >= hits[idx_b].chainscore) {
-                            keep_idx = idx_a;
-                            clamp_idx = idx_b;
-                        } else {
-                            keep_idx = idx_b;
-                            clamp_idx = idx_a;
-                        }
+                    // Check overlap: hit_a.send >= hit_b.sstart
+                    if (hits[idx_a].send < hits[idx_b].sstart) continue;
 
-                        // Clamp the lower-scoring hit's overlapping side
-                        // If clamp_idx is before keep_idx: clamp its send
-                        // If clamp_idx is after keep_idx: clamp its sstart
-                        uint32_t new_ext_start, new_ext_end;
-                        uint32_t oid = hits[clamp_idx].oid;
-                        uint32_t seq_len = hits[clamp_idx].slen;
-                        if (seq_len == 0) seq_len = 1; // safety
-
-                        auto qit2 = query_map.find(hits[clamp_idx].qseqid);
-                        if (qit2 == query_map.end()) continue;
-                        uint32_t query_len2 = static_cast<uint32_t>(queries[qit2->second].sequence.size());
-                        uint32_t ctx2 = context_is_ratio
-                            ? static_cast<uint32_t>(query_len2 * context_ratio)
-                            : context_abs;
-
-                        if (hits[clamp_idx].sstart <= hits[keep_idx].sstart) {
-                            // clamp_idx is before keep_idx; clamp its end
-                            uint32_t boundary = hits[keep_idx].sstart;
-                            // Original stage2 region for clamp hit
-                            // We need the stage2 s_end to check if the entire region is consumed
-                            if (hits[clamp_idx].sstart >= boundary) {
-                                // Entire clamp hit is consumed by keep hit
-                                hit_valid[clamp_idx] = false;
-                                changed = true;
-                                continue;
-                            }
-                            new_ext_start = ext_starts[clamp_idx];
-                            new_ext_end = (boundary > 0) ? boundary - 1 : 0;
-                        } else {
-                            // clamp_idx is after keep_idx; clamp its start
-                            uint32_t boundary = hits[keep_idx].send + 1;
-                            if (boundary >= hits[clamp_idx].send) {
-                                // Entire clamp hit is consumed
-                                hit_valid[clamp_idx] = false;
-                                changed = true;
-                                continue;
-                            }
-                            new_ext_start = boundary;
-                            new_ext_end = std::min(hits[clamp_idx].send + ctx2, seq_len - 1);
-                        }
+                    // Determine which has higher chainscore (keep that one intact)
+                    size_t keep_idx, clamp_idx;
+                    if (hits[idx_a].chainscore >= hits[idx_b].chainscore) {
+                        keep_idx = idx_a;
+                        clamp_idx = idx_b;
+                    } else {
+                        keep_idx = idx_b;
+                        clamp_idx = idx_a;
+                    }
 
-                        if (new_ext_start >= new_ext_end) {
+                    // Clamp the lower-scoring hit's overlapping side
+                    // If clamp_idx is before keep_idx: clamp its send
+                    // If clamp_idx is after keep_idx: clamp its sstart
+                    uint32_t new_ext_start, new_ext_end;
+                    if (hits[clamp_idx].sstart <= hits[keep_idx].sstart) {
+                        // clamp_idx is before keep_idx; clamp its end
+                        uint32_t boundary = hits[keep_idx].sstart;
+                        if (hits[clamp_idx].sstart >= boundary) {
+                            // Entire clamp hit is consumed by keep hit
                             hit_valid[clamp_idx] = false;
                             changed = true;
                             continue;
                         }
-
-                        // Re-fetch subject subsequence
-                        uint16_t vol = hits[clamp_idx].volume;
-                        if (vol >= readers.size()) {
+                        new_ext_start = ext_starts[clamp_idx];
+                        new_ext_end = (boundary > 0) ? boundary - 1 : 0;
+                    } else {
+                        // clamp_idx is after keep_idx; clamp its start
+                        uint32_t boundary = hits[keep_idx].send + 1;
+                        if (boundary >= hits[clamp_idx].send) {
+                            // Entire clamp hit is consumed
                             hit_valid[clamp_idx] = false;
                             changed = true;
                             continue;
                         }
-                        subject_subseqs[clamp_idx] = readers[vol].get_subsequence(
-                            oid, new_ext_start, new_ext_end);
-                        ext_starts[clamp_idx] = new_ext_start;
-
-                        // Re-align
-                        size_t qi2 = qit2->second;
-                        bool is_rev2 = (hits[clamp_idx].sstrand == '-');
-                        std::string pkey = std::to_string(qi2) + ":" + (is_rev2 ? "1" : "0");
-                        auto pit = profiles.find(pkey);
-                        if (pit == profiles.end()) continue;
-                        const auto& pe2 = pit->second;
-
-                        const char* subj2 = subject_subseqs[clamp_idx].c_str();
-                        int slen2 = static_cast<int>(subject_subseqs[clamp_idx].size());
-
-                        if (config.traceback) {
-                            parasail_result_t* result2 = parasail_sg_trace_striped_profile_sat(
-                                pe2.profile, subj2, slen2, config.gapopen, config.gapext);
-                            hits[clamp_idx].alnscore = result2->score;
-
-                            parasail_cigar_t* cigar2 = parasail_result_get_cigar(
-                                result2, pe2.seq.c_str(), static_cast<int>(pe2.seq.size()),
-                                subj2, slen2, matrix);
-                            hits[clamp_idx].qstart = static_cast<uint32_t>(cigar2->beg_query);
-                            hits[clamp_idx].qend = static_cast<uint32_t>(result2->end_query);
-                            hits[clamp_idx].sstart = new_ext_start + static_cast<uint32_t>(cigar2->beg_ref);
-                            hits[clamp_idx].send = new_ext_start + static_cast<uint32_t>(result2->end_ref);
-
-                            CigarStats cs2 = walk_cigar(cigar2);
-                            hits[clamp_idx].npositive = cs2.npositive;
-                            hits[clamp_idx].nnegative = cs2.nnegative;
-                            hits[clamp_idx].cigar = cs2.cigar_str;
-                            hits[clamp_idx].ppositive = (cs2.aln_len > 0) ? 100.0 * cs2.npositive / cs2.aln_len : 0.0;
-
-                            parasail_traceback_t* tb2 = parasail_result_get_traceback(
-                                result2, pe2.seq.c_str(), static_cast<int>(pe2.seq.size()),
-                                subj2, slen2, matrix, '|', '*', ' ');
-                            if (tb2) {
-                                hits[clamp_idx].qseq = tb2->query;
-                                hits[clamp_idx].sseq = tb2->ref;
-                                parasail_traceback_free(tb2);
-                            }
-
-                            parasail_cigar_free(cigar2);
-                            parasail_result_free(result2);
-                        } else {
-                            parasail_result_t* result2 = parasail_sg_striped_profile_sat(
-                                pe2.profile, subj2, slen2, config.gapopen, config.gapext);
-                            hits[clamp_idx].alnscore = result2->score;
-                            hits[clamp_idx].qend = static_cast<uint32_t>(result2->end_query);
-                            hits[clamp_idx].send = new_ext_start + static_cast<uint32_t>(result2->end_ref);
-                            parasail_result_free(result2);
-                        }
+                        new_ext_start = boundary;
+                        new_ext_end = std::min(hits[clamp_idx].send + context_of(clamp_idx),
+                                               seq_len - 1);
+                    }
 
+                    if (new_ext_start >= new_ext_end) {
+                        hit_valid[clamp_idx] = false;
                         changed = true;
+                        continue;
                     }
 
-                    // Re-sort by sstart after changes
-                    if (changed) {
-                        // Remove invalidated indices
-                        group.indices.erase(
-                            std::remove_if(group.indices.begin(), group.indices.end(),
-                                [&hit_valid](size_t i) { return !hit_valid[i]; }),
-                            group.indices.end());
-                        std::sort(group.indices.begin(), group.indices.end(),
-                            [&hits](size_t a, size_t b) {
-                                return hits[a].sstart < hits[b].sstart;
-                            });
+                    // Re-align against the decoded span
+                    const char* subj2 = region_view(new_ext_start, new_ext_end);
+                    if (!subj2) {
+                        fetched[clamp_idx] = 0;
+                        hit_valid[clamp_idx] = false;
+                        changed = true;
+                        continue;
                     }
+                    const int slen2 = static_cast<int>(new_ext_end - new_ext_start + 1);
+                    const auto& pe2 = profile_of(clamp_idx);
+                    if (!align_direct(clamp_idx, pe2, subj2, slen2, new_ext_start)) {
+                        // Traced back in full: the hit shares its subject
+                        align_dp(clamp_idx, pe2, subj2, slen2, false);
+                    }
+
+                    changed = true;
+                }
+
+                // Re-sort by sstart after changes
+                if (changed) {
+                    // Remove invalidated indices
+                    group.erase(
+                        std::remove_if(group.begin(), group.end(),
+                            [&hit_valid](size_t i) { return !hit_valid[i]; }),
+                        group.end());
+                    std::sort(group.begin(), group.end(),
+                        [&hits](size_t a, size_t b) {
+                            return hits[a].sstart < hits[b].sstart;
+                        });
                 }
             }
-        }
+            pool.release(vol, std::move(handle));
+        });
     }
 
     // 6. Filter by min_ppositive / min_npositive (only meaningful with traceback)
     std::vector<OutputHit> filtered;
     filtered.reserve(hits.size());
     for (size_t i = 0; i < hits.size(); i++) {
-        if (!hit_valid[i] || subject_subseqs[i].empty()) continue;
+        if (!hit_valid[i] || !fetched[i]) continue;
 
         // Check query exists
         auto qit = query_map.find(hits[i].qseqid);
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 
+#include "io/blastdb_reader_pool.hpp"
 #include "io/result_writer.hpp"
 #include "io/fasta_reader.hpp"
 #include "util/logger.hpp"
@@ -17,16 +18,54 @@ struct Stage3Config {
     double min_ppositive = 0.0;
     uint32_t min_npositive = 0;
     std::string score_matrix = "degmatch";
-    int fetch_threads = 8;   // threads for BLAST DB sequence fetch
+    // "parasail": affine-gap semi-global alignment (with the shortcuts
+    // below). "edit": bit-parallel edit distance of the whole query (see
+    // edit_sg_align()); the shortcuts below are not used.
+    std::string engine = "parasail";
+    int fetch_threads = 8;   // threads fetching one BLAST DB volume through own handles
+    // Hits whose Stage 2 chain lies on one diagonal are first aligned
+    // without gaps on that diagonal (see ungapped_align()).
+    bool ungapped = true;
+    // Score-only alignment: align within the Stage 2 chain's diagonals
+    // widened by band_margin on each side (see banded_sg_align()), falling
+    // back to the full DP when the band result is not trusted.
+    bool banded = true;
+    uint32_t band_margin = 100;  // -stage2_max_gap
+    // Traceback with min_npositive / min_ppositive: skip the traceback of
+    // hits that a score-only pass and a positive-column bound (see
+    // max_positive_columns()) show cannot pass the filters.
+    bool prefilter = true;
+    // Score-only alignments of at least batch_min_hits hits on one decoded
+    // subject region run together, one query per lane (see
+    // batch_sg_align()); 0 disables.
+    uint32_t batch_min_hits = 8;
+    // Align through the Stage 2 chain hits carried in OutputHit::anchors
+    // (see anchored_sg_align()); hits without anchors use the DP above.
+    // anchor_span is the contiguous k-mer length of the anchors.
+    bool anchored = false;
+    int anchor_span = 0;
 };
 
 // Run Stage 3 alignment on merged OutputHits.
 // - hits: Stage 2 results (modified in-place with alignment data)
 // - queries: original FASTA query sequences
-// - db_path: BLAST DB path for subject sequence retrieval
+// - pool: BLAST DB volumes for subject sequence retrieval (opened on
+//   first use and kept open for later calls)
 // - context_is_ratio/context_ratio/context_abs: -context option values
-// - Fetch thread count is controlled by config.fetch_threads
+// - Subjects are fetched in OID-sorted chunks and aligned as they are
+//   decoded; config.fetch_threads caps the reader handles per volume
 // Returns filtered hits (min_ppositive/min_npositive applied).
+std::vector<OutputHit> run_stage3(
+    std::vector<OutputHit>& hits,
+    const std::vector<FastaRecord>& queries,
+    BlastDbReaderPool& pool,
+    const Stage3Config& config,
+    bool context_is_ratio,
+    double context_ratio,
+    uint32_t context_abs,
+    const Logger& logger);
+
+// As above, opening the BLAST DB at db_path for this call only.
 std::vector<OutputHit> run_stage3(
     std::vector<OutputHit>& hits,
     const std::vector<FastaRecord>& queries,
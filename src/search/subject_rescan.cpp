@@ -0,0 +1,84 @@
+#include "search/subject_rescan.hpp"
+#include "index/kix_reader.hpp"
+#include "core/kmer_encoding.hpp"
+#include "core/packed_kmer_scanner.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace ikafssn {
+
+template <typename KmerInt>
+void QueryKmerTable<KmerInt>::build(const uint32_t* positions,
+                                    const KmerInt* kmers, size_t n,
+                                    const KixReader& kix) {
+    slots_.clear();
+    keys_.clear();
+    begin_.clear();
+    qpos_.clear();
+
+    std::vector<std::pair<KmerInt, uint32_t>> entries;
+    entries.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        if (kix.posting_byte_length(kmers[i]) == 0) continue;
+        entries.emplace_back(kmers[i], positions[i]);
+    }
+    if (entries.empty()) return;
+    std::sort(entries.begin(), entries.end());
+
+    qpos_.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (i == 0 || entries[i].first != entries[i - 1].first) {
+            keys_.push_back(entries[i].first);
+            begin_.push_back(static_cast<uint32_t>(qpos_.size()));
+        }
+        qpos_.push_back(entries[i].second);
+    }
+    begin_.push_back(static_cast<uint32_t>(qpos_.size()));
+
+    // Load factor <= 1/2
+    int bits = 1;
+    while ((size_t(1) << bits) < keys_.size() * 2) bits++;
+    shift_ = 32 - bits;
+    mask_ = (1u << bits) - 1;
+    slots_.assign(size_t(1) << bits, 0);
+    for (uint32_t i = 0; i < keys_.size(); i++) {
+        uint32_t h = hash(keys_[i]);
+        while (slots_[h] != 0) h = (h + 1) & mask_;
+        slots_[h] = i + 1;
+    }
+}
+
+template <typename KmerInt>
+void rescan_subject_hits(const QueryKmerTable<KmerInt>& table,
+                         const PackedSubject& subject, int k,
+                         int max_degen_expand, std::vector<Hit>& out) {
+    if (table.empty() || subject.length < static_cast<uint32_t>(k)) return;
+
+    auto emit = [&](uint32_t s_pos, KmerInt kmer) {
+        const uint32_t* b;
+        const uint32_t* e;
+        table.find(kmer, &b, &e);
+        for (; b != e; ++b) out.push_back({*b, s_pos});
+    };
+
+    PackedKmerScanner<KmerInt> scanner(k);
+    scanner.scan(subject.ncbi2na.data(), subject.length, subject.ambig,
+        emit,
+        [&](uint32_t pos, KmerInt base_kmer, const AmbigInfo* infos, int count) {
+            expand_ambig_kmer_multi<KmerInt>(base_kmer, infos, count,
+                [&](KmerInt expanded) { emit(pos, expanded); });
+        },
+        max_degen_expand);
+}
+
+template class QueryKmerTable<uint16_t>;
+template class QueryKmerTable<uint32_t>;
+template void rescan_subject_hits<uint16_t>(
+    const QueryKmerTable<uint16_t>&, const PackedSubject&, int, int,
+    std::vector<Hit>&);
+template void rescan_subject_hits<uint32_t>(
+    const QueryKmerTable<uint32_t>&, const PackedSubject&, int, int,
+    std::vector<Hit>&);
+
+} // namespace ikafssn
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "core/types.hpp"
+#include "io/subject_source.hpp"
+
+namespace ikafssn {
+
+class KixReader;
+
+// Open-addressing hash from query k-mer to the query positions it occurs at
+// (CSR layout), used to turn subject k-mers into Stage 2 hits without .kpx.
+template <typename KmerInt>
+class QueryKmerTable {
+public:
+    // Build from the query strand's (position, k-mer) pairs. Only k-mers with
+    // a non-empty .kix list are kept: those are exactly the k-mers whose
+    // .kpx position lists the two-pass Stage 2 would decode.
+    void build(const uint32_t* positions, const KmerInt* kmers, size_t n,
+               const KixReader& kix);
+
+    bool empty() const { return keys_.empty(); }
+
+    // Query positions of kmer as [*begin, *end); begin == end if absent.
+    void find(KmerInt kmer, const uint32_t** begin, const uint32_t** end) const {
+        static const uint32_t none = 0;
+        *begin = *end = &none;
+        if (keys_.empty()) return;
+        for (uint32_t h = hash(kmer); ; h = (h + 1) & mask_) {
+            uint32_t e = slots_[h];
+            if (e == 0) return;
+            if (keys_[e - 1] == kmer) {
+                *begin = qpos_.data() + begin_[e - 1];
+                *end = qpos_.data() + begin_[e];
+                return;
+            }
+        }
+    }
+
+private:
+    uint32_t hash(KmerInt kmer) const {
+        return (static_cast<uint32_t>(kmer) * 0x9E3779B1u) >> shift_;
+    }
+
+    std::vector<uint32_t> slots_;   // hash slot -> key index + 1 (0 = empty)
+    std::vector<KmerInt> keys_;     // distinct query k-mers
+    std::vector<uint32_t> begin_;   // keys_[i] positions: qpos_[begin_[i], begin_[i+1])
+    std::vector<uint32_t> qpos_;
+    uint32_t mask_ = 0;
+    int shift_ = 32;
+};
+
+// kpx-free Stage 2 hit collection: slide PackedKmerScanner over a candidate
+// subject and append a Hit for every (query position, subject position)
+// pair whose k-mers match. Degenerate subject bases are expanded as the
+// index builder does (max_degen_expand = ikafssnindex -max_degen_expand),
+// so the hits equal the candidate's .kpx postings for the table's k-mers.
+template <typename KmerInt>
+void rescan_subject_hits(const QueryKmerTable<KmerInt>& table,
+                         const PackedSubject& subject, int k,
+                         int max_degen_expand, std::vector<Hit>& out);
+
+extern template class QueryKmerTable<uint16_t>;
+extern template class QueryKmerTable<uint32_t>;
+extern template void rescan_subject_hits<uint16_t>(
+    const QueryKmerTable<uint16_t>&, const PackedSubject&, int, int,
+    std::vector<Hit>&);
+extern template void rescan_subject_hits<uint32_t>(
+    const QueryKmerTable<uint32_t>&, const PackedSubject&, int, int,
+    std::vector<Hit>&);
+
+} // namespace ikafssn
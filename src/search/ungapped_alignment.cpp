@@ -0,0 +1,143 @@
+#include "search/ungapped_alignment.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+namespace ikafssn {
+
+namespace {
+
+constexpr int kBasesPerWord = 16;
+constexpr uint64_t kNibbleLow = 0x1111111111111111ULL;
+
+// IUPAC code -> 4-bit base set (A=1, C=2, G=4, T/U=8; 0 = not a base)
+struct IupacTable {
+    uint8_t mask[256] = {};
+    IupacTable() {
+        const char* codes = "ACGTURYSWKMBDHVN";
+        const uint8_t sets[] = {1, 2, 4, 8, 8, 5, 10, 6, 9, 12, 3, 14, 13, 11, 7, 15};
+        for (int i = 0; codes[i]; i++) {
+            mask[static_cast<unsigned char>(codes[i])] = sets[i];
+            mask[static_cast<unsigned char>(codes[i] - 'A' + 'a')] = sets[i];
+        }
+    }
+};
+
+const IupacTable& iupac() {
+    static const IupacTable table;
+    return table;
+}
+
+// Pack n bases into 4-bit masks; single (if given) holds a 1 in the low
+// bit of every nibble that is exactly one base.
+void pack(const char* seq, int n, std::vector<uint64_t>& words,
+          std::vector<uint64_t>* single) {
+    const auto& t = iupac();
+    const size_t nw = (static_cast<size_t>(n) + kBasesPerWord - 1) / kBasesPerWord;
+    words.assign(nw, 0);
+    if (single) single->assign(nw, 0);
+    for (int i = 0; i < n; i++) {
+        uint64_t m = t.mask[static_cast<unsigned char>(seq[i])];
+        int shift = 4 * (i % kBasesPerWord);
+        words[i / kBasesPerWord] |= m << shift;
+        if (single && m && (m & (m - 1)) == 0) (*single)[i / kBasesPerWord] |= uint64_t(1) << shift;
+    }
+}
+
+} // namespace
+
+UngappedAlignment ungapped_align(
+    const char* query, int qlen,
+    const char* ref, int rlen,
+    int64_t diag, int gapopen,
+    const SubstitutionMatrix& matrix,
+    bool build_cigar) {
+
+    UngappedAlignment out;
+    if (qlen <= 0 || diag < 0 || diag + qlen > rlen) return out;
+    const char* seg = ref + diag;
+
+    auto score_of = [&](char a, char b) {
+        return matrix.matrix[matrix.mapper[static_cast<unsigned char>(a)] * matrix.size +
+                             matrix.mapper[static_cast<unsigned char>(b)]];
+    };
+    int max_score = INT_MIN;
+    for (int i = 0; i < matrix.size * matrix.size; i++) {
+        max_score = std::max(max_score, matrix.matrix[i]);
+    }
+    // Self scores of single bases (nibble bit b -> base)
+    static const char kBase[4] = {'A', 'C', 'G', 'T'};
+    int self_score[4];
+    bool uniform = true;
+    for (int b = 0; b < 4; b++) {
+        self_score[b] = score_of(kBase[b], kBase[b]);
+        uniform = uniform && self_score[b] == self_score[0];
+    }
+
+    std::vector<uint64_t> qw, qs, rw;
+    pack(query, qlen, qw, &qs);
+    pack(seg, qlen, rw, nullptr);
+
+    const size_t nw = qw.size();
+    std::vector<int> block_loss(nw, 0);
+    std::string cols;  // per-column '=' / 'X' when building the CIGAR
+    if (build_cigar) cols.reserve(static_cast<size_t>(qlen));
+
+    for (size_t w = 0; w < nw; w++) {
+        const int begin = static_cast<int>(w) * kBasesPerWord;
+        const int n = std::min(kBasesPerWord, qlen - begin);
+        const uint64_t valid = (n == kBasesPerWord) ? kNibbleLow
+                                                    : kNibbleLow & ((uint64_t(1) << (4 * n)) - 1);
+
+        // Identical single-base columns: equal masks with one bit set
+        uint64_t x = qw[w] ^ rw[w];
+        uint64_t differ = (x | (x >> 1) | (x >> 2) | (x >> 3)) & kNibbleLow;
+        uint64_t exact = ~differ & qs[w] & valid;
+
+        if (exact == valid && uniform) {
+            out.score += n * self_score[0];
+            block_loss[w] = n * (max_score - self_score[0]);
+            if (self_score[0] > 0) out.npositive += n; else out.nnegative += n;
+            if (build_cigar) cols.append(static_cast<size_t>(n), self_score[0] > 0 ? '=' : 'X');
+            continue;
+        }
+
+        for (int i = 0; i < n; i++) {
+            int s;
+            if ((exact >> (4 * i)) & 1) {
+                uint64_t m = (qw[w] >> (4 * i)) & 0xF;
+                s = self_score[m == 1 ? 0 : m == 2 ? 1 : m == 4 ? 2 : 3];
+            } else {
+                s = score_of(query[begin + i], seg[begin + i]);
+            }
+            out.score += s;
+            block_loss[w] += max_score - s;
+            if (s > 0) out.npositive++; else out.nnegative++;
+            if (build_cigar) cols += (s > 0) ? '=' : 'X';
+        }
+    }
+
+    // Mismatch cluster: a path leaving the diagonal there could score
+    // higher. Inside the query it pays two gaps (off and back on), at
+    // either end one gap for the rest of the query.
+    for (size_t w = 0; w < nw; w++) {
+        int loss = block_loss[w] + (w + 1 < nw ? block_loss[w + 1] : 0);
+        bool at_end = (w == 0 || w + 2 >= nw);
+        if (loss >= (at_end ? gapopen : 2 * gapopen)) return UngappedAlignment();
+    }
+
+    if (build_cigar) {
+        for (size_t c = 0; c < cols.size(); ) {
+            size_t e = c;
+            while (e < cols.size() && cols[e] == cols[c]) e++;
+            out.cigar += std::to_string(e - c);
+            out.cigar += cols[c];
+            c = e;
+        }
+    }
+    out.ok = true;
+    return out;
+}
+
+} // namespace ikafssn
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "search/banded_alignment.hpp"
+
+namespace ikafssn {
+
+struct UngappedAlignment {
+    bool ok = false;       // false: not gap-free, run a gapped alignment instead
+    int score = 0;
+    std::string cigar;     // =/X runs (built only when requested)
+    uint32_t npositive = 0;
+    uint32_t nnegative = 0;
+};
+
+// Gap-free alignment of the whole query on one diagonal: query[i] against
+// ref[diag + i] for every i. Both sequences are packed as 4-bit IUPAC
+// masks (16 bases per word), so identical unambiguous columns are found a
+// word at a time and only the remaining columns are scored through the
+// matrix. Columns scoring > 0 are '=', the rest 'X'.
+//
+// ok is false when the diagonal does not hold the whole query inside ref,
+// or when a mismatch cluster suggests an indel: two adjacent 16-column
+// blocks lose, against the best matrix score, at least 2 * gapopen inside
+// the query or gapopen at either end, so a gapped path could score higher.
+// Mismatches spread thinner than that are taken as substitutions; the
+// result is then the parasail_sg_*() alignment unless a gapped path beats
+// the diagonal without such a cluster.
+UngappedAlignment ungapped_align(
+    const char* query, int qlen,
+    const char* ref, int rlen,
+    int64_t diag, int gapopen,
+    const SubstitutionMatrix& matrix,
+    bool build_cigar);
+
+} // namespace ikafssn
@@ -4,7 +4,9 @@
 #include "search/posting_decoder.hpp"
 #include "search/stage1_filter.hpp"
 #include "search/stage2_chaining.hpp"
+#include "search/diagonal_filter.hpp"
 #include "search/query_preprocessor.hpp"
+#include "search/subject_rescan.hpp"
 #include "index/kix_reader.hpp"
 #include "index/kpx_reader.hpp"
 #include "index/ksx_reader.hpp"
@@ -15,8 +17,11 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdio>
-#include <unordered_map>
-#include <unordered_set>
+#include <cstdlib>
+#include <functional>
+
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
 
 namespace ikafssn {
 
@@ -40,6 +45,275 @@ extract_kmers(const std::string& seq, int k, int max_expansion = 16) {
     return kmers;
 }
 
+// Stage 2 look-ahead prefetch for query k-mer qi: .kix/.kpx offset entries of
+// k-mer qi+dist, ID and position list heads of k-mer qi+dist/2.
+// kpx = nullptr prefetches the .kix side only (count pass).
+template <typename KmerInt>
+static inline void prefetch_ahead(const KixReader& kix, const KpxReader* kpx,
+                                  const KmerInt* kmers, size_t n, size_t qi,
+                                  uint32_t dist) {
+    if (dist == 0) return;
+    if (qi + dist < n) {
+        kix.prefetch_offset(kmers[qi + dist]);
+        if (kpx) kpx->prefetch_offset(kmers[qi + dist]);
+    }
+    if (dist >= 2 && qi + dist / 2 < n) {
+        kix.prefetch_posting(kmers[qi + dist / 2]);
+        if (kpx) kpx->prefetch_posting(kmers[qi + dist / 2]);
+    }
+}
+
+// Hash-free Stage 2 hit collection in the Stage1Buffer workspace.
+// Candidates are mapped to dense slots through buf.slot_of, so the candidate
+// test per posting is a single array load. Hit lists are laid out in
+// buf.hit_arena by a count pass (.kix IDs only) followed by a fill pass
+// (.kix + .kpx), giving each list one contiguous range and no per-candidate
+// allocation. Slots are released (slot_of re-zeroed) on destruction, and
+// an arena grown past buf.max_retained_hits is freed.
+class HitArena {
+public:
+    HitArena(Stage1Buffer& buf, uint32_t num_seqs) : buf_(buf) {
+        if (buf_.slot_of.size() < num_seqs) buf_.slot_of.resize(num_seqs, 0);
+        buf_.slot_ids.clear();
+    }
+    ~HitArena() { release(); }
+    HitArena(const HitArena&) = delete;
+    HitArena& operator=(const HitArena&) = delete;
+
+    // Slot of sid, assigned in first-seen order.
+    uint32_t slot(SeqId sid) {
+        uint32_t& s = buf_.slot_of[sid];
+        if (s == 0) {
+            buf_.slot_ids.push_back(sid);
+            s = static_cast<uint32_t>(buf_.slot_ids.size());
+        }
+        return s - 1;
+    }
+    // seq ID -> slot + 1 (0 = not a candidate)
+    const uint32_t* slot_map() const { return buf_.slot_of.data(); }
+
+    void release() {
+        for (SeqId sid : buf_.slot_ids) buf_.slot_of[sid] = 0;
+        buf_.slot_ids.clear();
+        if (buf_.hit_arena.capacity() > buf_.max_retained_hits) {
+            std::vector<Hit>().swap(buf_.hit_arena);
+        }
+    }
+
+    // Zeroed per-list counters for the count pass.
+    size_t* begin_count(size_t num_lists) {
+        buf_.hit_begin.assign(num_lists, 0);
+        return buf_.hit_begin.data();
+    }
+
+    // Turn counts into list offsets, size the arena and return the per-list
+    // fill cursors (list l is written at arena()[cursor[l]++]).
+    size_t* begin_fill() {
+        size_t total = 0;
+        for (auto& b : buf_.hit_begin) {
+            size_t count = b;
+            b = total;
+            total += count;
+        }
+        if (buf_.hit_arena.size() < total) buf_.hit_arena.resize(total);
+        buf_.hit_end = buf_.hit_begin;
+        return buf_.hit_end.data();
+    }
+
+    // Append-mode alternative to count/fill for producers that yield one
+    // list at a time (subject rescan): list l receives the hits appended to
+    // append_buffer() between open_list(l) and close_list(l).
+    void begin_append(size_t num_lists) {
+        buf_.hit_arena.clear();
+        buf_.hit_begin.assign(num_lists, 0);
+        buf_.hit_end.assign(num_lists, 0);
+    }
+    std::vector<Hit>& append_buffer() { return buf_.hit_arena; }
+    void open_list(size_t l) { buf_.hit_begin[l] = buf_.hit_arena.size(); }
+    void close_list(size_t l) { buf_.hit_end[l] = buf_.hit_arena.size(); }
+
+    Hit* arena() { return buf_.hit_arena.data(); }
+    Hit* list(size_t l) { return buf_.hit_arena.data() + buf_.hit_begin[l]; }
+    size_t list_size(size_t l) const { return buf_.hit_end[l] - buf_.hit_begin[l]; }
+
+private:
+    Stage1Buffer& buf_;
+};
+
+// Stage 2 count pass: counts[slot * stride] += postings of each candidate.
+template <typename KmerInt>
+static void count_candidate_postings(
+    const KmerInt* kmers, size_t n_kmers,
+    const KixReader& kix, const uint32_t* slot_of,
+    size_t* counts, size_t stride, uint32_t prefetch_distance) {
+
+    const uint8_t* id_data = kix.posting_data();
+
+    for (size_t qi = 0; qi < n_kmers; qi++) {
+        prefetch_ahead(kix, static_cast<const KpxReader*>(nullptr), kmers, n_kmers, qi,
+                       prefetch_distance);
+        auto kmer_idx = kmers[qi];
+        auto off = kix.posting_offset(kmer_idx);
+        auto end_off = kix.posting_offset(kmer_idx + 1);
+        if (off == end_off) continue;
+
+        SeqIdDecoder id_decoder(id_data + off, id_data + end_off);
+        while (id_decoder.has_more()) {
+            uint32_t s = slot_of[id_decoder.next()];
+            if (s) counts[(s - 1) * stride]++;
+        }
+    }
+}
+
+// Stage 2 fill pass: write candidate hits at arena[cursor[slot]++].
+template <typename KmerInt>
+static void fill_position_hits(
+    const uint32_t* positions, const KmerInt* kmers, size_t n_kmers,
+    const KixReader& kix, const KpxReader& kpx, const uint32_t* slot_of,
+    size_t* cursor, Hit* arena, uint32_t prefetch_distance) {
+
+    const uint8_t* id_data = kix.posting_data();
+    const uint8_t* pos_data = kpx.posting_data();
+
+    for (size_t qi = 0; qi < n_kmers; qi++) {
+        prefetch_ahead(kix, &kpx, kmers, n_kmers, qi, prefetch_distance);
+        uint32_t q_pos = positions[qi];
+        auto kmer_idx = kmers[qi];
+        auto off = kix.posting_offset(kmer_idx);
+        auto end_off = kix.posting_offset(kmer_idx + 1);
+        if (off == end_off) continue;
+
+        SeqIdDecoder id_decoder(id_data + off, id_data + end_off);
+        PosDecoder pos_decoder(pos_data + kpx.pos_offset(kmer_idx));
+
+        while (id_decoder.has_more()) {
+            SeqId sid = id_decoder.next();
+            uint32_t s_pos = pos_decoder.next(id_decoder.was_new_seq());
+
+            if (uint32_t s = slot_of[sid]) {
+                arena[cursor[s - 1]++] = {q_pos, s_pos};
+            }
+        }
+    }
+}
+
+// Intra-query Stage 2 parallelism: chunk size in hits / candidates.
+static constexpr size_t STAGE2_CHUNK_HITS = 8192;
+static constexpr size_t STAGE2_CHUNK_SLOTS = 256;
+
+// Chain candidate slots [0, num_slots) in slot order; chain_slot(slot, out)
+// appends one slot's chains to out. Slot hits are arena list
+// slot * stride + offset. When the candidate count or hit volume reaches the
+// stage2_parallel_* thresholds, consecutive slots are grouped into chunks of
+// about STAGE2_CHUNK_HITS hits, chained as nested TBB tasks, and the chunk
+// results concatenated in chunk order, so the output equals the serial loop.
+// Slots own disjoint arena ranges. The tasks run isolated so that a waiting
+// thread never picks up another query that would reuse its Stage1Buffer.
+template <typename ChainSlot>
+static void chain_slots(const HitArena& arena, size_t num_slots,
+                        size_t stride, size_t offset,
+                        const SearchConfig& config,
+                        std::vector<ChainResult>& results,
+                        const ChainSlot& chain_slot) {
+    size_t total_hits = 0;
+    for (size_t slot = 0; slot < num_slots; slot++) {
+        total_hits += arena.list_size(slot * stride + offset);
+    }
+    const bool parallel = num_slots >= 2 &&
+        ((config.stage2_parallel_min_candidates > 0 &&
+          num_slots >= config.stage2_parallel_min_candidates) ||
+         (config.stage2_parallel_min_hits > 0 &&
+          total_hits >= config.stage2_parallel_min_hits));
+    if (!parallel) {
+        for (size_t slot = 0; slot < num_slots; slot++) chain_slot(slot, results);
+        return;
+    }
+
+    // Chunk boundaries depend only on the hit lists, not on the thread count
+    std::vector<size_t> chunk_begin;
+    chunk_begin.push_back(0);
+    size_t chunk_hits = 0;
+    for (size_t slot = 0; slot < num_slots; slot++) {
+        size_t h = arena.list_size(slot * stride + offset);
+        if (slot > chunk_begin.back() &&
+            (chunk_hits + h > STAGE2_CHUNK_HITS ||
+             slot - chunk_begin.back() >= STAGE2_CHUNK_SLOTS)) {
+            chunk_begin.push_back(slot);
+            chunk_hits = 0;
+        }
+        chunk_hits += h;
+    }
+    chunk_begin.push_back(num_slots);
+
+    const size_t num_chunks = chunk_begin.size() - 1;
+    std::vector<std::vector<ChainResult>> chunk_results(num_chunks);
+    tbb::this_task_arena::isolate([&] {
+        tbb::parallel_for(size_t(0), num_chunks, [&](size_t ci) {
+            for (size_t slot = chunk_begin[ci]; slot < chunk_begin[ci + 1]; slot++) {
+                chain_slot(slot, chunk_results[ci]);
+            }
+        });
+    });
+    for (const auto& cr : chunk_results) {
+        results.insert(results.end(), cr.begin(), cr.end());
+    }
+}
+
+// Cost model for the fused Stage 1 + 2 pass (stage1_filter_fused): it drops
+// the count and fill decodes of every ID list but buffers all postings, so
+// it is chosen when the query's ID lists total at most
+// config.stage12_fused_max_bytes. Every posting takes at least one byte, so
+// this also bounds the buffer.
+template <typename KmerInt>
+static bool use_fused_stage12(const KixReader& kix, const KpxReader& kpx,
+                              const KmerInt* kmers, size_t n_kmers,
+                              const SearchConfig& config) {
+    if (config.mode == 1 || config.stage12_fused_max_bytes == 0) return false;
+    if (!kpx.is_open() || config.stage2_engine == 2) return false;
+    uint64_t bytes = 0;
+    for (size_t qi = 0; qi < n_kmers; qi++) {
+        bytes += kix.posting_byte_length(kmers[qi]);
+        if (bytes > config.stage12_fused_max_bytes) return false;
+    }
+    return true;
+}
+
+// Stage 2 engine choice for contiguous non-canonical indexes: rescan the
+// candidate subjects (subject_rescan) instead of decoding .kpx position
+// lists. Required when .kpx is not open; otherwise forced by
+// config.stage2_engine or, in auto mode, chosen when the candidates' total
+// length in bases is at most the query's .kix ID list bytes, as a scanned
+// base and a posting byte decoded by the count + fill passes cost about
+// the same.
+template <typename KmerInt>
+static bool use_subject_rescan(const std::vector<Stage1Candidate>& candidates,
+                               const KixReader& kix, const KpxReader& kpx,
+                               const KsxReader& ksx,
+                               const KmerInt* kmers, size_t n_kmers,
+                               const SearchConfig& config,
+                               const SubjectSource* subjects) {
+    if (!subjects || config.t > 0) return false;
+    if (!kpx.is_open() || config.stage2_engine == 2) return true;
+    if (config.stage2_engine == 1) return false;
+
+    uint64_t bytes = 0;
+    for (size_t qi = 0; qi < n_kmers; qi++) {
+        bytes += kix.posting_byte_length(kmers[qi]);
+    }
+    uint64_t bases = 0;
+    for (const auto& c : candidates) {
+        bases += ksx.seq_length(c.id);
+        if (bases > bytes) return false;
+    }
+    return true;
+}
+
+// Raise a strand's Stage 1 threshold to the cross-volume score floor
+// (threshold 0 = strand not searched, kept as is).
+static inline uint32_t raise_to_floor(uint32_t threshold, uint32_t score_floor) {
+    return threshold > 0 ? std::max(threshold, score_floor) : 0;
+}
+
 // Stage 1 only: return candidates as ChainResult with stage1_score, no chaining.
 static std::vector<ChainResult>
 stage1_only_results(const std::vector<Stage1Candidate>& candidates,
@@ -72,11 +346,13 @@ search_one_strand_preprocessed(
     bool is_reverse,
     const KixReader& kix,
     const KpxReader& kpx,
+    const KsxReader& ksx,
     const OidFilter& filter,
     const SearchConfig& config,
     uint32_t resolved_threshold,
     uint32_t effective_min_score,
-    Stage1Buffer* buf) {
+    Stage1Buffer* buf,
+    const SubjectSource* subjects) {
 
     if (resolved_threshold == 0 || n_kmers == 0) return {};
 
@@ -84,7 +360,13 @@ search_one_strand_preprocessed(
     Stage1Config stage1_config = config.stage1;
     stage1_config.min_stage1_score = resolved_threshold;
 
-    auto candidates = stage1_filter(positions, kmers, n_kmers, kix, filter, stage1_config, buf);
+    Stage1Buffer local_buf;
+    Stage1Buffer& ws = buf ? *buf : local_buf;
+    const bool fused = use_fused_stage12(kix, kpx, kmers, n_kmers, config);
+
+    auto candidates = fused
+        ? stage1_filter_fused(positions, kmers, n_kmers, kix, kpx, filter, stage1_config, ws)
+        : stage1_filter(positions, kmers, n_kmers, kix, filter, stage1_config, buf);
     if (candidates.empty()) return {};
 
     // Mode 1: Stage 1 only — return candidates directly
@@ -92,25 +374,138 @@ search_one_strand_preprocessed(
         return stage1_only_results(candidates, is_reverse, effective_min_score);
     }
 
-    // Build candidate set for fast lookup and score map
-    std::unordered_set<SeqId> candidate_set;
-    std::unordered_map<SeqId, uint32_t> stage1_scores;
-    candidate_set.reserve(candidates.size());
-    stage1_scores.reserve(candidates.size());
-    for (const auto& c : candidates) {
-        candidate_set.insert(c.id);
-        stage1_scores[c.id] = c.score;
+    // Stage 2: one slot (hit list) per candidate, in Stage 1 order
+    HitArena arena(ws, kix.num_sequences());
+    for (const auto& c : candidates) arena.slot(c.id);
+    const uint32_t* slot_of = arena.slot_map();
+
+    size_t* counts = arena.begin_count(candidates.size());
+    if (fused) {
+        // Group the postings buffered by Stage 1 by candidate slot
+        for (const auto& p : ws.postings) {
+            if (uint32_t s = slot_of[p.id]) counts[s - 1]++;
+        }
+        size_t* cursor = arena.begin_fill();
+        Hit* hits = arena.arena();
+        for (const auto& p : ws.postings) {
+            if (uint32_t s = slot_of[p.id]) hits[cursor[s - 1]++] = {p.q_pos, p.s_pos};
+        }
+    } else if (use_subject_rescan(candidates, kix, kpx, ksx, kmers, n_kmers,
+                                  config, subjects)) {
+        // kpx-free: scan each candidate subject for the query k-mers
+        QueryKmerTable<KmerInt> table;
+        table.build(positions, kmers, n_kmers, kix);
+        arena.begin_append(candidates.size());
+        PackedSubject subject;
+        for (size_t slot = 0; slot < candidates.size(); slot++) {
+            arena.open_list(slot);
+            if (subjects->fetch(candidates[slot].id, subject)) {
+                rescan_subject_hits(table, subject, k,
+                                    config.subject_max_degen_expand,
+                                    arena.append_buffer());
+            }
+            arena.close_list(slot);
+        }
+    } else {
+        count_candidate_postings(kmers, n_kmers, kix, slot_of, counts, 1,
+                                 config.stage1.prefetch_distance);
+        size_t* cursor = arena.begin_fill();
+        fill_position_hits(positions, kmers, n_kmers, kix, kpx, slot_of,
+                           cursor, arena.arena(), config.stage1.prefetch_distance);
+    }
+
+    // Chain hits for each candidate, using effective_min_score
+    Stage2Config stage2_config = config.stage2;
+    stage2_config.min_score = effective_min_score;
+
+    std::vector<ChainResult> results;
+    chain_slots(arena, candidates.size(), 1, 0, config, results,
+        [&](size_t slot, std::vector<ChainResult>& out) {
+            const auto& c = candidates[slot];
+            size_t n_hits = arena.list_size(slot);
+            if (n_hits == 0) return;
+
+            auto chains = chain_hits_inplace(arena.list(slot), n_hits, c.id,
+                                             seed_span(config.t, k), is_reverse, stage2_config);
+            for (auto& cr : chains) {
+                cr.stage1_score = c.score;
+                out.push_back(cr);
+            }
+        });
+
+    return results;
+}
+
+// Canonical index search: one Stage 1 pass over strand-collapsed k-mers,
+// then Stage 2 splits hits by comparing the query and subject strand bits.
+// Equal bits mean a forward-strand match, different bits a reverse-complement
+// match; palindromic query k-mers contribute to both strands.
+template <typename KmerInt>
+static std::vector<ChainResult>
+search_canonical_preprocessed(
+    const QueryKmerData<KmerInt>& qdata,
+    int k,
+    const KixReader& kix,
+    const KpxReader& kpx,
+    const OidFilter& filter,
+    const SearchConfig& config,
+    Stage1Buffer* buf,
+    uint32_t score_floor) {
+
+    const uint32_t threshold_fwd = raise_to_floor(qdata.resolved_threshold_fwd, score_floor);
+    const uint32_t threshold_rc = raise_to_floor(qdata.resolved_threshold_rc, score_floor);
+    const uint32_t min_score_fwd = std::max(qdata.effective_min_score_fwd, score_floor);
+    const uint32_t min_score_rc = std::max(qdata.effective_min_score_rc, score_floor);
+    const bool do_fwd = (config.strand == 2 || config.strand == 1) && threshold_fwd > 0;
+    const bool do_rc = (config.strand == 2 || config.strand == -1) && threshold_rc > 0;
+    const size_t n_kmers = qdata.can_positions.size();
+    if ((!do_fwd && !do_rc) || n_kmers == 0) return {};
+
+    // Stage 1: collapsed score is >= either strand's score, so the lower
+    // of the active strand thresholds is a safe pre-filter.
+    uint32_t threshold = do_fwd ? threshold_fwd : threshold_rc;
+    if (do_fwd && do_rc) threshold = std::min(threshold_fwd, threshold_rc);
+    Stage1Config stage1_config = config.stage1;
+    stage1_config.min_stage1_score = threshold;
+
+    auto candidates = stage1_filter(qdata.can_positions.data(), qdata.can_kmer_values.data(),
+                                    n_kmers, kix, filter, stage1_config, buf);
+    if (candidates.empty()) return {};
+
+    // Mode 1: the strand bit lives in .kpx, so Stage 1 results stay strand-collapsed.
+    if (config.mode == 1) {
+        uint32_t min_score = do_fwd ? min_score_fwd : min_score_rc;
+        if (do_fwd && do_rc) min_score = std::min(min_score_fwd, min_score_rc);
+        return stage1_only_results(candidates, config.strand == -1, min_score);
     }
 
-    // Stage 2: collect hits for candidates
-    std::unordered_map<SeqId, std::vector<Hit>> hits_per_seq;
+    // Stage 2: two hit lists per candidate slot (2*slot = forward,
+    // 2*slot+1 = reverse). The strand bit lives in .kpx, so the count pass
+    // reserves every posting in each active strand's list.
+    Stage1Buffer local_buf;
+    HitArena arena(buf ? *buf : local_buf, kix.num_sequences());
+    for (const auto& c : candidates) arena.slot(c.id);
+    const uint32_t* slot_of = arena.slot_map();
+
+    size_t* counts = arena.begin_count(2 * candidates.size());
+    count_candidate_postings(qdata.can_kmer_values.data(), n_kmers, kix, slot_of,
+                             counts, 2, config.stage1.prefetch_distance);
+    for (size_t slot = 0; slot < candidates.size(); slot++) {
+        counts[2 * slot + 1] = do_rc ? counts[2 * slot] : 0;
+        if (!do_fwd) counts[2 * slot] = 0;
+    }
+    size_t* cursor = arena.begin_fill();
+    Hit* hit_arena = arena.arena();
 
     const uint8_t* id_data = kix.posting_data();
     const uint8_t* pos_data = kpx.posting_data();
 
     for (size_t qi = 0; qi < n_kmers; qi++) {
-        uint32_t q_pos = positions[qi];
-        auto kmer_idx = kmers[qi];
+        prefetch_ahead(kix, &kpx, qdata.can_kmer_values.data(), n_kmers, qi,
+                       config.stage1.prefetch_distance);
+        uint32_t q_pos = qdata.can_positions[qi];
+        uint8_t q_strand = qdata.can_strands[qi];
+        auto kmer_idx = qdata.can_kmer_values[qi];
         auto off = kix.posting_offset(kmer_idx);
         auto end_off = kix.posting_offset(kmer_idx + 1);
         if (off == end_off) continue;
@@ -120,33 +515,92 @@ search_one_strand_preprocessed(
 
         while (id_decoder.has_more()) {
             SeqId sid = id_decoder.next();
-            uint32_t s_pos = pos_decoder.next(id_decoder.was_new_seq());
-
-            if (candidate_set.count(sid)) {
-                hits_per_seq[sid].push_back({q_pos, s_pos});
-            }
+            uint8_t s_strand;
+            uint32_t s_pos = pos_decoder.next_stranded(id_decoder.was_new_seq(), &s_strand);
+
+            uint32_t s = slot_of[sid];
+            if (!s) continue;
+            bool same = (q_strand == 2 || q_strand == s_strand);
+            bool opposite = (q_strand == 2 || q_strand != s_strand);
+            if (do_fwd && same) hit_arena[cursor[2 * (s - 1)]++] = {q_pos, s_pos};
+            if (do_rc && opposite) hit_arena[cursor[2 * (s - 1) + 1]++] = {q_pos, s_pos};
         }
     }
 
-    // Chain hits for each candidate, using effective_min_score
-    Stage2Config stage2_config = config.stage2;
-    stage2_config.min_score = effective_min_score;
+    // Per-strand Stage 1 score: distinct query positions (hits sorted by
+    // q_pos). This is what score_kmers() counts for either score type, since
+    // its last_pos check also merges the postings of one query position in
+    // matchscore mode.
+    auto strand_score = [](const Hit* hits, size_t n) -> uint32_t {
+        uint32_t score = 0;
+        uint32_t last = UINT32_MAX;
+        for (size_t i = 0; i < n; i++) {
+            if (hits[i].q_pos != last) { score++; last = hits[i].q_pos; }
+        }
+        return score;
+    };
 
     std::vector<ChainResult> results;
-    for (const auto& c : candidates) {
-        auto it = hits_per_seq.find(c.id);
-        if (it == hits_per_seq.end()) continue;
-
-        auto chains = chain_hits(it->second, c.id, seed_span(config.t, k), is_reverse, stage2_config);
-        for (auto& cr : chains) {
-            cr.stage1_score = c.score;
-            results.push_back(cr);
-        }
+    auto chain_strand = [&](size_t strand_list, bool is_reverse,
+                            uint32_t strand_threshold,
+                            uint32_t effective_min_score) {
+        Stage2Config stage2_config = config.stage2;
+        stage2_config.min_score = effective_min_score;
+        chain_slots(arena, candidates.size(), 2, strand_list, config, results,
+            [&](size_t slot, std::vector<ChainResult>& out) {
+                const auto& c = candidates[slot];
+                size_t l = 2 * slot + strand_list;
+                Hit* hits = arena.list(l);
+                size_t n_hits = arena.list_size(l);
+                if (n_hits == 0) return;
+                n_hits = dedup_diagonal_filter(hits, n_hits, 1); // sort by q_pos, dedup
+                uint32_t score = strand_score(hits, n_hits);
+                if (score < strand_threshold) return;
+
+                auto chains = chain_hits_inplace(hits, n_hits, c.id, seed_span(config.t, k),
+                                                 is_reverse, stage2_config);
+                for (auto& cr : chains) {
+                    cr.stage1_score = score;
+                    out.push_back(cr);
+                }
+            });
+    };
+
+    if (do_fwd) {
+        chain_strand(0, false, threshold_fwd, min_score_fwd);
+    }
+    if (do_rc) {
+        chain_strand(1, true, threshold_rc, min_score_rc);
     }
 
     return results;
 }
 
+void ScoreFloor::offer(const std::vector<ChainResult>& hits, const SearchConfig& config) {
+    // Exact only when results are ranked by the score being pruned:
+    // Stage 1 score in mode 1, chainscore in mode 2
+    const uint32_t n = config.num_results;
+    if (n == 0 || hits.empty() || config.sort_score != config.mode ||
+        config.sort_score > 2) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto greater = std::greater<uint32_t>();
+    for (const auto& h : hits) {
+        uint32_t score = (config.sort_score == 1) ? h.stage1_score : h.chainscore;
+        if (top_.size() < n) {
+            top_.push_back(score);
+            std::push_heap(top_.begin(), top_.end(), greater);
+        } else if (score > top_.front()) {
+            std::pop_heap(top_.begin(), top_.end(), greater);
+            top_.back() = score;
+            std::push_heap(top_.begin(), top_.end(), greater);
+        }
+    }
+    if (top_.size() == n) floor_.store(top_.front(), std::memory_order_relaxed);
+}
+
 // Sort and truncate helper.
 static void sort_and_truncate(SearchResult& result, const SearchConfig& config) {
     if (config.num_results > 0) {
@@ -179,68 +633,54 @@ SearchResult search_volume(
     const KsxReader& ksx,
     const OidFilter& filter,
     const SearchConfig& config,
-    Stage1Buffer* buf) {
+    Stage1Buffer* buf,
+    const SubjectSource* subjects,
+    ScoreFloor* score_floor) {
 
     SearchResult result;
     result.query_id = query_id;
 
+    // Canonical index: both strands from a single lookup per position
+    if (qdata.canonical) {
+        result.hits = search_canonical_preprocessed(qdata, k, kix, kpx, filter, config, buf,
+                                                    score_floor ? score_floor->get() : 0);
+        sort_and_truncate(result, config);
+        if (score_floor) score_floor->offer(result.hits, config);
+        return result;
+    }
+
     // Search forward strand
     if (config.strand == 2 || config.strand == 1) {
+        uint32_t floor = score_floor ? score_floor->get() : 0;
         auto fwd_results = search_one_strand_preprocessed(
             qdata.fwd_positions.data(), qdata.fwd_kmer_values.data(),
             qdata.fwd_positions.size(),
-            k, false, kix, kpx, filter, config,
-            qdata.resolved_threshold_fwd, qdata.effective_min_score_fwd, buf);
+            k, false, kix, kpx, ksx, filter, config,
+            raise_to_floor(qdata.resolved_threshold_fwd, floor),
+            std::max(qdata.effective_min_score_fwd, floor), buf, subjects);
         result.hits.insert(result.hits.end(), fwd_results.begin(), fwd_results.end());
     }
 
     // Search reverse complement
     if (config.strand == 2 || config.strand == -1) {
+        uint32_t floor = score_floor ? score_floor->get() : 0;
         auto rc_results = search_one_strand_preprocessed(
             qdata.rc_positions.data(), qdata.rc_kmer_values.data(),
             qdata.rc_positions.size(),
-            k, true, kix, kpx, filter, config,
-            qdata.resolved_threshold_rc, qdata.effective_min_score_rc, buf);
+            k, true, kix, kpx, ksx, filter, config,
+            raise_to_floor(qdata.resolved_threshold_rc, floor),
+            std::max(qdata.effective_min_score_rc, floor), buf, subjects);
         result.hits.insert(result.hits.end(), rc_results.begin(), rc_results.end());
     }
 
     sort_and_truncate(result, config);
+    if (score_floor) score_floor->offer(result.hits, config);
     return result;
 }
 
-// Collect position hits for Stage 2 from one index set.
-template <typename KmerInt>
-static void collect_position_hits(
-    const uint32_t* positions, const KmerInt* kmers, size_t n_kmers,
-    const KixReader& kix, const KpxReader& kpx,
-    const std::unordered_set<SeqId>& candidate_set,
-    std::unordered_map<SeqId, std::vector<Hit>>& hits_per_seq) {
-
-    const uint8_t* id_data = kix.posting_data();
-    const uint8_t* pos_data = kpx.posting_data();
-
-    for (size_t qi = 0; qi < n_kmers; qi++) {
-        uint32_t q_pos = positions[qi];
-        auto kmer_idx = kmers[qi];
-        auto off = kix.posting_offset(kmer_idx);
-        auto end_off = kix.posting_offset(kmer_idx + 1);
-        if (off == end_off) continue;
-
-        SeqIdDecoder id_decoder(id_data + off, id_data + end_off);
-        PosDecoder pos_decoder(pos_data + kpx.pos_offset(kmer_idx));
-
-        while (id_decoder.has_more()) {
-            SeqId sid = id_decoder.next();
-            uint32_t s_pos = pos_decoder.next(id_decoder.was_new_seq());
-
-            if (candidate_set.count(sid)) {
-                hits_per_seq[sid].push_back({q_pos, s_pos});
-            }
-        }
-    }
-}
-
 // Search a single volume using merged coding+optimal ("both" mode).
+// Both templates are scored in one Stage 1 accumulator and their position
+// hits are collected into one list per candidate.
 template <typename KmerInt>
 static std::vector<ChainResult>
 search_one_strand_both(
@@ -255,101 +695,76 @@ search_one_strand_both(
     uint32_t resolved_threshold_cod,
     uint32_t resolved_threshold_opt,
     uint32_t effective_min_score,
-    Stage1Buffer* buf_cod,
-    Stage1Buffer* buf_opt) {
+    Stage1Buffer* buf,
+    uint32_t score_floor) {
 
     if (n_cod == 0 && n_opt == 0) return {};
 
-    // Stage 1: run independently on coding and optimal
-    Stage1Config s1cfg = config.stage1;
-    s1cfg.min_stage1_score = 1;     // collect all, merge later
-    s1cfg.stage1_topn = 0;          // no truncation per-template
-
-    std::vector<Stage1Candidate> cand_cod, cand_opt;
-    if (n_cod > 0) {
-        cand_cod = stage1_filter(pos_cod, kmers_cod, n_cod, kix_cod, filter, s1cfg, buf_cod);
-    }
-    if (n_opt > 0) {
-        cand_opt = stage1_filter(pos_opt, kmers_opt, n_opt, kix_opt, filter, s1cfg, buf_opt);
-    }
-
-    // Merge: sum scores per SeqId
-    std::unordered_map<SeqId, uint32_t> merged_scores;
-    merged_scores.reserve(cand_cod.size() + cand_opt.size());
-    for (const auto& c : cand_cod) merged_scores[c.id] += c.score;
-    for (const auto& c : cand_opt) merged_scores[c.id] += c.score;
-
     // Apply combined threshold
-    uint32_t combined_threshold = resolved_threshold_cod + resolved_threshold_opt;
+    uint32_t combined_threshold = raise_to_floor(
+        resolved_threshold_cod + resolved_threshold_opt, score_floor);
     if (combined_threshold == 0) return {};
 
-    // Mode 1: Stage 1 only — return merged candidates directly
+    // Stage 1: summed coding + optimal score per sequence
+    Stage1Config s1cfg = config.stage1;
+    s1cfg.min_stage1_score = combined_threshold;
+    const Stage1Template<KmerInt> templates[2] = {
+        {pos_cod, kmers_cod, n_cod, &kix_cod},
+        {pos_opt, kmers_opt, n_opt, &kix_opt},
+    };
+    auto candidates = stage1_filter_multi(templates, 2, filter, s1cfg, buf);
+    if (candidates.empty()) return {};
+
+    // Mode 1: Stage 1 only — return candidates directly
     if (config.mode == 1) {
         std::vector<ChainResult> results;
-        for (const auto& [sid, score] : merged_scores) {
-            if (score < combined_threshold) continue;
+        results.reserve(candidates.size());
+        for (const auto& c : candidates) {
             ChainResult cr{};
-            cr.seq_id = sid;
+            cr.seq_id = c.id;
             cr.chainscore = 0;
-            cr.stage1_score = score;
+            cr.stage1_score = c.score;
             cr.is_reverse = is_reverse;
             results.push_back(cr);
         }
         return results;
     }
 
-    // Filter candidates
-    std::unordered_set<SeqId> candidate_set;
-    std::unordered_map<SeqId, uint32_t> stage1_scores;
-    for (const auto& [sid, score] : merged_scores) {
-        if (score >= combined_threshold) {
-            candidate_set.insert(sid);
-            stage1_scores[sid] = score;
-        }
-    }
-    if (candidate_set.empty()) return {};
-
-    // Apply stage1_topn if set
-    if (config.stage1.stage1_topn > 0 && candidate_set.size() > config.stage1.stage1_topn) {
-        std::vector<Stage1Candidate> sorted_cands;
-        sorted_cands.reserve(candidate_set.size());
-        for (auto sid : candidate_set) {
-            sorted_cands.push_back({sid, stage1_scores[sid]});
-        }
-        auto cmp = [](const Stage1Candidate& a, const Stage1Candidate& b) {
-            return a.score > b.score;
-        };
-        std::nth_element(sorted_cands.begin(),
-                         sorted_cands.begin() + config.stage1.stage1_topn,
-                         sorted_cands.end(), cmp);
-        sorted_cands.resize(config.stage1.stage1_topn);
-        candidate_set.clear();
-        for (const auto& c : sorted_cands) candidate_set.insert(c.id);
-    }
-
-    // Stage 2: collect position hits from both indexes
-    std::unordered_map<SeqId, std::vector<Hit>> hits_per_seq;
-
-    collect_position_hits(pos_cod, kmers_cod, n_cod, kix_cod, kpx_cod,
-                          candidate_set, hits_per_seq);
-    collect_position_hits(pos_opt, kmers_opt, n_opt, kix_opt, kpx_opt,
-                          candidate_set, hits_per_seq);
+    // Stage 2: collect position hits from both indexes into one list per slot
+    Stage1Buffer local_buf;
+    HitArena arena(buf ? *buf : local_buf,
+                   std::max(kix_cod.num_sequences(), kix_opt.num_sequences()));
+    for (const auto& c : candidates) arena.slot(c.id);
+
+    size_t* counts = arena.begin_count(candidates.size());
+    count_candidate_postings(kmers_cod, n_cod, kix_cod, arena.slot_map(), counts, 1,
+                             config.stage1.prefetch_distance);
+    count_candidate_postings(kmers_opt, n_opt, kix_opt, arena.slot_map(), counts, 1,
+                             config.stage1.prefetch_distance);
+    size_t* cursor = arena.begin_fill();
+    fill_position_hits(pos_cod, kmers_cod, n_cod, kix_cod, kpx_cod, arena.slot_map(),
+                       cursor, arena.arena(), config.stage1.prefetch_distance);
+    fill_position_hits(pos_opt, kmers_opt, n_opt, kix_opt, kpx_opt, arena.slot_map(),
+                       cursor, arena.arena(), config.stage1.prefetch_distance);
 
     // Chain hits
     Stage2Config stage2_config = config.stage2;
-    stage2_config.min_score = effective_min_score;
+    stage2_config.min_score = std::max(effective_min_score, score_floor);
 
     std::vector<ChainResult> results;
-    for (auto sid : candidate_set) {
-        auto it = hits_per_seq.find(sid);
-        if (it == hits_per_seq.end()) continue;
-
-        auto chains = chain_hits(it->second, sid, seed_span(config.t, k), is_reverse, stage2_config);
-        for (auto& cr : chains) {
-            cr.stage1_score = stage1_scores[sid];
-            results.push_back(cr);
-        }
-    }
+    chain_slots(arena, candidates.size(), 1, 0, config, results,
+        [&](size_t slot, std::vector<ChainResult>& out) {
+            const auto& c = candidates[slot];
+            size_t n_hits = arena.list_size(slot);
+            if (n_hits == 0) return;
+
+            auto chains = chain_hits_inplace(arena.list(slot), n_hits, c.id,
+                                             seed_span(config.t, k), is_reverse, stage2_config);
+            for (auto& cr : chains) {
+                cr.stage1_score = c.score;
+                out.push_back(cr);
+            }
+        });
 
     return results;
 }
@@ -365,8 +780,8 @@ SearchResult search_volume_both(
     const KsxReader& ksx,
     const OidFilter& filter,
     const SearchConfig& config,
-    Stage1Buffer* buf_cod,
-    Stage1Buffer* buf_opt) {
+    Stage1Buffer* buf,
+    ScoreFloor* score_floor) {
 
     SearchResult result;
     result.query_id = query_id;
@@ -383,7 +798,7 @@ SearchResult search_volume_both(
             filter, config,
             qdata_cod.resolved_threshold_fwd, qdata_opt.resolved_threshold_fwd,
             std::max(qdata_cod.effective_min_score_fwd, qdata_opt.effective_min_score_fwd),
-            buf_cod, buf_opt);
+            buf, score_floor ? score_floor->get() : 0);
         result.hits.insert(result.hits.end(), fwd_results.begin(), fwd_results.end());
     }
 
@@ -399,10 +814,136 @@ SearchResult search_volume_both(
             filter, config,
             qdata_cod.resolved_threshold_rc, qdata_opt.resolved_threshold_rc,
             std::max(qdata_cod.effective_min_score_rc, qdata_opt.effective_min_score_rc),
-            buf_cod, buf_opt);
+            buf, score_floor ? score_floor->get() : 0);
         result.hits.insert(result.hits.end(), rc_results.begin(), rc_results.end());
     }
 
+    sort_and_truncate(result, config);
+    if (score_floor) score_floor->offer(result.hits, config);
+    return result;
+}
+
+template <typename KmerInt>
+SearchResult search_volume_window(
+    const std::string& query_id,
+    const QueryWindow<KmerInt>& window,
+    int k,
+    const KixReader& kix,
+    const KpxReader& kpx,
+    const KsxReader& ksx,
+    const OidFilter& filter,
+    const SearchConfig& config,
+    Stage1Buffer* buf,
+    const SubjectSource* subjects) {
+
+    SearchConfig window_config = config;
+    window_config.stage2.core_q_begin = window.core_begin;
+    window_config.stage2.core_q_end = window.core_end;
+    window_config.num_results = 0;  // truncated after merge_window_results()
+    // A part crossing a core boundary may be a subject's weaker chain in
+    // this window; the per-subject limit applies to the stitched chains
+    window_config.stage2.max_nhit_per_subject = 0;
+
+    SearchResult result = search_volume(query_id, window.qdata, k, kix, kpx, ksx,
+                                        filter, window_config, buf, subjects);
+    for (auto& cr : result.hits) {
+        cr.q_start += window.offset;
+        cr.q_end += window.offset;
+        for (auto& h : cr.anchors) h.q_pos += window.offset;
+    }
+    return result;
+}
+
+template <typename KmerInt>
+SearchResult merge_window_results(
+    const std::string& query_id,
+    const std::vector<QueryWindow<KmerInt>>& windows,
+    const std::vector<SearchResult>& parts,
+    int k,
+    const SearchConfig& config) {
+
+    SearchResult result;
+    result.query_id = query_id;
+
+    // All window chains grouped by (subject, strand), in window then query order
+    struct Part { const ChainResult* cr; uint32_t window; };
+    std::vector<Part> chains;
+    for (size_t w = 0; w < parts.size(); w++) {
+        for (const auto& cr : parts[w].hits) chains.push_back({&cr, static_cast<uint32_t>(w)});
+    }
+    std::sort(chains.begin(), chains.end(), [](const Part& a, const Part& b) {
+        if (a.cr->seq_id != b.cr->seq_id) return a.cr->seq_id < b.cr->seq_id;
+        if (a.cr->is_reverse != b.cr->is_reverse) return a.cr->is_reverse < b.cr->is_reverse;
+        if (a.window != b.window) return a.window < b.window;
+        return a.cr->q_start < b.cr->q_start;
+    });
+
+    const int64_t span = seed_span(config.t, k);
+    const int64_t max_gap = config.stage2.max_gap;
+    const uint32_t max_chains = config.stage2.max_nhit_per_subject;
+
+    std::vector<ChainResult> group;
+    std::vector<uint32_t> last_window;  // per group chain: window of its last part
+    std::vector<uint32_t> min_score;    // per group chain: lowest window minimum
+    for (size_t i = 0; i < chains.size(); ) {
+        size_t j = i;
+        group.clear();
+        last_window.clear();
+        min_score.clear();
+        for (; j < chains.size() && chains[j].cr->seq_id == chains[i].cr->seq_id &&
+               chains[j].cr->is_reverse == chains[i].cr->is_reverse; j++) {
+            const ChainResult& c = *chains[j].cr;
+            const uint32_t w = chains[j].window;
+            const uint32_t w_min = c.is_reverse ? windows[w].min_score_rc
+                                                : windows[w].min_score_fwd;
+
+            // Best-scoring earlier chain that c can extend
+            size_t best = SIZE_MAX;
+            for (size_t g = 0; g < group.size(); g++) {
+                if (last_window[g] >= w) continue;
+                const ChainResult& o = group[g];
+                int64_t last_q = static_cast<int64_t>(o.q_end) - span;
+                int64_t last_s = static_cast<int64_t>(o.s_end) - span;
+                if (last_q >= c.q_start || last_s >= c.s_start) continue;
+                int64_t diag_shift = (static_cast<int64_t>(c.s_start) - c.q_start) -
+                                     (last_s - last_q);
+                if (std::abs(diag_shift) > max_gap) continue;
+                if (best == SIZE_MAX || o.chainscore > group[best].chainscore) best = g;
+            }
+
+            if (best == SIZE_MAX) {
+                group.push_back(c);
+                last_window.push_back(w);
+                min_score.push_back(w_min);
+            } else {
+                ChainResult& o = group[best];
+                o.chainscore += c.chainscore;
+                o.stage1_score = std::max(o.stage1_score, c.stage1_score);
+                o.q_end = c.q_end;
+                o.s_end = c.s_end;
+                o.anchors.insert(o.anchors.end(), c.anchors.begin(), c.anchors.end());
+                last_window[best] = w;
+                min_score[best] = std::min(min_score[best], w_min);
+            }
+        }
+
+        size_t kept = 0;
+        for (size_t g = 0; g < group.size(); g++) {
+            if (group[g].chainscore >= min_score[g]) group[kept++] = group[g];
+        }
+        group.resize(kept);
+
+        if (max_chains > 0 && group.size() > max_chains) {
+            std::partial_sort(group.begin(), group.begin() + max_chains, group.end(),
+                [](const ChainResult& a, const ChainResult& b) {
+                    return a.chainscore > b.chainscore;
+                });
+            group.resize(max_chains);
+        }
+        result.hits.insert(result.hits.end(), group.begin(), group.end());
+        i = j;
+    }
+
     sort_and_truncate(result, config);
     return result;
 }
@@ -411,11 +952,13 @@ SearchResult search_volume_both(
 template SearchResult search_volume<uint16_t>(
     const std::string&, const QueryKmerData<uint16_t>&, int,
     const KixReader&, const KpxReader&, const KsxReader&,
-    const OidFilter&, const SearchConfig&, Stage1Buffer*);
+    const OidFilter&, const SearchConfig&, Stage1Buffer*,
+    const SubjectSource*, ScoreFloor*);
 template SearchResult search_volume<uint32_t>(
     const std::string&, const QueryKmerData<uint32_t>&, int,
     const KixReader&, const KpxReader&, const KsxReader&,
-    const OidFilter&, const SearchConfig&, Stage1Buffer*);
+    const OidFilter&, const SearchConfig&, Stage1Buffer*,
+    const SubjectSource*, ScoreFloor*);
 
 template SearchResult search_volume_both<uint16_t>(
     const std::string&,
@@ -423,13 +966,31 @@ template SearchResult search_volume_both<uint16_t>(
     const KixReader&, const KpxReader&,
     const KixReader&, const KpxReader&,
     const KsxReader&, const OidFilter&, const SearchConfig&,
-    Stage1Buffer*, Stage1Buffer*);
+    Stage1Buffer*, ScoreFloor*);
 template SearchResult search_volume_both<uint32_t>(
     const std::string&,
     const QueryKmerData<uint32_t>&, const QueryKmerData<uint32_t>&, int,
     const KixReader&, const KpxReader&,
     const KixReader&, const KpxReader&,
     const KsxReader&, const OidFilter&, const SearchConfig&,
-    Stage1Buffer*, Stage1Buffer*);
+    Stage1Buffer*, ScoreFloor*);
+
+template SearchResult merge_window_results<uint16_t>(
+    const std::string&, const std::vector<QueryWindow<uint16_t>>&,
+    const std::vector<SearchResult>&, int, const SearchConfig&);
+template SearchResult merge_window_results<uint32_t>(
+    const std::string&, const std::vector<QueryWindow<uint32_t>>&,
+    const std::vector<SearchResult>&, int, const SearchConfig&);
+
+template SearchResult search_volume_window<uint16_t>(
+    const std::string&, const QueryWindow<uint16_t>&, int,
+    const KixReader&, const KpxReader&, const KsxReader&,
+    const OidFilter&, const SearchConfig&, Stage1Buffer*,
+    const SubjectSource*);
+template SearchResult search_volume_window<uint32_t>(
+    const std::string&, const QueryWindow<uint32_t>&, int,
+    const KixReader&, const KpxReader&, const KsxReader&,
+    const OidFilter&, const SearchConfig&, Stage1Buffer*,
+    const SubjectSource*);
 
 } // namespace ikafssn
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -16,6 +18,7 @@ class KpxReader;
 class KsxReader;
 class KhxReader;
 class OidFilter;
+class SubjectSource;
 
 struct SearchConfig {
     Stage1Config stage1;
@@ -28,6 +31,36 @@ struct SearchConfig {
     double min_stage1_score_frac = 0; // 0 = disabled, 0 < P < 1 = fractional mode
     uint16_t max_degen_expand = 16;  // max degenerate expansion per k-mer (0/1: disable)
     uint8_t  t = 0;  // template length (0 = contiguous)
+    // Rare-first query k-mer selection (preprocess_query): keep the rarest
+    // k-mers until either limit is reached. 0 = disabled.
+    uint64_t stage1_max_postings = 0;    // posting-decode budget per query strand
+    double   stage1_target_coverage = 0; // fraction of query positions to cover (0 < x <= 1)
+    // DUST low-complexity query masking (preprocess_query): k-mers overlapping
+    // a masked window are not looked up. 0 = disabled, 20 = dustmasker default.
+    uint16_t dust_level = 0;
+    uint16_t dust_window = 64;  // DUST window length in bases
+    // Intra-query Stage 2 parallelism: one strand's candidate chaining is
+    // split into nested TBB tasks once it reaches either threshold
+    // (0 = that trigger disabled; both 0 = always single-threaded).
+    uint32_t stage2_parallel_min_candidates = 2048;
+    uint64_t stage2_parallel_min_hits = 65536;
+    // Fused Stage 1 + 2 (single-template, non-canonical indexes): IDs and
+    // positions are decoded once when the query's .kix ID lists for a strand
+    // total at most this many bytes (0 = always two passes).
+    uint64_t stage12_fused_max_bytes = 262144;
+    // Stage 2 engine (contiguous non-canonical indexes, search_volume with a
+    // SubjectSource): 0 = auto by cost, 1 = .kpx position lists,
+    // 2 = rescan candidate subject sequences. Without .kpx, rescan is used.
+    uint8_t  stage2_engine = 0;
+    // Degenerate subject base expansion for the rescan engine; must match
+    // the index build (ikafssnindex -max_degen_expand).
+    uint16_t subject_max_degen_expand = 4;
+    // Long-query windows (split_query_windows, Stage 2 modes): queries longer
+    // than query_window bases are searched as windows of that many bases,
+    // each also scoring query_window_overlap bases on either side in Stage 1.
+    // 0 = disabled.
+    uint32_t query_window = 0;
+    uint32_t query_window_overlap = 1000;
 };
 
 struct SearchResult {
@@ -35,9 +68,33 @@ struct SearchResult {
     std::vector<ChainResult> hits;
 };
 
+// Per-query score floor shared by the volume searches of one query.
+// With num_results = N > 0 and sort_score 1 or 2, every finished volume
+// offers its reported scores; once N of them are known, the floor is the
+// N-th best, and later volume searches drop Stage 1 candidates and chains
+// scoring below it, since they cannot survive the final cross-volume
+// truncation. A chain's score never exceeds its subject's Stage 1 score
+// (one hit per query position), so this also holds for Stage 1 pruning in
+// mode 2. The floor only rises; reads are lock-free.
+class ScoreFloor {
+public:
+    uint32_t get() const { return floor_.load(std::memory_order_relaxed); }
+
+    // Record one volume's reported hits (after sort_and_truncate).
+    void offer(const std::vector<ChainResult>& hits, const SearchConfig& config);
+
+private:
+    std::mutex mutex_;
+    std::vector<uint32_t> top_;          // min-heap of the N best scores
+    std::atomic<uint32_t> floor_{0};
+};
+
 // Search a single volume using pre-processed query k-mer data.
 // High-freq k-mers have already been removed and thresholds resolved globally.
 // buf: optional thread-local Stage1Buffer to avoid per-call allocation.
+// subjects: optional subject sequences of this volume for the kpx-free
+// Stage 2 engine (required in modes 2/3 when kpx is not open).
+// score_floor: optional per-query floor shared across volumes (see ScoreFloor).
 template <typename KmerInt>
 SearchResult search_volume(
     const std::string& query_id,
@@ -48,20 +105,25 @@ SearchResult search_volume(
     const KsxReader& ksx,
     const OidFilter& filter,
     const SearchConfig& config,
-    Stage1Buffer* buf = nullptr);
+    Stage1Buffer* buf = nullptr,
+    const SubjectSource* subjects = nullptr,
+    ScoreFloor* score_floor = nullptr);
 
 extern template SearchResult search_volume<uint16_t>(
     const std::string&, const QueryKmerData<uint16_t>&, int,
     const KixReader&, const KpxReader&, const KsxReader&,
-    const OidFilter&, const SearchConfig&, Stage1Buffer*);
+    const OidFilter&, const SearchConfig&, Stage1Buffer*,
+    const SubjectSource*, ScoreFloor*);
 extern template SearchResult search_volume<uint32_t>(
     const std::string&, const QueryKmerData<uint32_t>&, int,
     const KixReader&, const KpxReader&, const KsxReader&,
-    const OidFilter&, const SearchConfig&, Stage1Buffer*);
+    const OidFilter&, const SearchConfig&, Stage1Buffer*,
+    const SubjectSource*, ScoreFloor*);
 
 // Search a single volume using merged coding+optimal indexes ("both" mode).
 // Two separate QueryKmerData are provided: one for coding, one for optimal.
-// Stage 1 scores are summed across both templates; Stage 2 hits are merged.
+// Both templates are scored in one Stage 1 accumulator (scores summed) and
+// their Stage 2 hits are merged, so one Stage1Buffer serves both.
 template <typename KmerInt>
 SearchResult search_volume_both(
     const std::string& query_id,
@@ -73,8 +135,8 @@ SearchResult search_volume_both(
     const KsxReader& ksx,
     const OidFilter& filter,
     const SearchConfig& config,
-    Stage1Buffer* buf_cod = nullptr,
-    Stage1Buffer* buf_opt = nullptr);
+    Stage1Buffer* buf = nullptr,
+    ScoreFloor* score_floor = nullptr);
 
 extern template SearchResult search_volume_both<uint16_t>(
     const std::string&,
@@ -82,13 +144,64 @@ extern template SearchResult search_volume_both<uint16_t>(
     const KixReader&, const KpxReader&,
     const KixReader&, const KpxReader&,
     const KsxReader&, const OidFilter&, const SearchConfig&,
-    Stage1Buffer*, Stage1Buffer*);
+    Stage1Buffer*, ScoreFloor*);
 extern template SearchResult search_volume_both<uint32_t>(
     const std::string&,
     const QueryKmerData<uint32_t>&, const QueryKmerData<uint32_t>&, int,
     const KixReader&, const KpxReader&,
     const KixReader&, const KpxReader&,
     const KsxReader&, const OidFilter&, const SearchConfig&,
-    Stage1Buffer*, Stage1Buffer*);
+    Stage1Buffer*, ScoreFloor*);
+
+// Search one long-query window (see split_query_windows()) in a volume.
+// Stage 2 chains only the window core and keeps every chain per subject
+// (max_nhit_per_subject applies after stitching); hits are not truncated
+// and their query coordinates are shifted back to the whole query.
+template <typename KmerInt>
+SearchResult search_volume_window(
+    const std::string& query_id,
+    const QueryWindow<KmerInt>& window,
+    int k,
+    const KixReader& kix,
+    const KpxReader& kpx,
+    const KsxReader& ksx,
+    const OidFilter& filter,
+    const SearchConfig& config,
+    Stage1Buffer* buf = nullptr,
+    const SubjectSource* subjects = nullptr);
+
+extern template SearchResult search_volume_window<uint16_t>(
+    const std::string&, const QueryWindow<uint16_t>&, int,
+    const KixReader&, const KpxReader&, const KsxReader&,
+    const OidFilter&, const SearchConfig&, Stage1Buffer*,
+    const SubjectSource*);
+extern template SearchResult search_volume_window<uint32_t>(
+    const std::string&, const QueryWindow<uint32_t>&, int,
+    const KixReader&, const KpxReader&, const KsxReader&,
+    const OidFilter&, const SearchConfig&, Stage1Buffer*,
+    const SubjectSource*);
+
+// Join the window results of one volume (parts[i] from windows[i], in
+// query order) into one result. A chain is stitched onto a chain of an
+// earlier window of the same subject and strand when the Stage 2 chaining
+// rule would link them (both sequences advance, diagonal shift <= max_gap);
+// windows chain disjoint hit sets, so the chainscores add up. A stitched
+// chain is kept if it reaches the minimum chain score of a window it spans;
+// then at most max_nhit_per_subject chains are kept per subject and strand,
+// and num_results is applied as by search_volume().
+template <typename KmerInt>
+SearchResult merge_window_results(
+    const std::string& query_id,
+    const std::vector<QueryWindow<KmerInt>>& windows,
+    const std::vector<SearchResult>& parts,
+    int k,
+    const SearchConfig& config);
+
+extern template SearchResult merge_window_results<uint16_t>(
+    const std::string&, const std::vector<QueryWindow<uint16_t>>&,
+    const std::vector<SearchResult>&, int, const SearchConfig&);
+extern template SearchResult merge_window_results<uint32_t>(
+    const std::string&, const std::vector<QueryWindow<uint32_t>>&,
+    const std::vector<SearchResult>&, int, const SearchConfig&);
 
 } // namespace ikafssn
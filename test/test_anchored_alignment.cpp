@@ -0,0 +1,186 @@
+#include "test_util.hpp"
+#include "search/anchored_alignment.hpp"
+#include "search/banded_alignment.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ikafssn;
+
+// A T G C N (match 5, mismatch -4, N vs any 1), parasail layout
+static int g_matrix[25];
+static int g_mapper[256];
+
+static SubstitutionMatrix make_matrix() {
+    for (int& m : g_mapper) m = 4;
+    g_mapper['A'] = 0; g_mapper['T'] = 1; g_mapper['G'] = 2; g_mapper['C'] = 3;
+    for (int a = 0; a < 5; a++) {
+        for (int b = 0; b < 5; b++) {
+            g_matrix[a * 5 + b] = (a == 4 || b == 4) ? 1 : (a == b ? 5 : -4);
+        }
+    }
+    SubstitutionMatrix m;
+    m.matrix = g_matrix;
+    m.mapper = g_mapper;
+    m.size = 5;
+    return m;
+}
+
+static std::string random_seq(std::mt19937& rng, size_t len) {
+    static const char bases[] = "ACGT";
+    std::string s(len, 'A');
+    for (auto& c : s) c = bases[rng() % 4];
+    return s;
+}
+
+// Copy of src with substitutions and short indels
+static std::string mutate(std::mt19937& rng, const std::string& src) {
+    static const char bases[] = "ACGT";
+    std::string out;
+    for (char c : src) {
+        unsigned r = rng() % 100;
+        if (r < 2) continue;                      // deletion
+        if (r < 4) out += bases[rng() % 4];       // insertion
+        out += (r < 8) ? bases[rng() % 4] : c;    // substitution
+    }
+    return out;
+}
+
+// Exact k-mer matches on one diagonal chain (q and r increasing)
+static std::vector<Hit> exact_anchors(const std::string& q, const std::string& r, int k) {
+    std::vector<Hit> anchors;
+    int last_r = -1;
+    for (int i = 0; i + k <= static_cast<int>(q.size()); i += k) {
+        size_t at = r.find(q.substr(i, k), static_cast<size_t>(last_r + 1));
+        if (at == std::string::npos) continue;
+        anchors.push_back({static_cast<SeqPos>(i), static_cast<SeqPos>(at)});
+        last_r = static_cast<int>(at);
+    }
+    return anchors;
+}
+
+// Score of the aligned strings; checks them against the sequences and CIGAR
+static int rescore(const AnchoredAlignment& a, const std::string& q,
+                   const std::string& r, int gapopen, int gapext,
+                   const SubstitutionMatrix& m) {
+    CHECK_EQ(a.qseq.size(), a.sseq.size());
+    CHECK_EQ(a.qseq.size(), a.aln_len);
+    int score = 0;
+    int qi = a.beg_query, ri = a.beg_ref;
+    char gap = 0;
+    std::string ops;
+    for (size_t c = 0; c < a.qseq.size(); c++) {
+        char op;
+        if (a.qseq[c] == '-') {
+            op = 'D';
+            CHECK(a.sseq[c] == r[ri++]);
+        } else if (a.sseq[c] == '-') {
+            op = 'I';
+            CHECK(a.qseq[c] == q[qi++]);
+        } else {
+            CHECK(a.qseq[c] == q[qi]);
+            CHECK(a.sseq[c] == r[ri]);
+            int s = m.matrix[m.mapper[static_cast<unsigned char>(q[qi++])] * m.size +
+                             m.mapper[static_cast<unsigned char>(r[ri++])]];
+            score += s;
+            op = (s > 0) ? '=' : 'X';
+        }
+        if (op == 'I' || op == 'D') score -= (gap == op) ? gapext : gapopen;
+        gap = (op == 'I' || op == 'D') ? op : 0;
+        ops += op;
+    }
+    std::string cigar;
+    for (size_t c = 0; c < ops.size(); ) {
+        size_t e = c;
+        while (e < ops.size() && ops[e] == ops[c]) e++;
+        cigar += std::to_string(e - c);
+        cigar += ops[c];
+        c = e;
+    }
+    CHECK_EQ(qi - 1, a.end_query);
+    CHECK_EQ(ri - 1, a.end_ref);
+    CHECK(cigar == a.cigar);
+    return score;
+}
+
+static void test_identical_copy() {
+    std::fprintf(stderr, "-- test_identical_copy\n");
+
+    auto m = make_matrix();
+    std::mt19937 rng(5);
+    std::string q = random_seq(rng, 120);
+    std::string r = random_seq(rng, 80) + q + random_seq(rng, 80);
+
+    auto a = anchored_sg_align(q.data(), 120, r.data(), static_cast<int>(r.size()),
+                               exact_anchors(q, r, 11), 11, 10, 1, m);
+    CHECK(a.ok);
+    CHECK_EQ(a.score, 600);
+    CHECK(a.cigar == "120=");
+    CHECK_EQ(a.beg_query, 0);
+    CHECK_EQ(a.beg_ref, 80);
+    CHECK_EQ(a.end_query, 119);
+    CHECK_EQ(a.end_ref, 199);
+    CHECK_EQ(a.npositive, 120u);
+    CHECK_EQ(a.nnegative, 0u);
+}
+
+static void test_mutated_copy() {
+    std::fprintf(stderr, "-- test_mutated_copy\n");
+
+    auto m = make_matrix();
+    std::mt19937 rng(13);
+    for (int round = 0; round < 30; round++) {
+        std::string q = random_seq(rng, 200);
+        std::string r = random_seq(rng, 150) + mutate(rng, q) + random_seq(rng, 150);
+        auto anchors = exact_anchors(q, r.substr(150), 12);
+        for (auto& h : anchors) h.s_pos += 150;
+        if (anchors.empty()) continue;
+
+        auto a = anchored_sg_align(q.data(), 200, r.data(), static_cast<int>(r.size()),
+                                   anchors, 12, 10, 1, m);
+        CHECK(a.ok);
+        CHECK_EQ(rescore(a, q, r, 10, 1, m), a.score);
+
+        // Constrained to the anchors: never above the unconstrained optimum
+        auto full = banded_sg_align(q.data(), 200, r.data(), static_cast<int>(r.size()),
+                                    -200, static_cast<int>(r.size()), 10, 1, m);
+        CHECK(a.score <= full.score);
+        CHECK(a.score > full.score / 2);
+    }
+}
+
+static void test_unusable_anchors() {
+    std::fprintf(stderr, "-- test_unusable_anchors\n");
+
+    auto m = make_matrix();
+    std::mt19937 rng(17);
+    std::string q = random_seq(rng, 60);
+    std::string r = random_seq(rng, 40) + q + random_seq(rng, 40);
+
+    // No anchors, or only anchors running past the sequence ends
+    auto none = anchored_sg_align(q.data(), 60, r.data(), static_cast<int>(r.size()),
+                                  {}, 11, 10, 1, m);
+    CHECK(!none.ok);
+    auto outside = anchored_sg_align(q.data(), 60, r.data(), static_cast<int>(r.size()),
+                                     {{55, 95}}, 11, 10, 1, m);
+    CHECK(!outside.ok);
+
+    // A crossing anchor (query position moves backwards) is dropped and
+    // overlapping anchors on one diagonal merge into one run
+    std::vector<Hit> anchors = {{0, 40}, {5, 45}, {30, 70}, {10, 90}};
+    auto a = anchored_sg_align(q.data(), 60, r.data(), static_cast<int>(r.size()),
+                               anchors, 11, 10, 1, m);
+    CHECK(a.ok);
+    CHECK_EQ(a.score, 300);
+    CHECK(a.cigar == "60=");
+}
+
+int main() {
+    test_identical_copy();
+    test_mutated_copy();
+    test_unusable_anchors();
+
+    TEST_SUMMARY();
+    return g_fail_count > 0 ? 1 : 0;
+}
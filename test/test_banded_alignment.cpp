@@ -0,0 +1,179 @@
+#include "test_util.hpp"
+#include "search/banded_alignment.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ikafssn;
+
+// A T G C N (match 5, mismatch -4, N vs any 1), parasail layout
+static int g_matrix[25];
+static int g_mapper[256];
+
+static SubstitutionMatrix make_matrix() {
+    for (int& m : g_mapper) m = 4;
+    g_mapper['A'] = 0; g_mapper['T'] = 1; g_mapper['G'] = 2; g_mapper['C'] = 3;
+    for (int a = 0; a < 5; a++) {
+        for (int b = 0; b < 5; b++) {
+            g_matrix[a * 5 + b] = (a == 4 || b == 4) ? 1 : (a == b ? 5 : -4);
+        }
+    }
+    SubstitutionMatrix m;
+    m.matrix = g_matrix;
+    m.mapper = g_mapper;
+    m.size = 5;
+    return m;
+}
+
+// Full semi-global DP with the same recurrences and end rule
+static BandedAlignment reference_sg(const std::string& q, const std::string& r,
+                                    int gapopen, int gapext,
+                                    const SubstitutionMatrix& m) {
+    const int NEG = INT_MIN / 4;
+    int ql = static_cast<int>(q.size());
+    int rl = static_cast<int>(r.size());
+    std::vector<int> hp(rl + 1, 0), fp(rl + 1, NEG), hc(rl + 1), fc(rl + 1);
+    std::vector<int> last_col(ql);
+    BandedAlignment out;
+    out.score = NEG;
+    for (int i = 0; i < ql; i++) {
+        hc[0] = 0;
+        int e = NEG;
+        for (int j = 0; j < rl; j++) {
+            e = std::max(e - gapext, hc[j] - gapopen);
+            fc[j + 1] = std::max(fp[j + 1] - gapext, hp[j + 1] - gapopen);
+            int s = m.matrix[m.mapper[static_cast<unsigned char>(q[i])] * m.size +
+                             m.mapper[static_cast<unsigned char>(r[j])]];
+            hc[j + 1] = std::max({hp[j] + s, e, fc[j + 1]});
+            if (i == ql - 1 && hc[j + 1] > out.score) {
+                out.score = hc[j + 1];
+                out.end_query = i;
+                out.end_ref = j;
+            }
+        }
+        last_col[i] = hc[rl];
+        std::swap(hp, hc);
+        std::swap(fp, fc);
+    }
+    for (int i = 0; i < ql; i++) {
+        if (last_col[i] > out.score) {
+            out.score = last_col[i];
+            out.end_query = i;
+            out.end_ref = rl - 1;
+        } else if (last_col[i] == out.score && out.end_ref == rl - 1 && i < out.end_query) {
+            out.end_query = i;
+        }
+    }
+    out.in_band = true;
+    return out;
+}
+
+static std::string random_seq(std::mt19937& rng, size_t len) {
+    static const char bases[] = "ACGT";
+    std::string s(len, 'A');
+    for (auto& c : s) c = bases[rng() % 4];
+    return s;
+}
+
+// Copy of src with substitutions and short indels
+static std::string mutate(std::mt19937& rng, const std::string& src) {
+    static const char bases[] = "ACGT";
+    std::string out;
+    for (char c : src) {
+        unsigned r = rng() % 100;
+        if (r < 3) continue;                      // deletion
+        if (r < 6) out += bases[rng() % 4];       // insertion
+        out += (r < 12) ? bases[rng() % 4] : c;   // substitution
+    }
+    return out;
+}
+
+static void test_full_band_matches_reference() {
+    std::fprintf(stderr, "-- test_full_band_matches_reference\n");
+
+    auto m = make_matrix();
+    std::mt19937 rng(7);
+    for (int round = 0; round < 50; round++) {
+        std::string q = random_seq(rng, 20 + rng() % 60);
+        std::string r = random_seq(rng, 10 + rng() % 120);
+        if (round % 2 == 0 && r.size() > q.size()) {
+            // Plant a mutated copy of the query
+            std::string copy = mutate(rng, q);
+            size_t at = rng() % (r.size() - q.size());
+            r.replace(at, std::min(copy.size(), r.size() - at), copy);
+        }
+        if (round % 5 == 0) q[rng() % q.size()] = 'N';
+
+        auto ref = reference_sg(q, r, 10, 1, m);
+        auto band = banded_sg_align(q.data(), static_cast<int>(q.size()),
+                                    r.data(), static_cast<int>(r.size()),
+                                    -static_cast<int>(q.size()),
+                                    static_cast<int>(r.size()), 10, 1, m);
+        CHECK(band.in_band);
+        CHECK_EQ(band.score, ref.score);
+        CHECK_EQ(band.end_query, ref.end_query);
+        CHECK_EQ(band.end_ref, ref.end_ref);
+    }
+}
+
+static void test_narrow_band_around_match() {
+    std::fprintf(stderr, "-- test_narrow_band_around_match\n");
+
+    auto m = make_matrix();
+    std::mt19937 rng(11);
+    for (int round = 0; round < 30; round++) {
+        std::string q = random_seq(rng, 150);
+        std::string r = random_seq(rng, 300) + mutate(rng, q) + random_seq(rng, 300);
+        auto ref = reference_sg(q, r, 10, 1, m);
+
+        // Band of +-20 diagonals around the planted copy at ref offset 300
+        auto band = banded_sg_align(q.data(), static_cast<int>(q.size()),
+                                    r.data(), static_cast<int>(r.size()),
+                                    280, 320, 10, 1, m);
+        CHECK(band.in_band);
+        CHECK_EQ(band.score, ref.score);
+        CHECK_EQ(band.end_query, ref.end_query);
+        CHECK_EQ(band.end_ref, ref.end_ref);
+    }
+}
+
+static void test_band_edge_reported() {
+    std::fprintf(stderr, "-- test_band_edge_reported\n");
+
+    auto m = make_matrix();
+    std::mt19937 rng(3);
+    std::string q = random_seq(rng, 100);
+    std::string r = random_seq(rng, 200) + q.substr(0, 50) + "ACGTACGTAC" +
+                    q.substr(50) + random_seq(rng, 200);
+    auto ref = reference_sg(q, r, 10, 1, m);
+
+    // The copy runs on diagonals 200 then 210; a band covering both is exact
+    auto both = banded_sg_align(q.data(), static_cast<int>(q.size()),
+                                r.data(), static_cast<int>(r.size()),
+                                195, 215, 10, 1, m);
+    CHECK(both.in_band);
+    CHECK_EQ(both.score, ref.score);
+    CHECK_EQ(both.end_ref, ref.end_ref);
+
+    // A band [200, 205] keeps the first half on its edge diagonal only
+    auto cut = banded_sg_align(q.data(), static_cast<int>(q.size()),
+                               r.data(), static_cast<int>(r.size()),
+                               200, 205, 10, 1, m);
+    CHECK(!cut.in_band);
+
+    // A band that misses every end cell
+    auto none = banded_sg_align(q.data(), 100, r.data(), 10, 50, 60, 10, 1, m);
+    CHECK(!none.in_band);
+}
+
+int main() {
+    test_full_band_matches_reference();
+    test_narrow_band_around_match();
+    test_band_edge_reported();
+
+    TEST_SUMMARY();
+    return g_fail_count > 0 ? 1 : 0;
+}
@@ -0,0 +1,158 @@
+#include "test_util.hpp"
+#include "search/batch_alignment.hpp"
+#include "search/banded_alignment.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ikafssn;
+
+// A T G C N (match 5, mismatch -4, N vs any 1), parasail layout
+static int g_matrix[25];
+static int g_mapper[256];
+
+static SubstitutionMatrix make_matrix() {
+    for (int& m : g_mapper) m = 4;
+    g_mapper['A'] = 0; g_mapper['T'] = 1; g_mapper['G'] = 2; g_mapper['C'] = 3;
+    for (int a = 0; a < 5; a++) {
+        for (int b = 0; b < 5; b++) {
+            g_matrix[a * 5 + b] = (a == 4 || b == 4) ? 1 : (a == b ? 5 : -4);
+        }
+    }
+    SubstitutionMatrix m;
+    m.matrix = g_matrix;
+    m.mapper = g_mapper;
+    m.size = 5;
+    return m;
+}
+
+static std::string random_seq(std::mt19937& rng, size_t len) {
+    static const char bases[] = "ACGT";
+    std::string s(len, 'A');
+    for (auto& c : s) c = bases[rng() % 4];
+    return s;
+}
+
+static std::string mutate(std::mt19937& rng, const std::string& s, int edits) {
+    static const char bases[] = "ACGT";
+    std::string out = s;
+    for (int e = 0; e < edits && !out.empty(); e++) {
+        size_t p = rng() % out.size();
+        switch (rng() % 3) {
+            case 0: out[p] = bases[rng() % 4]; break;
+            case 1: out.erase(p, 1); break;
+            default: out.insert(out.begin() + p, bases[rng() % 4]); break;
+        }
+    }
+    return out;
+}
+
+// Every batched lane must match banded_sg_align() over its whole window
+static void check_lanes(const std::vector<BatchLane>& lanes,
+                        const std::vector<BatchAlignment>& got,
+                        const std::string& ref, const SubstitutionMatrix& m) {
+    CHECK_EQ(got.size(), lanes.size());
+    for (size_t k = 0; k < lanes.size(); k++) {
+        if (!got[k].ok) continue;
+        const BatchLane& b = lanes[k];
+        int w = b.ref_end - b.ref_begin;
+        auto full = banded_sg_align(b.query, b.qlen, ref.data() + b.ref_begin, w,
+                                    -b.qlen, w, 10, 1, m);
+        CHECK_EQ(got[k].score, full.score);
+        CHECK_EQ(got[k].end_query, full.end_query);
+        CHECK_EQ(got[k].end_ref, full.end_ref);
+    }
+}
+
+static void test_random_batches() {
+    std::fprintf(stderr, "-- test_random_batches\n");
+
+    auto m = make_matrix();
+    std::mt19937 rng(43);
+    for (int round = 0; round < 20; round++) {
+        std::string ref = random_seq(rng, 600 + rng() % 400);
+        int nlanes = 2 + static_cast<int>(rng() % 40);
+        std::vector<std::string> queries(nlanes);
+        std::vector<BatchLane> lanes(nlanes);
+        for (int k = 0; k < nlanes; k++) {
+            // Windows around one region of ref, as hits of many queries
+            int qlen = 20 + static_cast<int>(rng() % 120);
+            int pos = 100 + static_cast<int>(rng() % 300);
+            queries[k] = mutate(rng, ref.substr(pos, qlen), static_cast<int>(rng() % 8));
+            if (queries[k].empty()) queries[k] = "A";
+            if (k % 7 == 3) queries[k][0] = 'N';
+            lanes[k].query = queries[k].data();
+            lanes[k].qlen = static_cast<int>(queries[k].size());
+            lanes[k].ref_begin = std::max(0, pos - static_cast<int>(rng() % 60));
+            lanes[k].ref_end = std::min(static_cast<int>(ref.size()),
+                                        pos + qlen + static_cast<int>(rng() % 60));
+        }
+        auto got = batch_sg_align(lanes, ref.data(), 10, 1, m);
+        int nok = 0;
+        for (const auto& g : got) nok += g.ok ? 1 : 0;
+        CHECK(nok >= nlanes / 2);
+        check_lanes(lanes, got, ref, m);
+    }
+}
+
+static void test_unbatched_lanes() {
+    std::fprintf(stderr, "-- test_unbatched_lanes\n");
+
+    auto m = make_matrix();
+    std::mt19937 rng(47);
+    std::string ref = random_seq(rng, 2000);
+    std::string q1 = ref.substr(100, 50);
+    std::string q2 = ref.substr(110, 50);
+    std::string q3 = ref.substr(1800, 50);
+
+    std::vector<BatchLane> lanes(4);
+    lanes[0] = {q1.data(), 50, 80, 170};
+    lanes[1] = {q2.data(), 50, 90, 180};
+    lanes[2] = {q3.data(), 50, 1780, 1870};  // far away: alone in its group
+    lanes[3] = {q1.data(), 50, 500, 500};    // empty window
+
+    auto got = batch_sg_align(lanes, ref.data(), 10, 1, m);
+    CHECK(got[0].ok);
+    CHECK(got[1].ok);
+    CHECK(!got[2].ok);
+    CHECK(!got[3].ok);
+    CHECK_EQ(got[0].score, 250);
+    CHECK_EQ(got[0].end_ref, 69);
+    CHECK_EQ(got[1].score, 250);
+    CHECK_EQ(got[1].end_ref, 69);
+    check_lanes(lanes, got, ref, m);
+}
+
+static void test_long_queries() {
+    std::fprintf(stderr, "-- test_long_queries\n");
+
+    // Score range beyond 16-bit lanes
+    auto m = make_matrix();
+    std::mt19937 rng(53);
+    std::string ref = random_seq(rng, 3000);
+    std::vector<std::string> queries(5);
+    std::vector<BatchLane> lanes(5);
+    for (int k = 0; k < 5; k++) {
+        int pos = 400 + 37 * k;
+        queries[k] = mutate(rng, ref.substr(pos, 1500), 20);
+        lanes[k].query = queries[k].data();
+        lanes[k].qlen = static_cast<int>(queries[k].size());
+        lanes[k].ref_begin = pos - 100;
+        lanes[k].ref_end = pos + 1600;
+    }
+    auto got = batch_sg_align(lanes, ref.data(), 10, 1, m);
+    for (const auto& g : got) CHECK(g.ok);
+    CHECK(got[0].score > 5000);
+    check_lanes(lanes, got, ref, m);
+}
+
+int main() {
+    test_random_batches();
+    test_unbatched_lanes();
+    test_long_queries();
+
+    TEST_SUMMARY();
+    return g_fail_count > 0 ? 1 : 0;
+}
@@ -1,6 +1,10 @@
 #include "test_util.hpp"
 #include "search/stage2_chaining.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <random>
+
 using namespace ikafssn;
 
 static void test_single_hit() {
@@ -237,6 +241,139 @@ static void test_chain_max_lookback_zero_unlimited() {
     CHECK_EQ(result[0].chainscore, 5u);
 }
 
+static void test_exact_dp_matches_all_pairs() {
+    std::fprintf(stderr, "-- test_exact_dp_matches_all_pairs\n");
+
+    // Repetitive subject: collinear runs on a few diagonals, repeated q_pos
+    // values and random noise, large enough for the exact range-max DP path.
+    std::mt19937 rng(12345);
+    for (int round = 0; round < 20; round++) {
+        std::vector<Hit> hits;
+        uint32_t num_diags = 1 + rng() % 6;
+        for (uint32_t d = 0; d < num_diags; d++) {
+            uint32_t diag = 50 + rng() % 400;
+            for (uint32_t q = rng() % 20; q < 600; q += 1 + rng() % 9) {
+                uint32_t jitter = rng() % 7;
+                hits.push_back({q, q + diag + jitter});
+            }
+        }
+        for (int i = 0; i < 200; i++) {
+            hits.push_back({static_cast<uint32_t>(rng() % 600),
+                            static_cast<uint32_t>(rng() % 1200)});
+        }
+
+        Stage2Config config;
+        config.min_diag_hits = 1;
+        config.min_score = 1;
+        config.max_gap = 1 + rng() % 40;
+        config.max_nhit_per_subject = 4;
+
+        config.chain_max_lookback = 0; // exact DP
+        auto exact = chain_hits(hits, 0, 7, false, config);
+        config.chain_max_lookback = UINT32_MAX; // all-pairs DP
+        auto ref = chain_hits(hits, 0, 7, false, config);
+
+        CHECK_EQ(exact.size(), ref.size());
+        for (size_t i = 0; i < exact.size() && i < ref.size(); i++) {
+            CHECK_EQ(exact[i].chainscore, ref[i].chainscore);
+            CHECK_EQ(exact[i].q_start, ref[i].q_start);
+            CHECK_EQ(exact[i].q_end, ref[i].q_end);
+            CHECK_EQ(exact[i].s_start, ref[i].s_start);
+            CHECK_EQ(exact[i].s_end, ref[i].s_end);
+        }
+    }
+}
+
+static void test_multi_chain_peel_matches_rerun() {
+    std::fprintf(stderr, "-- test_multi_chain_peel_matches_rerun\n");
+
+    // Tandem copies: the same query region hits the subject at several
+    // offsets, some closer together than max_gap, so peeling a chain lowers
+    // the scores of hits on neighbouring copies.
+    std::mt19937 rng(777);
+    for (int round = 0; round < 20; round++) {
+        std::vector<Hit> hits;
+        uint32_t period = 20 + rng() % 200;
+        uint32_t copies = 2 + rng() % 8;
+        for (uint32_t c = 0; c < copies; c++) {
+            for (uint32_t q = rng() % 5; q < 300; q += 1 + rng() % 6) {
+                if (rng() % 5 == 0) continue;
+                hits.push_back({q, q + 100 + c * period + static_cast<uint32_t>(rng() % 3)});
+            }
+        }
+        for (int i = 0; i < 50; i++) {
+            hits.push_back({static_cast<uint32_t>(rng() % 300),
+                            static_cast<uint32_t>(rng() % (300 + copies * period))});
+        }
+
+        Stage2Config config;
+        config.min_diag_hits = 1;
+        config.min_score = 1 + rng() % 3;
+        config.max_gap = 5 + rng() % 60;
+        config.max_nhit_per_subject = 0; // unlimited
+
+        config.chain_max_lookback = 0; // single DP pass, chains peeled off
+        auto peeled = chain_hits(hits, 0, 7, false, config);
+        config.chain_max_lookback = UINT32_MAX; // all-pairs DP re-run per chain
+        auto ref = chain_hits(hits, 0, 7, false, config);
+
+        CHECK_EQ(peeled.size(), ref.size());
+        for (size_t i = 0; i < peeled.size() && i < ref.size(); i++) {
+            CHECK_EQ(peeled[i].chainscore, ref[i].chainscore);
+            CHECK_EQ(peeled[i].q_start, ref[i].q_start);
+            CHECK_EQ(peeled[i].q_end, ref[i].q_end);
+            CHECK_EQ(peeled[i].s_start, ref[i].s_start);
+            CHECK_EQ(peeled[i].s_end, ref[i].s_end);
+        }
+    }
+}
+
+static void test_chain_hits_inplace_matches_copy() {
+    std::fprintf(stderr, "-- test_chain_hits_inplace_matches_copy\n");
+
+    // Two candidates' hit lists side by side in one buffer, unsorted and
+    // with duplicates; chaining one range must not touch the other.
+    std::mt19937 rng(4242);
+    for (int round = 0; round < 20; round++) {
+        std::vector<Hit> a, b;
+        for (int i = 0; i < 150; i++) {
+            uint32_t q = static_cast<uint32_t>(rng() % 200);
+            a.push_back({q, q + 50 + static_cast<uint32_t>(rng() % 4)});
+            b.push_back({static_cast<uint32_t>(rng() % 200),
+                         static_cast<uint32_t>(rng() % 400)});
+        }
+        a.push_back(a[0]);
+        std::shuffle(a.begin(), a.end(), rng);
+
+        std::vector<Hit> arena = a;
+        arena.insert(arena.end(), b.begin(), b.end());
+
+        Stage2Config config;
+        config.min_score = 1;
+        config.max_gap = 8;
+        config.min_diag_hits = 1 + round % 3;
+        config.max_nhit_per_subject = 1 + round % 4;
+
+        auto ref = chain_hits(a, 3, 7, true, config);
+        auto res = chain_hits_inplace(arena.data(), a.size(), 3, 7, true, config);
+
+        CHECK_EQ(res.size(), ref.size());
+        for (size_t i = 0; i < res.size() && i < ref.size(); i++) {
+            CHECK_EQ(res[i].seq_id, ref[i].seq_id);
+            CHECK_EQ(res[i].chainscore, ref[i].chainscore);
+            CHECK_EQ(res[i].q_start, ref[i].q_start);
+            CHECK_EQ(res[i].q_end, ref[i].q_end);
+            CHECK_EQ(res[i].s_start, ref[i].s_start);
+            CHECK_EQ(res[i].s_end, ref[i].s_end);
+            CHECK(res[i].is_reverse);
+        }
+        for (size_t i = 0; i < b.size(); i++) {
+            CHECK_EQ(arena[a.size() + i].q_pos, b[i].q_pos);
+            CHECK_EQ(arena[a.size() + i].s_pos, b[i].s_pos);
+        }
+    }
+}
+
 static void test_empty_hits() {
     std::fprintf(stderr, "-- test_empty_hits\n");
 
@@ -355,6 +492,47 @@ static void test_multi_chain_score_order() {
     CHECK_EQ(result[2].chainscore, 2u);
 }
 
+static void test_keep_anchors() {
+    std::fprintf(stderr, "-- test_keep_anchors\n");
+
+    // Region A (3 hits) and region B (4 hits), plus an off-chain hit
+    std::vector<Hit> hits = {
+        {14, 114}, {0, 100}, {7, 107},
+        {21, 921}, {0, 900}, {14, 914}, {7, 907},
+        {3, 5000}
+    };
+    Stage2Config config;
+    config.min_score = 1;
+    config.max_gap = 50;
+    config.max_nhit_per_subject = 2;
+
+    for (uint32_t lookback : {0u, 8u}) {
+        config.chain_max_lookback = lookback;
+        config.keep_anchors = false;
+        auto plain = chain_hits(hits, 0, 7, false, config);
+        CHECK_EQ(plain.size(), 2u);
+        for (const auto& cr : plain) CHECK(cr.anchors.empty());
+
+        config.keep_anchors = true;
+        auto result = chain_hits(hits, 0, 7, false, config);
+        CHECK_EQ(result.size(), 2u);
+        if (result.size() != 2) continue;
+        CHECK_EQ(result[0].anchors.size(), 4u);
+        CHECK_EQ(result[1].anchors.size(), 3u);
+        for (const auto& cr : result) {
+            CHECK_EQ(cr.anchors.size(), cr.chainscore);
+            CHECK_EQ(cr.anchors.front().q_pos, cr.q_start);
+            CHECK_EQ(cr.anchors.front().s_pos, cr.s_start);
+            CHECK_EQ(cr.anchors.back().q_pos + 7, cr.q_end);
+            CHECK_EQ(cr.anchors.back().s_pos + 7, cr.s_end);
+            for (size_t i = 1; i < cr.anchors.size(); i++) {
+                CHECK(cr.anchors[i - 1].q_pos < cr.anchors[i].q_pos);
+                CHECK(cr.anchors[i - 1].s_pos < cr.anchors[i].s_pos);
+            }
+        }
+    }
+}
+
 int main() {
     test_single_hit();
     test_perfect_chain();
@@ -368,12 +546,16 @@ int main() {
     test_chain_max_lookback_basic();
     test_chain_max_lookback_interleaved();
     test_chain_max_lookback_zero_unlimited();
+    test_exact_dp_matches_all_pairs();
     test_empty_hits();
     test_duplicate_hits_dedup();
     test_multi_chain_two_regions();
     test_multi_chain_unlimited();
     test_multi_chain_default_one();
     test_multi_chain_score_order();
+    test_multi_chain_peel_matches_rerun();
+    test_chain_hits_inplace_matches_copy();
+    test_keep_anchors();
 
     TEST_SUMMARY();
     return g_fail_count > 0 ? 1 : 0;
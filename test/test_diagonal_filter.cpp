@@ -1,6 +1,10 @@
 #include "test_util.hpp"
 #include "search/diagonal_filter.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <random>
+
 using namespace ikafssn;
 
 static void test_no_filter_when_threshold_1() {
@@ -69,12 +73,73 @@ static void test_negative_diagonal() {
     }
 }
 
+static void test_dedup_filter_sorted_output() {
+    std::fprintf(stderr, "-- test_dedup_filter_sorted_output\n");
+
+    // Duplicate {5,105} counts once: diagonal 100 has 2 distinct hits.
+    std::vector<Hit> hits = {
+        {10, 110}, {5, 105}, {20, 10}, {5, 105}, {7, 300}
+    };
+
+    size_t n = dedup_diagonal_filter(hits.data(), hits.size(), 2);
+    CHECK_EQ(n, 2u);
+    CHECK_EQ(hits[0].q_pos, 5u);
+    CHECK_EQ(hits[0].s_pos, 105u);
+    CHECK_EQ(hits[1].q_pos, 10u);
+    CHECK_EQ(hits[1].s_pos, 110u);
+
+    n = dedup_diagonal_filter(hits.data(), hits.size(), 3);
+    CHECK_EQ(n, 0u);
+}
+
+static void test_dedup_filter_matches_reference() {
+    std::fprintf(stderr, "-- test_dedup_filter_matches_reference\n");
+
+    // Reference: sort + unique, then the order-preserving diagonal_filter().
+    // Sizes cover both the std::sort and radix paths; positions include
+    // large values and negative diagonals.
+    std::mt19937 rng(99);
+    for (int round = 0; round < 40; round++) {
+        size_t n = (round % 4 == 0) ? rng() % 50 : 200 + rng() % 5000;
+        uint32_t range = (round % 3 == 0) ? 0xFFFFFFF0u : 2000;
+        uint32_t min_diag = round % 5; // 0 and 1 disable the filter
+        std::vector<Hit> hits;
+        for (size_t i = 0; i < n; i++) {
+            uint32_t q = static_cast<uint32_t>(rng() % range);
+            uint32_t s = (rng() % 2) ? static_cast<uint32_t>(q + rng() % 8)
+                                     : static_cast<uint32_t>(rng() % range);
+            hits.push_back({q, s});
+            if (rng() % 4 == 0) hits.push_back({q, s});
+        }
+
+        std::vector<Hit> ref = hits;
+        auto less = [](const Hit& a, const Hit& b) {
+            return a.q_pos < b.q_pos || (a.q_pos == b.q_pos && a.s_pos < b.s_pos);
+        };
+        std::sort(ref.begin(), ref.end(), less);
+        ref.erase(std::unique(ref.begin(), ref.end(), [](const Hit& a, const Hit& b) {
+            return a.q_pos == b.q_pos && a.s_pos == b.s_pos;
+        }), ref.end());
+        ref = diagonal_filter(ref, min_diag);
+
+        size_t m = dedup_diagonal_filter(hits.data(), hits.size(), min_diag);
+        CHECK_EQ(m, ref.size());
+        bool same = (m == ref.size());
+        for (size_t i = 0; same && i < m; i++) {
+            same = hits[i].q_pos == ref[i].q_pos && hits[i].s_pos == ref[i].s_pos;
+        }
+        CHECK(same);
+    }
+}
+
 int main() {
     test_no_filter_when_threshold_1();
     test_filter_isolates();
     test_filter_with_higher_threshold();
     test_empty_input();
     test_negative_diagonal();
+    test_dedup_filter_sorted_output();
+    test_dedup_filter_matches_reference();
 
     TEST_SUMMARY();
     return g_fail_count > 0 ? 1 : 0;
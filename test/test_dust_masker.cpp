@@ -0,0 +1,94 @@
+#include "test_util.hpp"
+#include "search/dust_masker.hpp"
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+using namespace ikafssn;
+
+static std::string random_seq(size_t len, uint32_t seed) {
+    static const char bases[] = "ACGT";
+    std::mt19937 rng(seed);
+    std::string s(len, 'A');
+    for (auto& c : s) c = bases[rng() & 3];
+    return s;
+}
+
+static uint32_t count_masked(const std::vector<uint8_t>& mask) {
+    uint32_t n = 0;
+    for (uint8_t m : mask) n += m;
+    return n;
+}
+
+static void test_disabled() {
+    std::fprintf(stderr, "-- test_disabled\n");
+
+    std::string seq(100, 'A');
+    auto mask = dust_mask(seq, 0);
+    CHECK_EQ(mask.size(), seq.size());
+    CHECK_EQ(count_masked(mask), 0u);
+}
+
+static void test_random_not_masked() {
+    std::fprintf(stderr, "-- test_random_not_masked\n");
+
+    std::string seq = random_seq(500, 42);
+    auto mask = dust_mask(seq, 20);
+    CHECK_EQ(count_masked(mask), 0u);
+}
+
+static void test_homopolymer_masked() {
+    std::fprintf(stderr, "-- test_homopolymer_masked\n");
+
+    // poly-A tail after a random region
+    std::string seq = random_seq(200, 7) + std::string(80, 'A');
+    auto mask = dust_mask(seq, 20);
+    for (size_t i = 200; i < seq.size(); i++) CHECK_EQ(mask[i], 1);
+    // Start of the random region is untouched
+    for (size_t i = 0; i < 100; i++) CHECK_EQ(mask[i], 0);
+}
+
+static void test_microsatellite_masked() {
+    std::fprintf(stderr, "-- test_microsatellite_masked\n");
+
+    std::string repeat;
+    for (int i = 0; i < 30; i++) repeat += "CAG";
+    std::string seq = random_seq(150, 3) + repeat + random_seq(150, 4);
+    auto mask = dust_mask(seq, 20);
+    for (size_t i = 150; i < 150 + repeat.size(); i++) CHECK_EQ(mask[i], 1);
+    CHECK_EQ(mask[0], 0);
+    CHECK_EQ(mask[seq.size() - 1], 0);
+}
+
+static void test_short_query() {
+    std::fprintf(stderr, "-- test_short_query\n");
+
+    // Shorter than the window: scored as a single window
+    auto mask = dust_mask("ATATATATATATATATATAT", 20);
+    CHECK_EQ(count_masked(mask), 20u);
+
+    CHECK_EQ(count_masked(dust_mask("AC", 20)), 0u);
+    CHECK_EQ(count_masked(dust_mask("", 20)), 0u);
+}
+
+static void test_ambiguous_bases_not_counted() {
+    std::fprintf(stderr, "-- test_ambiguous_bases_not_counted\n");
+
+    // A run of N forms no triplets and is never masked on its own
+    std::string seq = random_seq(100, 11) + std::string(100, 'N') + random_seq(100, 12);
+    auto mask = dust_mask(seq, 20);
+    CHECK_EQ(count_masked(mask), 0u);
+}
+
+int main() {
+    test_disabled();
+    test_random_not_masked();
+    test_homopolymer_masked();
+    test_microsatellite_masked();
+    test_short_query();
+    test_ambiguous_bases_not_counted();
+
+    TEST_SUMMARY();
+    return g_fail_count > 0 ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+#include "test_util.hpp"
+#include "search/edit_distance.hpp"
+#include "search/banded_alignment.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ikafssn;
+
+// A T G C N (match 5, mismatch -4, N vs any 1), parasail layout
+static int g_matrix[25];
+static int g_mapper[256];
+
+static SubstitutionMatrix make_matrix() {
+    for (int& m : g_mapper) m = 4;
+    g_mapper['A'] = 0; g_mapper['T'] = 1; g_mapper['G'] = 2; g_mapper['C'] = 3;
+    for (int a = 0; a < 5; a++) {
+        for (int b = 0; b < 5; b++) {
+            g_matrix[a * 5 + b] = (a == 4 || b == 4) ? 1 : (a == b ? 5 : -4);
+        }
+    }
+    SubstitutionMatrix m;
+    m.matrix = g_matrix;
+    m.mapper = g_mapper;
+    m.size = 5;
+    return m;
+}
+
+static std::string random_seq(std::mt19937& rng, size_t len) {
+    static const char bases[] = "ACGT";
+    std::string s(len, 'A');
+    for (auto& c : s) c = bases[rng() % 4];
+    return s;
+}
+
+static std::string mutate(std::mt19937& rng, const std::string& s, int edits) {
+    static const char bases[] = "ACGT";
+    std::string out = s;
+    for (int e = 0; e < edits && !out.empty(); e++) {
+        size_t p = rng() % out.size();
+        switch (rng() % 3) {
+            case 0: out[p] = bases[rng() % 4]; break;
+            case 1: out.erase(p, 1); break;
+            default: out.insert(out.begin() + p, bases[rng() % 4]); break;
+        }
+    }
+    return out;
+}
+
+// Reference DP: smallest distance of the whole query against a substring
+// of ref, and the leftmost ref end reaching it
+static int naive_distance(const std::string& q, const std::string& r,
+                          const SubstitutionMatrix& m, int& end_ref) {
+    std::vector<int> prev(q.size() + 1), cur(q.size() + 1);
+    for (size_t i = 0; i <= q.size(); i++) prev[i] = static_cast<int>(i);
+    int best = static_cast<int>(q.size()) + 1;
+    for (size_t j = 0; j < r.size(); j++) {
+        cur[0] = 0;
+        for (size_t i = 1; i <= q.size(); i++) {
+            int s = m.matrix[m.mapper[static_cast<unsigned char>(q[i - 1])] * m.size +
+                             m.mapper[static_cast<unsigned char>(r[j])]];
+            cur[i] = std::min({prev[i - 1] + (s > 0 ? 0 : 1), prev[i] + 1, cur[i - 1] + 1});
+        }
+        if (cur[q.size()] < best) {
+            best = cur[q.size()];
+            end_ref = static_cast<int>(j);
+        }
+        std::swap(prev, cur);
+    }
+    return best;
+}
+
+// The aligned strings must spell the query and ref[beg_ref, end_ref]
+// and hold exactly `distance` edits.
+static void check_path(const EditAlignment& a, const std::string& q,
+                       const std::string& r) {
+    std::string qs, rs;
+    uint32_t edits = 0;
+    for (size_t k = 0; k < a.qseq.size(); k++) {
+        if (a.qseq[k] != '-') qs += a.qseq[k];
+        if (a.sseq[k] != '-') rs += a.sseq[k];
+        if (a.qseq[k] == '-' || a.sseq[k] == '-') edits++;
+    }
+    edits += a.nnegative;
+    CHECK(qs == q);
+    CHECK(rs == r.substr(a.beg_ref, a.end_ref - a.beg_ref + 1));
+    CHECK_EQ(edits, a.distance);
+    CHECK_EQ(a.aln_len, a.qseq.size());
+}
+
+static void test_random_pairs() {
+    std::fprintf(stderr, "-- test_random_pairs\n");
+
+    auto m = make_matrix();
+    std::mt19937 rng(31);
+    for (int round = 0; round < 60; round++) {
+        // Single- and multi-block queries
+        size_t qlen = 1 + rng() % 260;
+        std::string q = random_seq(rng, qlen);
+        if (round % 4 == 0) q[rng() % qlen] = 'N';
+        std::string target = mutate(rng, q, static_cast<int>(rng() % 12));
+        std::string r = random_seq(rng, rng() % 80) + target + random_seq(rng, rng() % 80);
+        if (r.empty()) r = "A";
+
+        auto a = edit_sg_align(q.data(), static_cast<int>(qlen), r.data(),
+                               static_cast<int>(r.size()), 10, 1, m);
+        CHECK(a.ok);
+        int end_ref = -1;
+        CHECK_EQ(a.distance, static_cast<uint32_t>(naive_distance(q, r, m, end_ref)));
+        CHECK_EQ(a.end_ref, end_ref);
+        CHECK_EQ(a.end_query, static_cast<int>(qlen) - 1);
+        check_path(a, q, r);
+    }
+}
+
+static void test_exact_copy() {
+    std::fprintf(stderr, "-- test_exact_copy\n");
+
+    auto m = make_matrix();
+    std::mt19937 rng(37);
+    std::string q = random_seq(rng, 150);
+    std::string r = random_seq(rng, 40) + q + random_seq(rng, 40);
+
+    auto a = edit_sg_align(q.data(), 150, r.data(), static_cast<int>(r.size()), 10, 1, m);
+    CHECK(a.ok);
+    CHECK_EQ(a.distance, 0u);
+    CHECK_EQ(a.beg_ref, 40);
+    CHECK_EQ(a.end_ref, 189);
+    CHECK(a.cigar == "150=");
+    CHECK_EQ(a.npositive, 150u);
+    CHECK_EQ(a.score, 750);
+
+    // Same score as the full semi-global alignment
+    auto full = banded_sg_align(q.data(), 150, r.data(), static_cast<int>(r.size()),
+                                -150, static_cast<int>(r.size()), 10, 1, m);
+    CHECK_EQ(a.score, full.score);
+}
+
+static void test_gap_rescore() {
+    std::fprintf(stderr, "-- test_gap_rescore\n");
+
+    auto m = make_matrix();
+    std::mt19937 rng(41);
+    std::string q = random_seq(rng, 100);
+    // Three query bases missing from the subject
+    std::string del = q.substr(0, 50) + q.substr(53);
+    std::string r = random_seq(rng, 30) + del + random_seq(rng, 30);
+
+    auto a = edit_sg_align(q.data(), 100, r.data(), static_cast<int>(r.size()), 10, 1, m);
+    CHECK(a.ok);
+    CHECK(a.distance <= 3u);
+    check_path(a, q, r);
+    if (a.distance == 3 && a.nnegative == 0) {
+        CHECK_EQ(a.npositive, 97u);
+        CHECK_EQ(a.score, 97 * 5 - 10 - 2);
+    }
+
+    // No ref bases: nothing to align
+    auto e = edit_sg_align(q.data(), 100, r.data(), 0, 10, 1, m);
+    CHECK(!e.ok);
+}
+
+int main() {
+    test_random_pairs();
+    test_exact_copy();
+    test_gap_rescore();
+
+    TEST_SUMMARY();
+    return g_fail_count > 0 ? 1 : 0;
+}
@@ -82,6 +82,30 @@ static void test_revcomp_known() {
     CHECK_EQ(kmer_revcomp<uint16_t>(uint16_t(0xFF), 4), uint16_t(0));
 }
 
+static void test_canonical_kmer() {
+    // "AAAA" vs "TTTT": canonical is AAAA from either side
+    bool is_rc = true;
+    CHECK_EQ(kmer_canonical<uint16_t>(uint16_t(0), 4, &is_rc), uint16_t(0));
+    CHECK(!is_rc);
+    CHECK_EQ(kmer_canonical<uint16_t>(uint16_t(0xFF), 4, &is_rc), uint16_t(0));
+    CHECK(is_rc);
+
+    // Palindrome "ACGT": canonical is itself, not flagged as rc
+    CHECK_EQ(kmer_canonical<uint16_t>(uint16_t(0x1B), 4, &is_rc), uint16_t(0x1B));
+    CHECK(!is_rc);
+
+    // canonical(x) == canonical(revcomp(x)) and is never larger than either
+    for (int k = 9; k <= MAX_K; k += 7) {
+        for (uint32_t v = 0; v < 1024; v++) {
+            uint32_t kmer = v * 2654435761u & kmer_mask<uint32_t>(k);
+            uint32_t rc = kmer_revcomp<uint32_t>(kmer, k);
+            uint32_t c = kmer_canonical<uint32_t>(kmer, k);
+            CHECK_EQ(c, kmer_canonical<uint32_t>(rc, k));
+            CHECK(c <= kmer && c <= rc);
+        }
+    }
+}
+
 static void test_scanner_basic() {
     // Scan "ACGTACGT" with k=5 -> should produce 4 k-mers
     std::vector<std::pair<uint32_t, uint16_t>> results;
@@ -545,6 +569,7 @@ int main() {
     test_revcomp_involution_u16();
     test_revcomp_involution_u32();
     test_revcomp_known();
+    test_canonical_kmer();
     test_scanner_basic();
     test_scanner_with_n();
     test_scanner_k8_boundary();
@@ -3,6 +3,7 @@
 #include "index/kpx_reader.hpp"
 #include "core/config.hpp"
 #include "core/varint.hpp"
+#include "search/posting_decoder.hpp"
 
 #include <cstdio>
 #include <vector>
@@ -196,10 +197,39 @@ static void test_multiple_kmers() {
     std::remove(TEST_FILE);
 }
 
+static void test_stranded_pos_decode() {
+    // Canonical .kpx: LSB of each value is the strand bit.
+    // seq A: (pos 7, rc), (pos 7, fwd), (pos 12, rc); seq B: (pos 3, fwd)
+    std::vector<uint32_t> vals = {
+        (7u << 1) | 1u,            // raw
+        (0u << 1) | 0u,            // delta 0
+        (5u << 1) | 1u,            // delta 5
+        (3u << 1) | 0u,            // raw (new seq)
+    };
+    std::vector<uint8_t> data;
+    uint8_t buf[5];
+    for (uint32_t v : vals) {
+        size_t n = varint_encode(v, buf);
+        data.insert(data.end(), buf, buf + n);
+    }
+
+    PosDecoder dec(data.data());
+    uint8_t strand = 0;
+    CHECK_EQ(dec.next_stranded(true, &strand), 7u);
+    CHECK_EQ(strand, 1u);
+    CHECK_EQ(dec.next_stranded(false, &strand), 7u);
+    CHECK_EQ(strand, 0u);
+    CHECK_EQ(dec.next_stranded(false, &strand), 12u);
+    CHECK_EQ(strand, 1u);
+    CHECK_EQ(dec.next_stranded(true, &strand), 3u);
+    CHECK_EQ(strand, 0u);
+}
+
 int main() {
     test_single_seq();
     test_seq_boundary_reset();
     test_multiple_kmers();
+    test_stranded_pos_decode();
     TEST_SUMMARY();
     return g_fail_count > 0 ? 1 : 0;
 }
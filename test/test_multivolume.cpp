@@ -96,11 +96,13 @@ static void build_multivolume_index(int k, const std::string& db_base) {
     }
 }
 
-// Helper: search all volumes sequentially (reference implementation)
+// Helper: search all volumes sequentially (reference implementation).
+// If floors is given, floors[i] is shared by query i across volumes.
 static std::vector<OutputHit> search_sequential(
         const std::string& db_base, int k,
         const std::vector<FastaRecord>& queries,
-        const SearchConfig& config) {
+        const SearchConfig& config,
+        std::vector<ScoreFloor>* floors = nullptr) {
     char kk_str[8];
     std::snprintf(kk_str, sizeof(kk_str), "%02d", k);
 
@@ -121,16 +123,20 @@ static std::vector<OutputHit> search_sequential(
         OidFilter filter;
 
         std::vector<const KixReader*> vol_kix = {&kix};
-        for (const auto& query : queries) {
+        for (size_t qi = 0; qi < queries.size(); qi++) {
+            const auto& query = queries[qi];
+            ScoreFloor* floor = floors ? &(*floors)[qi] : nullptr;
             SearchResult sr;
             if (k < K_TYPE_THRESHOLD) {
                 auto qdata = preprocess_query<uint16_t>(query.sequence, k, vol_kix, nullptr, config);
                 sr = search_volume<uint16_t>(
-                    query.id, qdata, k, kix, kpx, ksx, filter, config);
+                    query.id, qdata, k, kix, kpx, ksx, filter, config,
+                    nullptr, nullptr, floor);
             } else {
                 auto qdata = preprocess_query<uint32_t>(query.sequence, k, vol_kix, nullptr, config);
                 sr = search_volume<uint32_t>(
-                    query.id, qdata, k, kix, kpx, ksx, filter, config);
+                    query.id, qdata, k, kix, kpx, ksx, filter, config,
+                    nullptr, nullptr, floor);
             }
 
             for (const auto& cr : sr.hits) {
@@ -371,6 +377,73 @@ static void test_result_merge_ordering() {
     }
 }
 
+static void test_score_floor_keeps_top_n() {
+    std::fprintf(stderr, "-- test_score_floor_keeps_top_n\n");
+
+    const int k = 7;
+    const std::string db_base = "mvtest";
+
+    std::vector<FastaRecord> queries = {
+        {"query_fj", g_query_fj},
+        {"query_gq", g_query_gq}
+    };
+
+    SearchConfig config;
+    config.stage1.max_freq = 100000;
+    config.stage1.min_stage1_score = 1;
+    config.stage2.max_gap = 100;
+    config.stage2.min_diag_hits = 1;
+    config.stage2.min_score = 2;
+    config.num_results = 2;
+
+    auto ref = search_sequential(db_base, k, queries, config);
+    std::vector<ScoreFloor> floors(queries.size());
+    auto pruned = search_sequential(db_base, k, queries, config, &floors);
+
+    // Volumes after the first may report fewer hits, but the merged
+    // top num_results chainscores per query must be unchanged
+    CHECK(pruned.size() <= ref.size());
+    for (const auto& q : queries) {
+        std::vector<uint32_t> a, b;
+        for (const auto& h : ref)
+            if (h.qseqid == q.id && a.size() < config.num_results) a.push_back(h.chainscore);
+        for (const auto& h : pruned)
+            if (h.qseqid == q.id && b.size() < config.num_results) b.push_back(h.chainscore);
+        CHECK(!a.empty());
+        CHECK(a == b);
+    }
+
+    // The floor rose for every query, and a volume-1 hit missing from the
+    // pruned results scored below its query's floor
+    for (size_t qi = 0; qi < queries.size(); qi++) {
+        CHECK(floors[qi].get() > 0);
+        for (const auto& h : ref) {
+            if (h.qseqid != queries[qi].id || h.volume != 1) continue;
+            bool kept = std::any_of(pruned.begin(), pruned.end(), [&](const OutputHit& p) {
+                return p.qseqid == h.qseqid && p.volume == 1 && p.sseqid == h.sseqid &&
+                       p.sstrand == h.sstrand && p.chainscore == h.chainscore;
+            });
+            if (!kept) CHECK(h.chainscore < floors[qi].get());
+        }
+    }
+
+    // query_fj's exact match lies in volume 0 and no chain can outscore it,
+    // so with num_results = 1 volume 1 keeps nothing but another exact match
+    config.num_results = 1;
+    std::vector<FastaRecord> fj = {queries[0]};
+    auto ref_fj = search_sequential(db_base, k, fj, config);
+    std::vector<ScoreFloor> fj_floor(1);
+    auto pruned_fj = search_sequential(db_base, k, fj, config, &fj_floor);
+    CHECK(!ref_fj.empty());
+    if (!ref_fj.empty()) CHECK_EQ(fj_floor[0].get(), ref_fj[0].chainscore);
+    auto in_volume_1 = [](const std::vector<OutputHit>& hits) {
+        return std::count_if(hits.begin(), hits.end(),
+                             [](const OutputHit& h) { return h.volume == 1; });
+    };
+    CHECK(in_volume_1(ref_fj) > 0);
+    CHECK(in_volume_1(pruned_fj) < in_volume_1(ref_fj));
+}
+
 static void test_parallel_counting_pass() {
     std::fprintf(stderr, "-- test_parallel_counting_pass\n");
 
@@ -525,6 +598,7 @@ int main() {
     test_multivolume_search();
     test_parallel_equals_sequential();
     test_result_merge_ordering();
+    test_score_floor_keeps_top_n();
     test_parallel_counting_pass();
     test_multivolume_k9();
 
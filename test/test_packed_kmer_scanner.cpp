@@ -873,6 +873,17 @@ static void test_get_subsequence() {
         CHECK_EQ(sub.size(), size_t(1));
         CHECK(sub[0] == full_seq[100]);
     }
+
+    // Decoding into a reused buffer
+    {
+        std::string buf;
+        CHECK(db.get_subsequence(oid, 0, seq_len - 1, buf));
+        CHECK(buf == full_seq);
+        CHECK(db.get_subsequence(oid, 50, 149, buf));
+        CHECK(buf == full_seq.substr(50, 100));
+        CHECK(!db.get_subsequence(oid, seq_len + 10, seq_len + 20, buf));
+        CHECK(buf.empty());
+    }
 }
 
 static void test_get_subsequence_with_ambig() {
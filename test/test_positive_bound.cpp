@@ -0,0 +1,92 @@
+#include "test_util.hpp"
+#include "search/positive_bound.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ikafssn;
+
+// A C G T R N: match 5, mismatch -4, R (A/G) vs A or G 2, N vs any 1
+static int g_matrix[36];
+static int g_mapper[256];
+
+static SubstitutionMatrix make_matrix() {
+    for (int& m : g_mapper) m = 5;
+    g_mapper['A'] = 0; g_mapper['C'] = 1; g_mapper['G'] = 2; g_mapper['T'] = 3;
+    g_mapper['R'] = 4;
+    const int sets[6] = {1, 2, 4, 8, 5, 15};
+    for (int a = 0; a < 6; a++) {
+        for (int b = 0; b < 6; b++) {
+            int s;
+            if (a == 5 || b == 5) s = 1;
+            else if (a == b && a < 4) s = 5;
+            else if (sets[a] & sets[b]) s = 2;
+            else s = -4;
+            g_matrix[a * 6 + b] = s;
+        }
+    }
+    SubstitutionMatrix m;
+    m.matrix = g_matrix;
+    m.mapper = g_mapper;
+    m.size = 6;
+    return m;
+}
+
+// Plain O(qlen * rlen) LCS under score > 0
+static uint32_t reference_lcs(const std::string& q, const std::string& r,
+                              const SubstitutionMatrix& m) {
+    std::vector<uint32_t> prev(r.size() + 1, 0), cur(r.size() + 1, 0);
+    for (size_t i = 0; i < q.size(); i++) {
+        for (size_t j = 0; j < r.size(); j++) {
+            int s = m.matrix[m.mapper[static_cast<unsigned char>(q[i])] * m.size +
+                             m.mapper[static_cast<unsigned char>(r[j])]];
+            cur[j + 1] = (s > 0) ? prev[j] + 1 : std::max(prev[j + 1], cur[j]);
+        }
+        std::swap(prev, cur);
+    }
+    return prev[r.size()];
+}
+
+static void test_matches_reference_lcs() {
+    std::fprintf(stderr, "-- test_matches_reference_lcs\n");
+
+    auto m = make_matrix();
+    std::mt19937 rng(29);
+    static const char alphabet[] = "ACGTACGTACGTRN";
+    for (int round = 0; round < 60; round++) {
+        // Query lengths around the 64-bit word boundaries
+        size_t qlen = 1 + rng() % 200;
+        size_t rlen = 1 + rng() % 250;
+        std::string q(qlen, 'A'), r(rlen, 'A');
+        for (auto& c : q) c = alphabet[rng() % 14];
+        for (auto& c : r) c = alphabet[rng() % 14];
+        if (round % 4 == 0 && rlen > qlen) r.replace(rng() % (rlen - qlen), qlen, q);
+
+        CHECK_EQ(max_positive_columns(q.data(), static_cast<int>(qlen),
+                                      r.data(), static_cast<int>(rlen), m),
+                 reference_lcs(q, r, m));
+    }
+}
+
+static void test_edge_cases() {
+    std::fprintf(stderr, "-- test_edge_cases\n");
+
+    auto m = make_matrix();
+    std::string q(64, 'A');
+    std::string r(64, 'A');
+    CHECK_EQ(max_positive_columns(q.data(), 64, r.data(), 64, m), 64u);
+    CHECK_EQ(max_positive_columns(q.data(), 64, r.data(), 10, m), 10u);
+    std::string t(100, 'T');
+    CHECK_EQ(max_positive_columns(q.data(), 64, t.data(), 100, m), 0u);
+    CHECK_EQ(max_positive_columns(q.data(), 0, r.data(), 64, m), 0u);
+}
+
+int main() {
+    test_matches_reference_lcs();
+    test_edge_cases();
+
+    TEST_SUMMARY();
+    return g_fail_count > 0 ? 1 : 0;
+}
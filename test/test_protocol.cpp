@@ -41,7 +41,7 @@ static void test_frame_round_trip() {
     assert(hdr.magic == FRAME_MAGIC);
     assert(hdr.payload_size == 5);
     assert(hdr.msg_type == static_cast<uint8_t>(MsgType::kSearchRequest));
-    assert(hdr.msg_version == 7);
+    assert(hdr.msg_version == 9);
     assert(hdr.reserved == 0);
     assert(recv_payload == payload);
 
@@ -83,7 +83,7 @@ static void test_frame_invalid_magic() {
     bad_hdr.magic = 0xDEADBEEF;
     bad_hdr.payload_size = 0;
     bad_hdr.msg_type = 0x01;
-    bad_hdr.msg_version = 7;
+    bad_hdr.msg_version = 9;
     bad_hdr.reserved = 0;
     assert(write_all(wfd, &bad_hdr, sizeof(bad_hdr)));
 
@@ -120,6 +120,34 @@ static void test_frame_invalid_msg_version() {
     std::printf(" OK\n");
 }
 
+static void test_frame_rejects_v8() {
+    std::printf("  test_frame_rejects_v8...");
+
+    int rfd, wfd;
+    assert(make_pipe(rfd, wfd));
+
+    // v8 frames lack the dust_level / has_dust_level / stage3_engine
+    // request fields and the masked_positions result field; accepting
+    // one would read the rest of the message from shifted offsets
+    std::vector<uint8_t> body = {0x01, 0x02, 0x03, 0x04};
+    FrameHeader old_hdr;
+    old_hdr.magic = FRAME_MAGIC;
+    old_hdr.payload_size = static_cast<uint32_t>(body.size());
+    old_hdr.msg_type = static_cast<uint8_t>(MsgType::kSearchRequest);
+    old_hdr.msg_version = 8;
+    old_hdr.reserved = 0;
+    assert(write_all(wfd, &old_hdr, sizeof(old_hdr)));
+    assert(write_all(wfd, body.data(), body.size()));
+
+    FrameHeader hdr;
+    std::vector<uint8_t> payload;
+    assert(!read_frame(rfd, hdr, payload));
+
+    ::close(rfd);
+    ::close(wfd);
+    std::printf(" OK\n");
+}
+
 static void test_search_request_serialize() {
     std::printf("  test_search_request_serialize...");
 
@@ -772,6 +800,95 @@ static void test_search_response_qlen_slen() {
     std::printf(" OK\n");
 }
 
+static void test_search_request_dust_level() {
+    std::printf("  test_search_request_dust_level...");
+
+    SearchRequest req;
+    req.k = 9;
+    req.queries.push_back({"q1", "ACGTACGT"});
+
+    // Not set by client: server default
+    auto data = serialize(req);
+    SearchRequest req2;
+    assert(deserialize(data, req2));
+    assert(req2.has_dust_level == 0);
+    assert(req2.dust_level == 0);
+
+    // Explicit 0 disables masking
+    req.has_dust_level = 1;
+    req.dust_level = 0;
+    data = serialize(req);
+    SearchRequest req3;
+    assert(deserialize(data, req3));
+    assert(req3.has_dust_level == 1);
+    assert(req3.dust_level == 0);
+
+    req.dust_level = 20;
+    data = serialize(req);
+    SearchRequest req4;
+    assert(deserialize(data, req4));
+    assert(req4.has_dust_level == 1);
+    assert(req4.dust_level == 20);
+
+    std::printf(" OK\n");
+}
+
+static void test_search_request_stage3_engine() {
+    std::printf("  test_search_request_stage3_engine...");
+
+    SearchRequest req;
+    req.k = 9;
+    req.queries.push_back({"q1", "ACGTACGT"});
+
+    // Not set by client: server default
+    auto data = serialize(req);
+    SearchRequest req2;
+    assert(deserialize(data, req2));
+    assert(req2.stage3_engine == 0);
+
+    req.stage3_engine = 2;
+    req.has_dust_level = 1;
+    req.dust_level = 20;
+    data = serialize(req);
+    SearchRequest req3;
+    assert(deserialize(data, req3));
+    assert(req3.stage3_engine == 2);
+    assert(req3.dust_level == 20);
+    assert(req3.queries.size() == 1);
+    assert(req3.queries[0].sequence == "ACGTACGT");
+
+    std::printf(" OK\n");
+}
+
+static void test_search_response_masked_positions() {
+    std::printf("  test_search_response_masked_positions...");
+
+    SearchResponse resp;
+    resp.k = 9;
+
+    QueryResult qr;
+    qr.qseqid = "q1";
+    qr.warnings = kWarnMultiDegen | kWarnLowComplexity;
+    qr.masked_positions = 123;
+    resp.results.push_back(qr);
+
+    QueryResult qr2;
+    qr2.qseqid = "q2";
+    resp.results.push_back(qr2);
+
+    auto data = serialize(resp);
+    SearchResponse resp2;
+    assert(deserialize(data, resp2));
+
+    assert(resp2.results.size() == 2);
+    assert(resp2.results[0].warnings == (kWarnMultiDegen | kWarnLowComplexity));
+    assert(resp2.results[0].masked_positions == 123);
+    assert(resp2.results[1].warnings == 0);
+    assert(resp2.results[1].masked_positions == 0);
+
+    std::printf(" OK\n");
+}
+
 int main() {
     std::printf("test_protocol:\n");
 
@@ -780,6 +897,7 @@ int main() {
     test_frame_empty_payload();
     test_frame_invalid_magic();
     test_frame_invalid_msg_version();
+    test_frame_rejects_v8();
     test_search_request_serialize();
     test_search_request_defaults();
     test_search_response_serialize();
@@ -799,6 +917,9 @@ int main() {
     test_search_response_qlen_slen();
     test_search_request_chain_max_lookback();
     test_search_request_max_nhit_per_subject();
+    test_search_request_dust_level();
+    test_search_request_stage3_engine();
+    test_search_response_masked_positions();
 
     std::printf("All protocol tests passed.\n");
     return 0;
@@ -16,6 +16,7 @@
 #include "util/logger.hpp"
 
 #include <cstdio>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
@@ -459,6 +460,52 @@ static void test_search_num_results_zero() {
     ksx.close();
 }
 
+static void test_ikafssnsearch_mode2_without_kpx() {
+    std::fprintf(stderr, "-- test_ikafssnsearch_mode2_without_kpx\n");
+
+    // Index built with -mode 1 (no .kpx): Stage 2 rescans the BLAST DB
+    std::string ix_dir = g_test_dir + "/nokpx";
+    std::filesystem::create_directories(ix_dir);
+    std::string db_base = "nokpx";
+    std::string vol_basename = std::filesystem::path(g_testdb_path).filename().string();
+    std::string prefix = ix_dir + "/" + vol_basename + ".07mer";
+    {
+        BlastDbReader db;
+        CHECK(db.open(g_testdb_path));
+        Logger logger(Logger::kError);
+        IndexBuilderConfig config;
+        config.k = 7;
+        config.skip_kpx = true;
+        CHECK(build_index<uint16_t>(db, config, prefix, 0, 1, db_base, logger));
+    }
+    CHECK(!std::filesystem::exists(prefix + ".kpx"));
+    {
+        std::ofstream kvx(ix_dir + "/" + db_base + ".07mer.kvx");
+        kvx << "#\n# ikafssn index volume manifest\n#\n";
+        kvx << "TITLE " << db_base << "\n";
+        kvx << "DBLIST \"" << vol_basename << "\"\n";
+    }
+    std::string query_path = ix_dir + "/query.fasta";
+    {
+        std::ofstream q(query_path);
+        q << ">query1\n" << g_query_seq << "\n";
+    }
+
+    std::string out_path = ix_dir + "/out.tsv";
+    std::string cmd = std::string(SOURCE_DIR) + "/build/src/ikafssnsearch" +
+                      " -ix " + ix_dir + "/" + db_base +
+                      " -db " + g_testdb_path +
+                      " -query " + query_path +
+                      " -mode 2 -o " + out_path + " 2>/dev/null";
+    int ret = std::system(cmd.c_str());
+    CHECK(WIFEXITED(ret) && WEXITSTATUS(ret) == 0);
+
+    std::ifstream in(out_path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    CHECK(ss.str().find(ACC_FJ) != std::string::npos);
+}
+
 int main() {
     check_ssu_available();
 
@@ -488,6 +535,7 @@ int main() {
     test_search_k9();
     test_search_mode1();
     test_search_num_results_zero();
+    test_ikafssnsearch_mode2_without_kpx();
 
     std::filesystem::remove_all(g_test_dir);
 
@@ -12,9 +12,11 @@
 #include "index/khx_reader.hpp"
 #include "io/blastdb_reader.hpp"
 #include "core/kmer_encoding.hpp"
+#include "core/spaced_seed.hpp"
 #include "core/config.hpp"
 #include "util/logger.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <filesystem>
 #include <string>
@@ -226,6 +228,192 @@ static void test_stage1_coverscore_vs_matchscore() {
     kix.close();
 }
 
+static void test_stage1_prefetch_distance() {
+    std::fprintf(stderr, "-- test_stage1_prefetch_distance\n");
+
+    KixReader kix;
+    CHECK(kix.open(g_index_dir + "/test.00.07mer.kix"));
+
+    std::vector<uint32_t> positions;
+    std::vector<uint16_t> kmer_values;
+    KmerScanner<uint16_t> scanner(7);
+    scanner.scan(g_query_seq.data(), g_query_seq.size(), [&](uint32_t pos, uint16_t kmer) {
+        positions.push_back(pos);
+        kmer_values.push_back(kmer);
+    });
+
+    OidFilter filter;
+    Stage1Config config;
+    config.max_freq = 100000;
+    config.min_stage1_score = 1;
+
+    // Prefetch is a hint only: results must not depend on the distance
+    config.prefetch_distance = 0;
+    auto base = stage1_filter(positions.data(), kmer_values.data(), positions.size(), kix, filter, config);
+    CHECK(!base.empty());
+    auto by_id = [](const Stage1Candidate& a, const Stage1Candidate& b) { return a.id < b.id; };
+    std::sort(base.begin(), base.end(), by_id);
+
+    for (uint32_t d : {1u, 2u, 16u, 1000u}) {
+        config.prefetch_distance = d;
+        auto cands = stage1_filter(positions.data(), kmer_values.data(), positions.size(), kix, filter, config);
+        std::sort(cands.begin(), cands.end(), by_id);
+        CHECK_EQ(cands.size(), base.size());
+        for (size_t i = 0; i < cands.size() && i < base.size(); i++) {
+            CHECK_EQ(cands[i].id, base[i].id);
+            CHECK_EQ(cands[i].score, base[i].score);
+        }
+    }
+
+    kix.close();
+}
+
+static void test_stage1_locality_order() {
+    std::fprintf(stderr, "-- test_stage1_locality_order\n");
+
+    KixReader kix;
+    CHECK(kix.open(g_index_dir + "/test.00.07mer.kix"));
+    std::vector<const KixReader*> all_kix = {&kix};
+
+    SearchConfig config;
+    config.stage1.max_freq = 100000;
+    config.stage1.min_stage1_score = 1;
+    auto qdata = preprocess_query<uint16_t>(g_query_seq, 7, all_kix, nullptr, config);
+
+    // Query contains no degenerate bases: all k-mers are sorted by value
+    for (size_t i = 1; i < qdata.fwd_kmer_values.size(); i++) {
+        CHECK(qdata.fwd_kmer_values[i - 1] <= qdata.fwd_kmer_values[i]);
+    }
+
+    // Same candidates and scores as query-position order traversal
+    std::vector<uint32_t> positions;
+    std::vector<uint16_t> kmer_values;
+    KmerScanner<uint16_t> scanner(7);
+    scanner.scan(g_query_seq.data(), g_query_seq.size(), [&](uint32_t pos, uint16_t kmer) {
+        positions.push_back(pos);
+        kmer_values.push_back(kmer);
+    });
+    CHECK_EQ(qdata.fwd_positions.size(), positions.size());
+
+    OidFilter filter;
+    auto by_id = [](const Stage1Candidate& a, const Stage1Candidate& b) { return a.id < b.id; };
+    auto in_order = stage1_filter(positions.data(), kmer_values.data(), positions.size(),
+                                  kix, filter, config.stage1);
+    auto sorted = stage1_filter(qdata.fwd_positions.data(), qdata.fwd_kmer_values.data(),
+                                qdata.fwd_positions.size(), kix, filter, config.stage1);
+    std::sort(in_order.begin(), in_order.end(), by_id);
+    std::sort(sorted.begin(), sorted.end(), by_id);
+    CHECK_EQ(sorted.size(), in_order.size());
+    for (size_t i = 0; i < sorted.size() && i < in_order.size(); i++) {
+        CHECK_EQ(sorted[i].id, in_order[i].id);
+        CHECK_EQ(sorted[i].score, in_order[i].score);
+    }
+
+    kix.close();
+}
+
+static void test_rare_first_selection() {
+    std::fprintf(stderr, "-- test_rare_first_selection\n");
+
+    KixReader kix;
+    CHECK(kix.open(g_index_dir + "/test.00.07mer.kix"));
+    std::vector<const KixReader*> all_kix = {&kix};
+
+    SearchConfig config;
+    config.stage1.max_freq = 100000;
+    config.min_stage1_score_frac = 0.5;
+    auto qdata_all = preprocess_query<uint16_t>(g_query_seq, 7, all_kix, nullptr, config);
+    CHECK_EQ(qdata_all.num_dropped_kmers, 0u);
+
+    // Coverage target: half of the query positions, rarest k-mers first
+    config.stage1_target_coverage = 0.5;
+    auto qdata_cov = preprocess_query<uint16_t>(g_query_seq, 7, all_kix, nullptr, config);
+    CHECK(qdata_cov.num_dropped_kmers > 0);
+    CHECK(qdata_cov.fwd_positions.size() < qdata_all.fwd_positions.size());
+    CHECK(qdata_cov.fwd_positions.size() >= qdata_all.fwd_positions.size() / 2);
+    CHECK(qdata_cov.resolved_threshold_fwd < qdata_all.resolved_threshold_fwd);
+
+    // Every kept k-mer is at most as frequent as every dropped one
+    std::unordered_set<uint16_t> kept(qdata_cov.fwd_kmer_values.begin(),
+                                      qdata_cov.fwd_kmer_values.end());
+    uint32_t max_kept = 0, min_dropped = UINT32_MAX;
+    for (uint16_t kmer : qdata_all.fwd_kmer_values) {
+        uint32_t c = kix.count_postings(kmer);
+        if (kept.count(kmer)) max_kept = std::max(max_kept, c);
+        else min_dropped = std::min(min_dropped, c);
+    }
+    CHECK(max_kept <= min_dropped);
+
+    // Posting budget: total decoded postings stay within the budget
+    config.stage1_target_coverage = 0;
+    config.stage1_max_postings = 200;
+    auto qdata_budget = preprocess_query<uint16_t>(g_query_seq, 7, all_kix, nullptr, config);
+    uint64_t cost = 0;
+    for (uint16_t kmer : qdata_budget.fwd_kmer_values) cost += kix.count_postings(kmer);
+    CHECK(cost <= 200);
+
+    // and no dropped k-mer would still have fit in what is left of it
+    std::unordered_set<uint16_t> kept_budget(qdata_budget.fwd_kmer_values.begin(),
+                                             qdata_budget.fwd_kmer_values.end());
+    for (uint16_t kmer : qdata_all.fwd_kmer_values) {
+        if (kept_budget.count(kmer)) continue;
+        uint64_t occurrences = std::count(qdata_all.fwd_kmer_values.begin(),
+                                          qdata_all.fwd_kmer_values.end(), kmer);
+        CHECK(cost + kix.count_postings(kmer) * occurrences > 200);
+    }
+
+    kix.close();
+}
+
+static void test_tier_holds_query_positions() {
+    std::fprintf(stderr, "-- test_tier_holds_query_positions\n");
+
+    // A few k-mers kept from a long query (rare-first selection, DUST):
+    // positions equal mod 256 must not share a T8 last_pos
+    QueryKmerData<uint16_t> q;
+    q.fwd_positions = {3, 259, 515};
+    q.fwd_kmer_values = {7, 7, 7};
+    q.rc_positions = {1200};
+    q.rc_kmer_values = {9};
+    CHECK_EQ(max_query_position(q), 1200u);
+    uint32_t count = static_cast<uint32_t>(
+        std::max(q.fwd_positions.size(), q.rc_positions.size()));
+    CHECK(select_tier(count, count) == Stage1Tier::T8);
+    CHECK(select_tier(count, max_query_position(q)) == Stage1Tier::T16);
+
+    QueryKmerData<uint16_t> empty;
+    CHECK_EQ(max_query_position(empty), 0u);
+}
+
+static void test_dust_query_masking() {
+    std::fprintf(stderr, "-- test_dust_query_masking\n");
+
+    KixReader kix;
+    CHECK(kix.open(g_index_dir + "/test.00.07mer.kix"));
+    std::vector<const KixReader*> all_kix = {&kix};
+
+    // Query with a poly-A tail
+    const uint32_t tail_start = static_cast<uint32_t>(g_query_seq.size());
+    std::string query = g_query_seq + std::string(60, 'A');
+
+    SearchConfig config;
+    config.stage1.max_freq = Stage1Config::MAX_FREQ_DISABLED;
+    auto qdata_plain = preprocess_query<uint16_t>(query, 7, all_kix, nullptr, config);
+    CHECK_EQ(qdata_plain.num_masked_positions, 0u);
+
+    config.dust_level = 20;
+    auto qdata = preprocess_query<uint16_t>(query, 7, all_kix, nullptr, config);
+    CHECK(qdata.num_masked_positions >= 60u);
+    CHECK(qdata.fwd_positions.size() < qdata_plain.fwd_positions.size());
+    CHECK_EQ(qdata.fwd_positions.size(), qdata.rc_positions.size());
+
+    // No surviving k-mer reaches into the masked tail
+    for (uint32_t pos : qdata.fwd_positions) CHECK(pos + 7 <= tail_start);
+    for (uint32_t pos : qdata.rc_positions) CHECK(pos + 7 <= tail_start);
+
+    kix.close();
+}
+
 static void test_stage1_topn_zero() {
     std::fprintf(stderr, "-- test_stage1_topn_zero\n");
 
@@ -265,6 +453,69 @@ static void test_stage1_topn_zero() {
     kix.close();
 }
 
+static void test_stage1_multi_template_sum() {
+    std::fprintf(stderr, "-- test_stage1_multi_template_sum\n");
+
+    KixReader kix;
+    CHECK(kix.open(g_index_dir + "/test.00.07mer.kix"));
+
+    std::vector<uint32_t> positions;
+    std::vector<uint16_t> kmer_values;
+    KmerScanner<uint16_t> scanner(7);
+    scanner.scan(g_query_seq.data(), g_query_seq.size(), [&](uint32_t pos, uint16_t kmer) {
+        positions.push_back(pos);
+        kmer_values.push_back(kmer);
+    });
+    size_t half = positions.size() / 2;
+
+    OidFilter filter;
+    Stage1Config config;
+    config.max_freq = 100000;
+    config.min_stage1_score = 1;
+
+    // Template 0: whole query; template 1: its second half at the same
+    // query positions, so equal positions of both templates must both count
+    auto whole = stage1_filter(positions.data(), kmer_values.data(), positions.size(),
+                               kix, filter, config);
+    auto tail = stage1_filter(positions.data() + half, kmer_values.data() + half,
+                              positions.size() - half, kix, filter, config);
+    std::vector<uint32_t> expected(kix.num_sequences(), 0);
+    for (const auto& c : whole) expected[c.id] += c.score;
+    for (const auto& c : tail) expected[c.id] += c.score;
+
+    const Stage1Template<uint16_t> templates[2] = {
+        {positions.data(), kmer_values.data(), positions.size(), &kix},
+        {positions.data() + half, kmer_values.data() + half, positions.size() - half, &kix},
+    };
+
+    // A T8 buffer is too narrow only if the summed score can overflow it
+    Stage1Buffer buf;
+    buf.tier = Stage1Tier::T8;
+    for (int pass = 0; pass < 2; pass++) {
+        auto multi = stage1_filter_multi(templates, 2, filter, config,
+                                         pass == 0 ? &buf : nullptr);
+        CHECK_EQ(multi.size(), whole.size());
+        for (const auto& c : multi) CHECK_EQ(c.score, expected[c.id]);
+    }
+    CHECK(buf.dirty.empty());
+
+    // Few k-mers at positions 256 apart: without a buffer, the local one
+    // must still hold the positions (T32 stage1_filter() as reference)
+    const uint32_t far_pos[2] = {positions[0], positions[0] + 256};
+    const uint16_t far_kmer[2] = {kmer_values[0], kmer_values[0]};
+    auto far_ref = stage1_filter(far_pos, far_kmer, 2, kix, filter, config);
+    const Stage1Template<uint16_t> far_template = {far_pos, far_kmer, 2, &kix};
+    auto far_multi = stage1_filter_multi(&far_template, 1, filter, config, nullptr);
+    CHECK(!far_ref.empty());
+    CHECK_EQ(far_multi.size(), far_ref.size());
+    for (size_t i = 0; i < far_ref.size() && i < far_multi.size(); i++) {
+        CHECK_EQ(far_multi[i].id, far_ref[i].id);
+        CHECK_EQ(far_multi[i].score, far_ref[i].score);
+    }
+
+    kix.close();
+}
+
 static std::string g_maxfreq_index_dir;
 
 static bool build_maxfreq_index() {
@@ -391,6 +642,29 @@ static void test_stage1_fractional_with_highfreq() {
     // at least as many results as without khx
     CHECK(result_with_khx.hits.size() >= result_without_khx.hits.size());
 
+    // Windows resolve ceil(Nqkmer * P) - Nhighfreq over their own positions,
+    // counting the excluded k-mers that qdata_with no longer holds
+    config.query_window = 40;
+    config.query_window_overlap = 20;
+    auto windows = split_query_windows<uint16_t>(
+        qdata_with, static_cast<uint32_t>(g_query_seq.size()), config);
+    CHECK_EQ(windows.size(), static_cast<size_t>(3));
+    const uint32_t ranges[3][2] = {{0, 60}, {20, 100}, {60, 100}};
+    auto distinct_in = [](const std::vector<uint32_t>& positions, uint32_t b, uint32_t e) {
+        std::unordered_set<uint32_t> s;
+        for (uint32_t p : positions) if (p >= b && p < e) s.insert(p);
+        return static_cast<int32_t>(s.size());
+    };
+    for (size_t i = 0; i < windows.size() && i < 3; i++) {
+        uint32_t b = ranges[i][0], e = ranges[i][1];
+        CHECK_EQ(windows[i].offset, b);
+        int32_t nqkmer = distinct_in(qdata_without.fwd_positions, b, e);
+        int32_t nhighfreq = nqkmer - distinct_in(qdata_with.fwd_positions, b, e);
+        int32_t expected = static_cast<int32_t>(std::ceil(nqkmer * 0.3)) - nhighfreq;
+        CHECK_EQ(windows[i].qdata.resolved_threshold_fwd,
+                 static_cast<uint32_t>(std::max(expected, 0)));
+    }
+
     khx.close();
     kix.close();
     kpx.close();
@@ -440,6 +714,223 @@ static void test_adaptive_min_score() {
     kix.close();
 }
 
+static void test_stage2_parallel_matches_serial() {
+    std::fprintf(stderr, "-- test_stage2_parallel_matches_serial\n");
+
+    KixReader kix;
+    KpxReader kpx;
+    KsxReader ksx;
+    CHECK(kix.open(g_index_dir + "/test.00.07mer.kix"));
+    CHECK(kpx.open(g_index_dir + "/test.00.07mer.kpx"));
+    CHECK(ksx.open(g_index_dir + "/test.00.07mer.ksx"));
+
+    OidFilter filter;
+    SearchConfig config;
+    config.stage1.max_freq = 100000;
+    config.stage1.min_stage1_score = 1;
+    config.stage2.min_score = 1;
+    config.stage2.max_nhit_per_subject = 0;
+
+    std::vector<const KixReader*> all_kix = {&kix};
+    auto qdata = preprocess_query<uint16_t>(g_query_seq, 7, all_kix, nullptr, config);
+
+    // Serial chaining
+    config.stage2_parallel_min_candidates = 0;
+    config.stage2_parallel_min_hits = 0;
+    Stage1Buffer buf;
+    auto serial = search_volume<uint16_t>(
+        "test_query", qdata, 7, kix, kpx, ksx, filter, config, &buf);
+
+    // Nested-task chaining for any candidate set of two or more
+    config.stage2_parallel_min_candidates = 2;
+    auto parallel = search_volume<uint16_t>(
+        "test_query", qdata, 7, kix, kpx, ksx, filter, config, &buf);
+
+    CHECK(serial.hits.size() > 1);
+    CHECK_EQ(parallel.hits.size(), serial.hits.size());
+    for (size_t i = 0; i < serial.hits.size() && i < parallel.hits.size(); i++) {
+        CHECK_EQ(parallel.hits[i].seq_id, serial.hits[i].seq_id);
+        CHECK_EQ(parallel.hits[i].chainscore, serial.hits[i].chainscore);
+        CHECK_EQ(parallel.hits[i].q_start, serial.hits[i].q_start);
+        CHECK_EQ(parallel.hits[i].s_start, serial.hits[i].s_start);
+        CHECK_EQ(parallel.hits[i].is_reverse, serial.hits[i].is_reverse);
+    }
+
+    kix.close();
+    kpx.close();
+    ksx.close();
+}
+
+static void test_hit_arena_retention_cap() {
+    std::fprintf(stderr, "-- test_hit_arena_retention_cap\n");
+
+    KixReader kix;
+    KpxReader kpx;
+    KsxReader ksx;
+    CHECK(kix.open(g_index_dir + "/test.00.07mer.kix"));
+    CHECK(kpx.open(g_index_dir + "/test.00.07mer.kpx"));
+    CHECK(ksx.open(g_index_dir + "/test.00.07mer.ksx"));
+
+    OidFilter filter;
+    SearchConfig config;
+    config.stage1.max_freq = 100000;
+    config.stage1.min_stage1_score = 1;
+    config.stage2.min_score = 1;
+
+    std::vector<const KixReader*> all_kix = {&kix};
+    auto qdata = preprocess_query<uint16_t>(g_query_seq, 7, all_kix, nullptr, config);
+
+    // The hit arena is kept across searches while within the cap
+    Stage1Buffer buf;
+    auto kept = search_volume<uint16_t>(
+        "test_query", qdata, 7, kix, kpx, ksx, filter, config, &buf);
+    CHECK(buf.hit_arena.capacity() > 0);
+
+    // and freed after a search that grew it past the cap, with equal results
+    buf.max_retained_hits = 0;
+    auto freed = search_volume<uint16_t>(
+        "test_query", qdata, 7, kix, kpx, ksx, filter, config, &buf);
+    CHECK_EQ(buf.hit_arena.capacity(), static_cast<size_t>(0));
+    CHECK_EQ(freed.hits.size(), kept.hits.size());
+
+    kix.close();
+    kpx.close();
+    ksx.close();
+}
+
+static void test_fused_stage12_matches_two_pass() {
+    std::fprintf(stderr, "-- test_fused_stage12_matches_two_pass\n");
+
+    KixReader kix;
+    KpxReader kpx;
+    KsxReader ksx;
+    CHECK(kix.open(g_index_dir + "/test.00.07mer.kix"));
+    CHECK(kpx.open(g_index_dir + "/test.00.07mer.kpx"));
+    CHECK(ksx.open(g_index_dir + "/test.00.07mer.ksx"));
+
+    OidFilter filter;
+    SearchConfig config;
+    config.stage1.max_freq = 100000;
+    config.stage1.min_stage1_score = 1;
+    config.stage2.min_score = 1;
+
+    std::vector<const KixReader*> all_kix = {&kix};
+    auto qdata = preprocess_query<uint16_t>(g_query_seq, 7, all_kix, nullptr, config);
+
+    // Stage 1 candidates are identical; postings are buffered in decode order
+    Stage1Buffer buf;
+    auto cands = stage1_filter(qdata.fwd_positions.data(), qdata.fwd_kmer_values.data(),
+                               qdata.fwd_positions.size(), kix, filter, config.stage1, &buf);
+    auto fused_cands = stage1_filter_fused(
+        qdata.fwd_positions.data(), qdata.fwd_kmer_values.data(),
+        qdata.fwd_positions.size(), kix, kpx, filter, config.stage1, buf);
+    CHECK(!cands.empty());
+    CHECK_EQ(fused_cands.size(), cands.size());
+    for (size_t i = 0; i < cands.size() && i < fused_cands.size(); i++) {
+        CHECK_EQ(fused_cands[i].id, cands[i].id);
+        CHECK_EQ(fused_cands[i].score, cands[i].score);
+    }
+    CHECK(buf.postings.size() >= cands.size());
+
+    // Search results are identical with and without the fused pass
+    config.stage12_fused_max_bytes = 0;
+    auto two_pass = search_volume<uint16_t>(
+        "test_query", qdata, 7, kix, kpx, ksx, filter, config, &buf);
+    config.stage12_fused_max_bytes = UINT64_MAX;
+    auto fused = search_volume<uint16_t>(
+        "test_query", qdata, 7, kix, kpx, ksx, filter, config, &buf);
+
+    CHECK(!two_pass.hits.empty());
+    CHECK_EQ(fused.hits.size(), two_pass.hits.size());
+    for (size_t i = 0; i < two_pass.hits.size() && i < fused.hits.size(); i++) {
+        CHECK_EQ(fused.hits[i].seq_id, two_pass.hits[i].seq_id);
+        CHECK_EQ(fused.hits[i].chainscore, two_pass.hits[i].chainscore);
+        CHECK_EQ(fused.hits[i].stage1_score, two_pass.hits[i].stage1_score);
+        CHECK_EQ(fused.hits[i].q_start, two_pass.hits[i].q_start);
+        CHECK_EQ(fused.hits[i].s_start, two_pass.hits[i].s_start);
+        CHECK_EQ(fused.hits[i].is_reverse, two_pass.hits[i].is_reverse);
+    }
+
+    kix.close();
+    kpx.close();
+    ksx.close();
+}
+
+static void test_query_windows_match_whole_query() {
+    std::fprintf(stderr, "-- test_query_windows_match_whole_query\n");
+
+    KixReader kix;
+    KpxReader kpx;
+    KsxReader ksx;
+    CHECK(kix.open(g_index_dir + "/test.00.07mer.kix"));
+    CHECK(kpx.open(g_index_dir + "/test.00.07mer.kpx"));
+    CHECK(ksx.open(g_index_dir + "/test.00.07mer.ksx"));
+
+    OidFilter filter;
+    SearchConfig config;
+    config.stage1.max_freq = 100000;
+    config.stage1.min_stage1_score = 1;
+    config.stage2.min_score = 2;
+
+    std::vector<const KixReader*> all_kix = {&kix};
+    auto qdata = preprocess_query<uint16_t>(g_query_seq, 7, all_kix, nullptr, config);
+    auto whole = search_volume<uint16_t>(
+        "test_query", qdata, 7, kix, kpx, ksx, filter, config);
+
+    // 100bp query: cores [0,40) [40,80) [80,100), each extended by 20
+    config.query_window = 40;
+    config.query_window_overlap = 20;
+    auto windows = split_query_windows<uint16_t>(
+        qdata, static_cast<uint32_t>(g_query_seq.size()), config);
+    CHECK_EQ(windows.size(), static_cast<size_t>(3));
+    uint32_t next_core = 0;
+    for (const auto& w : windows) {
+        CHECK_EQ(w.offset + w.core_begin, next_core);
+        next_core = w.offset + w.core_end;
+        for (uint32_t p : w.qdata.fwd_positions) {
+            CHECK(p < w.core_end + config.query_window_overlap);
+        }
+    }
+    CHECK_EQ(next_core, static_cast<uint32_t>(g_query_seq.size()));
+
+    Stage1Buffer buf;
+    std::vector<SearchResult> parts;
+    for (const auto& w : windows) {
+        parts.push_back(search_volume_window<uint16_t>(
+            "test_query", w, 7, kix, kpx, ksx, filter, config, &buf));
+    }
+    auto merged = merge_window_results<uint16_t>(
+        "test_query", windows, parts, 7, config);
+
+    // The exact-match chain is stitched back from its three parts
+    const ChainResult* expected = nullptr;
+    const ChainResult* stitched = nullptr;
+    for (const auto& cr : whole.hits) {
+        if (cr.seq_id == g_fj_oid && !cr.is_reverse) expected = &cr;
+    }
+    for (const auto& cr : merged.hits) {
+        if (cr.seq_id == g_fj_oid && !cr.is_reverse) stitched = &cr;
+    }
+    CHECK(expected != nullptr);
+    CHECK(stitched != nullptr);
+    if (expected && stitched) {
+        CHECK_EQ(stitched->chainscore, expected->chainscore);
+        CHECK_EQ(stitched->q_start, expected->q_start);
+        CHECK_EQ(stitched->q_end, expected->q_end);
+        CHECK_EQ(stitched->s_start, expected->s_start);
+        CHECK_EQ(stitched->s_end, expected->s_end);
+    }
+
+    // Windowing is off for queries that fit in one window
+    config.query_window = 100;
+    CHECK(split_query_windows<uint16_t>(
+        qdata, static_cast<uint32_t>(g_query_seq.size()), config).empty());
+
+    kix.close();
+    kpx.close();
+    ksx.close();
+}
+
 static void test_global_highfreq_across_volumes() {
     std::fprintf(stderr, "-- test_global_highfreq_across_volumes\n");
 
@@ -468,6 +959,160 @@ static void test_global_highfreq_across_volumes() {
     kix.close();
 }
 
+static void test_query_windows_keep_crossing_parts() {
+    std::fprintf(stderr, "-- test_query_windows_keep_crossing_parts\n");
+
+    std::string fj;
+    {
+        BlastDbReader db;
+        CHECK(db.open(g_testdb_path));
+        fj = db.get_sequence(g_fj_oid);
+    }
+    CHECK(fj.size() >= 240);
+    if (fj.size() < 240) return;
+
+    KixReader kix;
+    KpxReader kpx;
+    KsxReader ksx;
+    CHECK(kix.open(g_index_dir + "/test.00.07mer.kix"));
+    CHECK(kpx.open(g_index_dir + "/test.00.07mer.kpx"));
+    CHECK(ksx.open(g_index_dir + "/test.00.07mer.ksx"));
+
+    OidFilter filter;
+    SearchConfig config;
+    config.stage1.max_freq = 100000;
+    config.stage1.min_stage1_score = 1;
+    config.stage2.min_score = 2;
+    config.stage2.max_gap = 20;
+    config.stage2.max_nhit_per_subject = 1;
+
+    // Query A + B on two diagonals of FJ: A = FJ[100, 160) lies in window
+    // 0's core, B = FJ[100, 240) crosses into window 1. In window 0 B's part
+    // scores below A, but stitched B is the best chain of the whole query.
+    std::string query = fj.substr(100, 60) + fj.substr(100, 140);
+    std::vector<const KixReader*> all_kix = {&kix};
+    auto qdata = preprocess_query<uint16_t>(query, 7, all_kix, nullptr, config);
+    auto whole = search_volume<uint16_t>(
+        "test_query", qdata, 7, kix, kpx, ksx, filter, config);
+
+    config.query_window = 100;
+    config.query_window_overlap = 20;
+    auto windows = split_query_windows<uint16_t>(
+        qdata, static_cast<uint32_t>(query.size()), config);
+    CHECK_EQ(windows.size(), static_cast<size_t>(2));
+    std::vector<SearchResult> parts;
+    for (const auto& w : windows) {
+        parts.push_back(search_volume_window<uint16_t>(
+            "test_query", w, 7, kix, kpx, ksx, filter, config));
+    }
+    auto merged = merge_window_results<uint16_t>(
+        "test_query", windows, parts, 7, config);
+
+    const ChainResult* expected = nullptr;
+    const ChainResult* stitched = nullptr;
+    for (const auto& cr : whole.hits) {
+        if (cr.seq_id == g_fj_oid && !cr.is_reverse) expected = &cr;
+    }
+    for (const auto& cr : merged.hits) {
+        if (cr.seq_id == g_fj_oid && !cr.is_reverse) stitched = &cr;
+    }
+    CHECK(expected != nullptr);
+    CHECK(stitched != nullptr);
+    if (expected && stitched) {
+        CHECK_EQ(expected->q_start, 60u);
+        CHECK_EQ(stitched->chainscore, expected->chainscore);
+        CHECK_EQ(stitched->q_start, expected->q_start);
+        CHECK_EQ(stitched->q_end, expected->q_end);
+        CHECK_EQ(stitched->s_start, expected->s_start);
+    }
+
+    kix.close();
+    kpx.close();
+    ksx.close();
+}
+
+static void test_canonical_matches_regular_index() {
+    std::fprintf(stderr, "-- test_canonical_matches_regular_index\n");
+
+    BlastDbReader db;
+    CHECK(db.open(g_testdb_path));
+    Logger logger(Logger::kError);
+    IndexBuilderConfig bconfig;
+    bconfig.k = 7;
+    bconfig.canonical = true;
+    std::string prefix = g_index_dir + "/test_can.00.07mer";
+    CHECK(build_index<uint16_t>(db, bconfig, prefix, 0, 1, "test", logger));
+
+    KixReader kix, can_kix;
+    KpxReader kpx, can_kpx;
+    KsxReader ksx, can_ksx;
+    CHECK(kix.open(g_index_dir + "/test.00.07mer.kix"));
+    CHECK(kpx.open(g_index_dir + "/test.00.07mer.kpx"));
+    CHECK(ksx.open(g_index_dir + "/test.00.07mer.ksx"));
+    CHECK(can_kix.open(prefix + ".kix"));
+    CHECK(can_kpx.open(prefix + ".kpx"));
+    CHECK(can_ksx.open(prefix + ".ksx"));
+
+    auto by_position = [](const ChainResult& a, const ChainResult& b) {
+        if (a.seq_id != b.seq_id) return a.seq_id < b.seq_id;
+        if (a.is_reverse != b.is_reverse) return a.is_reverse < b.is_reverse;
+        if (a.q_start != b.q_start) return a.q_start < b.q_start;
+        return a.s_start < b.s_start;
+    };
+
+    // Both strands of the subject hit: the query and its reverse complement
+    OidFilter filter;
+    std::vector<const KixReader*> all_kix = {&kix};
+    std::vector<const KixReader*> all_can_kix = {&can_kix};
+    for (const std::string& query : {g_query_seq, reverse_complement_string(g_query_seq)}) {
+        for (uint8_t score_type : {uint8_t(1), uint8_t(2)}) {
+            SearchConfig config;
+            config.stage1.max_freq = 100000;
+            config.stage1.min_stage1_score = 1;
+            config.stage1.stage1_score_type = score_type;
+            config.stage2.min_score = 1;
+            config.strand = 2;
+
+            auto qdata = preprocess_query<uint16_t>(query, 7, all_kix, nullptr, config);
+            auto can_qdata = preprocess_query<uint16_t>(query, 7, all_can_kix, nullptr, config);
+            CHECK(can_qdata.canonical);
+            auto regular = search_volume<uint16_t>(
+                "test_query", qdata, 7, kix, kpx, ksx, filter, config);
+            auto canonical = search_volume<uint16_t>(
+                "test_query", can_qdata, 7, can_kix, can_kpx, can_ksx, filter, config);
+
+            std::sort(regular.hits.begin(), regular.hits.end(), by_position);
+            std::sort(canonical.hits.begin(), canonical.hits.end(), by_position);
+            bool fwd = false, rev = false;
+            for (const auto& cr : regular.hits) {
+                if (cr.seq_id != g_fj_oid) continue;
+                (cr.is_reverse ? rev : fwd) = true;
+            }
+            CHECK(query == g_query_seq ? fwd : rev);
+            CHECK_EQ(canonical.hits.size(), regular.hits.size());
+            for (size_t i = 0; i < regular.hits.size() && i < canonical.hits.size(); i++) {
+                const auto& a = regular.hits[i];
+                const auto& b = canonical.hits[i];
+                CHECK_EQ(b.seq_id, a.seq_id);
+                CHECK_EQ(b.is_reverse, a.is_reverse);
+                CHECK_EQ(b.q_start, a.q_start);
+                CHECK_EQ(b.q_end, a.q_end);
+                CHECK_EQ(b.s_start, a.s_start);
+                CHECK_EQ(b.s_end, a.s_end);
+                CHECK_EQ(b.chainscore, a.chainscore);
+                CHECK_EQ(b.stage1_score, a.stage1_score);
+            }
+        }
+    }
+
+    kix.close();
+    kpx.close();
+    ksx.close();
+    can_kix.close();
+    can_kpx.close();
+    can_ksx.close();
+}
+
 int main() {
     check_ssu_available();
 
@@ -495,10 +1140,22 @@ int main() {
     test_stage1_min_score();
     test_stage1_with_oid_filter();
     test_stage1_coverscore_vs_matchscore();
+    test_stage1_prefetch_distance();
+    test_stage1_locality_order();
+    test_rare_first_selection();
+    test_tier_holds_query_positions();
+    test_dust_query_masking();
     test_stage1_topn_zero();
+    test_stage1_multi_template_sum();
     test_stage1_fractional_threshold();
     test_stage1_fractional_with_highfreq();
     test_adaptive_min_score();
+    test_stage2_parallel_matches_serial();
+    test_hit_arena_retention_cap();
+    test_fused_stage12_matches_two_pass();
+    test_query_windows_match_whole_query();
+    test_query_windows_keep_crossing_parts();
+    test_canonical_matches_regular_index();
     test_global_highfreq_across_volumes();
 
     std::filesystem::remove_all(g_index_dir);
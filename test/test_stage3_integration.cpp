@@ -112,6 +112,7 @@ static void test_stage3_pipeline() {
     s3config.gapext = 1;
     s3config.fetch_threads = 1;
 
+    std::vector<OutputHit> stage2_hits = all_hits;
     auto filtered = run_stage3(all_hits, queries, g_testdb_path, s3config,
                                false, 0.0, 0, logger);
 
@@ -142,6 +143,104 @@ static void test_stage3_pipeline() {
         }
     }
     CHECK(found_high_ppositive);
+
+    // With a positive filter, the traceback prefilter keeps the same hits
+    {
+        Stage3Config filter_config = s3config;
+        filter_config.min_npositive = 90;
+        std::vector<OutputHit> hits = stage2_hits;
+        auto with_prefilter = run_stage3(hits, queries, g_testdb_path, filter_config,
+                                         false, 0.0, 0, logger);
+        hits = stage2_hits;
+        filter_config.prefilter = false;
+        auto without = run_stage3(hits, queries, g_testdb_path, filter_config,
+                                  false, 0.0, 0, logger);
+        CHECK(!without.empty());
+        CHECK_EQ(with_prefilter.size(), without.size());
+        for (size_t i = 0; i < without.size() && i < with_prefilter.size(); i++) {
+            CHECK(with_prefilter[i].sseqid == without[i].sseqid);
+            CHECK_EQ(with_prefilter[i].npositive, without[i].npositive);
+            CHECK(with_prefilter[i].cigar == without[i].cigar);
+        }
+    }
+
+    // Hits of two queries on the same subject regions: each region is
+    // decoded once, and both align as when fetched separately
+    {
+        std::vector<FastaRecord> two = queries;
+        two.push_back({"query2", g_query_seq});
+        std::vector<OutputHit> hits = stage2_hits;
+        for (const auto& h : stage2_hits) {
+            hits.push_back(h);
+            hits.back().qseqid = "query2";
+        }
+        auto both = run_stage3(hits, two, g_testdb_path, s3config,
+                               false, 0.0, 0, logger);
+        CHECK_EQ(both.size(), 2 * filtered.size());
+        for (const auto& b : both) {
+            bool same = false;
+            for (const auto& h : filtered) {
+                if (h.sseqid != b.sseqid || h.sstrand != b.sstrand || h.sstart != b.sstart) continue;
+                CHECK_EQ(b.alnscore, h.alnscore);
+                CHECK(b.cigar == h.cigar);
+                same = true;
+            }
+            CHECK(same);
+        }
+    }
+
+    // Edit-distance engine: the whole query is aligned, and the exact
+    // FJ876973.1 match scores as by parasail
+    {
+        Stage3Config edit_config = s3config;
+        edit_config.engine = "edit";
+        std::vector<OutputHit> hits = stage2_hits;
+        auto edited = run_stage3(hits, queries, g_testdb_path, edit_config,
+                                 false, 0.0, 0, logger);
+        CHECK_EQ(edited.size(), filtered.size());
+        bool found_edit = false;
+        for (const auto& e : edited) {
+            CHECK_EQ(e.qstart, 0u);
+            CHECK_EQ(e.qend, g_query_seq.size() - 1);
+            CHECK(!e.cigar.empty());
+            if (e.sseqid != ACC_FJ || e.sstrand != '+') continue;
+            for (const auto& h : filtered) {
+                if (h.sseqid != ACC_FJ || h.sstrand != '+') continue;
+                CHECK_EQ(e.alnscore, h.alnscore);
+                CHECK_EQ(e.npositive, h.npositive);
+                found_edit = true;
+            }
+        }
+        CHECK(found_edit);
+    }
+
+    // Anchored alignment through the Stage 2 k-mers: the exact FJ876973.1
+    // match aligns as by the full DP
+    config.stage2.keep_anchors = true;
+    auto anchored_result = search_volume<uint16_t>(
+        "query1", qdata, 7, kix, kpx, ksx, filter, config);
+    CHECK_EQ(anchored_result.hits.size(), stage2_hits.size());
+    for (size_t i = 0; i < stage2_hits.size() && i < anchored_result.hits.size(); i++) {
+        CHECK(!anchored_result.hits[i].anchors.empty());
+        stage2_hits[i].anchors = anchored_result.hits[i].anchors;
+    }
+    Stage3Config anchored_config = s3config;
+    anchored_config.anchored = true;
+    anchored_config.anchor_span = 7;
+    auto anchored = run_stage3(stage2_hits, queries, g_testdb_path, anchored_config,
+                               false, 0.0, 0, logger);
+    bool found_anchored = false;
+    for (const auto& a : anchored) {
+        if (a.sseqid != ACC_FJ || a.sstrand != '+') continue;
+        for (const auto& h : filtered) {
+            if (h.sseqid != ACC_FJ || h.sstrand != '+') continue;
+            CHECK_EQ(a.alnscore, h.alnscore);
+            CHECK_EQ(a.npositive, h.npositive);
+            CHECK(a.cigar == h.cigar);
+            found_anchored = true;
+        }
+    }
+    CHECK(found_anchored);
 }
 
 static void test_stage3_score_only() {
@@ -214,6 +313,7 @@ static void test_stage3_score_only() {
     s3config.traceback = false;
     s3config.fetch_threads = 1;
 
+    std::vector<OutputHit> stage2_hits = all_hits;
     auto filtered = run_stage3(all_hits, queries, g_testdb_path, s3config,
                                false, 0.0, 0, logger);
     CHECK(!filtered.empty());
@@ -225,6 +325,90 @@ static void test_stage3_score_only() {
         // ppositive should be 0 (not computed without traceback)
         CHECK(h.ppositive == 0.0);
     }
+
+    // With wide context, the banded alignment (default) agrees with the
+    // full alignment
+    {
+        std::vector<OutputHit> hits = stage2_hits;
+        auto banded = run_stage3(hits, queries, g_testdb_path, s3config,
+                                 false, 0.0, 500, logger);
+        hits = stage2_hits;
+        Stage3Config full_config = s3config;
+        full_config.banded = false;
+        auto full = run_stage3(hits, queries, g_testdb_path, full_config,
+                               false, 0.0, 500, logger);
+        CHECK(!full.empty());
+        CHECK_EQ(banded.size(), full.size());
+        for (size_t i = 0; i < full.size() && i < banded.size(); i++) {
+            CHECK_EQ(banded[i].alnscore, full[i].alnscore);
+            CHECK_EQ(banded[i].qend, full[i].qend);
+            CHECK_EQ(banded[i].send, full[i].send);
+        }
+    }
+
+    // Many queries on one subject region: the batched score-only
+    // alignment agrees with aligning each hit alone, with and without
+    // the band
+    for (bool banded : {false, true}) {
+        std::vector<FastaRecord> many;
+        std::vector<OutputHit> many_hits;
+        for (int q = 0; q < 10; q++) {
+            std::string id = "query" + std::to_string(q + 1);
+            many.push_back({id, query});
+            for (OutputHit h : stage2_hits) {
+                h.qseqid = id;
+                many_hits.push_back(h);
+            }
+        }
+        Stage3Config dp_config = s3config;
+        dp_config.ungapped = false;
+        dp_config.banded = banded;
+        std::vector<OutputHit> hits = many_hits;
+        auto batched = run_stage3(hits, many, g_testdb_path, dp_config,
+                                  false, 0.0, 500, logger);
+        hits = many_hits;
+        Stage3Config single_config = dp_config;
+        single_config.batch_min_hits = 0;
+        auto single = run_stage3(hits, many, g_testdb_path, single_config,
+                                 false, 0.0, 500, logger);
+        CHECK(!single.empty());
+        CHECK_EQ(batched.size(), single.size());
+        for (size_t i = 0; i < single.size() && i < batched.size(); i++) {
+            CHECK(batched[i].qseqid == single[i].qseqid);
+            CHECK_EQ(batched[i].alnscore, single[i].alnscore);
+            CHECK_EQ(batched[i].qend, single[i].qend);
+            CHECK_EQ(batched[i].send, single[i].send);
+        }
+    }
+
+    // A reader pool is opened once and reused across calls (as by the server)
+    BlastDbReaderPool pool(g_testdb_path);
+    for (int round = 0; round < 2; round++) {
+        std::vector<OutputHit> hits = stage2_hits;
+        auto pooled = run_stage3(hits, queries, pool, s3config,
+                                 false, 0.0, 0, logger);
+        CHECK(pool.num_volumes() > 0);
+        CHECK_EQ(pooled.size(), filtered.size());
+        for (size_t i = 0; i < pooled.size() && i < filtered.size(); i++) {
+            CHECK(pooled[i].sseqid == filtered[i].sseqid);
+            CHECK_EQ(pooled[i].alnscore, filtered[i].alnscore);
+            CHECK_EQ(pooled[i].send, filtered[i].send);
+        }
+    }
+
+    // Private reader handles: at most max_handles per volume, reused
+    // once released
+    {
+        auto h1 = pool.acquire(0, 1);
+        CHECK(h1 != nullptr);
+        CHECK(pool.acquire(0, 1) == nullptr);
+        const BlastDbReader* p1 = h1.get();
+        pool.release(0, std::move(h1));
+        auto h2 = pool.acquire(0, 1);
+        CHECK(h2.get() == p1);
+        if (h2) CHECK_EQ(h2->num_sequences(), pool.volume(0).num_sequences());
+        pool.release(0, std::move(h2));
+    }
 }
 
 static void test_stage3_context() {
@@ -308,6 +492,42 @@ static void test_stage3_context() {
         CHECK(h.alnscore > 0);
         CHECK(!h.cigar.empty());
     }
+
+    // Two overlapping chains per subject for each of two identical
+    // queries: every group is clamped on its own, to the same result,
+    // and no surviving hits of one group overlap
+    {
+        std::vector<FastaRecord> two = {{"query1", query}, {"query2", query}};
+        std::vector<OutputHit> pairs;
+        for (const char* id : {"query1", "query2"}) {
+            for (OutputHit h : all_hits) {
+                h.qseqid = id;
+                pairs.push_back(h);
+                h.sstart += 20;
+                h.send += 20;
+                h.chainscore = (h.chainscore > 0) ? h.chainscore - 1 : 0;
+                pairs.push_back(h);
+            }
+        }
+        auto resolved = run_stage3(pairs, two, g_testdb_path, s3config,
+                                   false, 0.0, 50, logger);
+        CHECK(!resolved.empty());
+        std::vector<const OutputHit*> q1, q2;
+        for (const auto& h : resolved) (h.qseqid == "query1" ? q1 : q2).push_back(&h);
+        CHECK_EQ(q1.size(), q2.size());
+        for (size_t i = 0; i < q1.size() && i < q2.size(); i++) {
+            CHECK(q1[i]->sseqid == q2[i]->sseqid);
+            CHECK_EQ(q1[i]->sstart, q2[i]->sstart);
+            CHECK_EQ(q1[i]->send, q2[i]->send);
+            CHECK_EQ(q1[i]->alnscore, q2[i]->alnscore);
+        }
+        for (const auto* a : q1) {
+            for (const auto* b : q1) {
+                if (a == b || a->sseqid != b->sseqid || a->sstrand != b->sstrand) continue;
+                CHECK(a->send < b->sstart || b->send < a->sstart);
+            }
+        }
+    }
 }
 
 int main() {
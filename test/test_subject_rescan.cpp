@@ -0,0 +1,176 @@
+#include "test_util.hpp"
+#include "search/subject_rescan.hpp"
+#include "index/kix_writer.hpp"
+#include "index/kix_reader.hpp"
+#include "core/config.hpp"
+#include "core/kmer_encoding.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ikafssn;
+
+static const char* TEST_KIX = "/tmp/test_ikafssn_rescan.kix";
+
+static int base_code(char c) {
+    switch (c) {
+    case 'A': return 0;
+    case 'C': return 1;
+    case 'G': return 2;
+    case 'T': return 3;
+    default: return -1;
+    }
+}
+
+// IUPAC character -> ncbi4na bitmask (A=1, C=2, G=4, T=8)
+static uint8_t iupac_ncbi4na(char c) {
+    switch (c) {
+    case 'A': return 1;  case 'C': return 2;  case 'G': return 4;  case 'T': return 8;
+    case 'M': return 3;  case 'R': return 5;  case 'S': return 6;  case 'V': return 7;
+    case 'W': return 9;  case 'Y': return 10; case 'H': return 11; case 'K': return 12;
+    case 'D': return 13; case 'B': return 14; default: return 15;
+    }
+}
+
+// Pack an IUPAC string as a BLAST DB subject: ncbi2na with A placeholders
+// at degenerate bases, plus one ambiguity run per degenerate base.
+static PackedSubject pack_subject(const std::string& seq) {
+    PackedSubject s;
+    s.length = static_cast<uint32_t>(seq.size());
+    s.ncbi2na.assign((seq.size() + 3) / 4, 0);
+    for (size_t i = 0; i < seq.size(); i++) {
+        int c = base_code(seq[i]);
+        if (c < 0) {
+            s.ambig.push_back({static_cast<uint32_t>(i), 1, iupac_ncbi4na(seq[i])});
+            c = 0;
+        }
+        s.ncbi2na[i >> 2] = static_cast<char>(
+            static_cast<uint8_t>(s.ncbi2na[i >> 2]) | (c << (6 - 2 * (i & 3))));
+    }
+    return s;
+}
+
+// All k-mers of window [p, p + k) with their degenerate expansions,
+// following the index builder's expansion limit.
+static std::vector<uint32_t> window_kmers(const std::string& seq, size_t p, int k,
+                                          int max_expand) {
+    std::vector<uint32_t> out = {0};
+    int product = 1;
+    bool degen = false;
+    for (int j = 0; j < k; j++) {
+        uint8_t m = iupac_ncbi4na(seq[p + j]);
+        int n = __builtin_popcount(m);
+        if (n > 1) degen = true;
+        product *= n;
+        std::vector<uint32_t> next;
+        for (uint32_t v : out) {
+            for (uint32_t b = 0; b < 4; b++) {
+                if (m & (1u << b)) next.push_back((v << 2) | b);
+            }
+        }
+        out.swap(next);
+    }
+    if (degen && (max_expand <= 1 || product > max_expand)) out.clear();
+    return out;
+}
+
+static bool hit_less(const Hit& a, const Hit& b) {
+    return a.q_pos < b.q_pos || (a.q_pos == b.q_pos && a.s_pos < b.s_pos);
+}
+
+static void test_rescan_matches_reference() {
+    std::fprintf(stderr, "-- test_rescan_matches_reference\n");
+    const int k = 6;
+    const int max_expand = 4;
+    const uint32_t ts = table_size(k);
+    std::mt19937 rng(7);
+    const char* acgt = "ACGT";
+    const char* iupac = "RYSWKMBDHVN";
+
+    std::string query(120, 'A');
+    for (auto& c : query) c = acgt[rng() % 4];
+    std::vector<std::string> subjects;
+    for (int i = 0; i < 20; i++) {
+        std::string s(200 + rng() % 300, 'A');
+        for (auto& c : s) c = acgt[rng() % 4];
+        // Plant query fragments and degenerate bases
+        size_t a = rng() % 60;
+        s.replace(rng() % (s.size() - 60), 50, query.substr(a, 50));
+        for (int j = 0; j < 6; j++) s[rng() % s.size()] = iupac[rng() % 11];
+        subjects.push_back(s);
+    }
+
+    // Query k-mers at their positions (ACGT only)
+    std::vector<uint32_t> positions, kmers;
+    for (size_t p = 0; p + k <= query.size(); p++) {
+        positions.push_back(static_cast<uint32_t>(p));
+        kmers.push_back(window_kmers(query, p, k, 1)[0]);
+    }
+
+    // .kix with every other query k-mer indexed; the rest have no postings
+    std::vector<uint8_t> indexed(ts, 0);
+    {
+        KixWriter writer(k, 0);
+        writer.set_num_sequences(1);
+        writer.set_flags(KIX_FLAG_HAS_KSX);
+        for (size_t i = 0; i < kmers.size(); i += 2) indexed[kmers[i]] = 1;
+        std::vector<uint32_t> one = {0}, none;
+        for (uint32_t v = 0; v < ts; v++) writer.add_posting_list(v, indexed[v] ? one : none);
+        CHECK(writer.write(TEST_KIX));
+    }
+    KixReader kix;
+    CHECK(kix.open(TEST_KIX));
+
+    std::vector<uint16_t> kmers16(kmers.begin(), kmers.end());
+    QueryKmerTable<uint16_t> table;
+    table.build(positions.data(), kmers16.data(), kmers16.size(), kix);
+    CHECK(!table.empty());
+
+    for (const auto& s : subjects) {
+        std::vector<Hit> ref;
+        for (size_t p = 0; p + k <= s.size(); p++) {
+            for (uint32_t v : window_kmers(s, p, k, max_expand)) {
+                if (!indexed[v]) continue;
+                for (size_t qi = 0; qi < kmers.size(); qi++) {
+                    if (kmers[qi] == v) ref.push_back({positions[qi], static_cast<uint32_t>(p)});
+                }
+            }
+        }
+
+        std::vector<Hit> hits;
+        rescan_subject_hits(table, pack_subject(s), k, max_expand, hits);
+        std::sort(ref.begin(), ref.end(), hit_less);
+        std::sort(hits.begin(), hits.end(), hit_less);
+        CHECK_EQ(hits.size(), ref.size());
+        bool same = hits.size() == ref.size();
+        for (size_t i = 0; same && i < hits.size(); i++) {
+            same = hits[i].q_pos == ref[i].q_pos && hits[i].s_pos == ref[i].s_pos;
+        }
+        CHECK(same);
+    }
+    std::remove(TEST_KIX);
+}
+
+static void test_rescan_short_and_empty() {
+    std::fprintf(stderr, "-- test_rescan_short_and_empty\n");
+    QueryKmerTable<uint16_t> table;
+    std::vector<Hit> hits;
+    rescan_subject_hits(table, pack_subject("ACGTACGTACGT"), 6, 4, hits);
+    CHECK(hits.empty());
+
+    const uint32_t* b;
+    const uint32_t* e;
+    table.find(0, &b, &e);
+    CHECK(b == e);
+}
+
+int main() {
+    test_rescan_matches_reference();
+    test_rescan_short_and_empty();
+
+    TEST_SUMMARY();
+    return g_fail_count > 0 ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+#include "test_util.hpp"
+#include "search/ungapped_alignment.hpp"
+#include "search/banded_alignment.hpp"
+
+#include <random>
+#include <string>
+
+using namespace ikafssn;
+
+// A T G C N (match 5, mismatch -4, N vs any 1), parasail layout
+static int g_matrix[25];
+static int g_mapper[256];
+
+static SubstitutionMatrix make_matrix() {
+    for (int& m : g_mapper) m = 4;
+    g_mapper['A'] = 0; g_mapper['T'] = 1; g_mapper['G'] = 2; g_mapper['C'] = 3;
+    for (int a = 0; a < 5; a++) {
+        for (int b = 0; b < 5; b++) {
+            g_matrix[a * 5 + b] = (a == 4 || b == 4) ? 1 : (a == b ? 5 : -4);
+        }
+    }
+    SubstitutionMatrix m;
+    m.matrix = g_matrix;
+    m.mapper = g_mapper;
+    m.size = 5;
+    return m;
+}
+
+static std::string random_seq(std::mt19937& rng, size_t len) {
+    static const char bases[] = "ACGT";
+    std::string s(len, 'A');
+    for (auto& c : s) c = bases[rng() % 4];
+    return s;
+}
+
+static char other_base(std::mt19937& rng, char c) {
+    static const char bases[] = "ACGT";
+    char o;
+    do { o = bases[rng() % 4]; } while (o == c);
+    return o;
+}
+
+// Column-by-column score and CIGAR of query on ref[diag, diag + qlen)
+static int column_score(const std::string& q, const std::string& r, int diag,
+                        const SubstitutionMatrix& m, std::string& cigar) {
+    int score = 0;
+    std::string cols;
+    for (size_t i = 0; i < q.size(); i++) {
+        int s = m.matrix[m.mapper[static_cast<unsigned char>(q[i])] * m.size +
+                         m.mapper[static_cast<unsigned char>(r[diag + i])]];
+        score += s;
+        cols += (s > 0) ? '=' : 'X';
+    }
+    cigar.clear();
+    for (size_t c = 0; c < cols.size(); ) {
+        size_t e = c;
+        while (e < cols.size() && cols[e] == cols[c]) e++;
+        cigar += std::to_string(e - c);
+        cigar += cols[c];
+        c = e;
+    }
+    return score;
+}
+
+static void test_scattered_substitutions() {
+    std::fprintf(stderr, "-- test_scattered_substitutions\n");
+
+    auto m = make_matrix();
+    std::mt19937 rng(21);
+    for (int round = 0; round < 30; round++) {
+        size_t qlen = 40 + rng() % 300;
+        std::string q = random_seq(rng, qlen);
+        std::string copy = q;
+        // One substitution per 48 columns, away from the query ends
+        for (size_t p = 40; p + 40 < qlen; p += 48) copy[p] = other_base(rng, copy[p]);
+        if (round % 3 == 0) q[qlen / 2] = 'N';
+        std::string r = random_seq(rng, 100) + copy + random_seq(rng, 100);
+
+        auto u = ungapped_align(q.data(), static_cast<int>(qlen), r.data(),
+                                static_cast<int>(r.size()), 100, 10, m, true);
+        CHECK(u.ok);
+        std::string cigar;
+        CHECK_EQ(u.score, column_score(q, r, 100, m, cigar));
+        CHECK(u.cigar == cigar);
+        CHECK_EQ(u.npositive + u.nnegative, qlen);
+
+        // Same score as the full semi-global alignment
+        auto full = banded_sg_align(q.data(), static_cast<int>(qlen), r.data(),
+                                    static_cast<int>(r.size()), -static_cast<int>(qlen),
+                                    static_cast<int>(r.size()), 10, 1, m);
+        CHECK_EQ(u.score, full.score);
+
+        // Score only: same numbers, no CIGAR
+        auto s = ungapped_align(q.data(), static_cast<int>(qlen), r.data(),
+                                static_cast<int>(r.size()), 100, 10, m, false);
+        CHECK(s.ok);
+        CHECK_EQ(s.score, u.score);
+        CHECK_EQ(s.npositive, u.npositive);
+        CHECK(s.cigar.empty());
+    }
+}
+
+static void test_indel_falls_back() {
+    std::fprintf(stderr, "-- test_indel_falls_back\n");
+
+    auto m = make_matrix();
+    std::mt19937 rng(23);
+    std::string q = random_seq(rng, 200);
+
+    // Deletion in the middle: the rest of the diagonal is off by one
+    std::string del = q.substr(0, 100) + q.substr(101);
+    std::string r = random_seq(rng, 50) + del + random_seq(rng, 50);
+    auto u = ungapped_align(q.data(), 200, r.data(), static_cast<int>(r.size()),
+                            50, 10, m, true);
+    CHECK(!u.ok);
+
+    // Two mismatches in the last 16 columns: one gap could pay off
+    std::string end = q;
+    end[190] = other_base(rng, end[190]);
+    end[195] = other_base(rng, end[195]);
+    r = random_seq(rng, 50) + end + random_seq(rng, 50);
+    u = ungapped_align(q.data(), 200, r.data(), static_cast<int>(r.size()),
+                       50, 10, m, true);
+    CHECK(!u.ok);
+
+    // The same two mismatches inside the query stay on the diagonal
+    std::string mid = q;
+    mid[90] = other_base(rng, mid[90]);
+    mid[95] = other_base(rng, mid[95]);
+    r = random_seq(rng, 50) + mid + random_seq(rng, 50);
+    u = ungapped_align(q.data(), 200, r.data(), static_cast<int>(r.size()),
+                       50, 10, m, true);
+    CHECK(u.ok);
+    CHECK_EQ(u.nnegative, 2u);
+
+    // The diagonal must hold the whole query
+    u = ungapped_align(q.data(), 200, r.data(), static_cast<int>(r.size()),
+                       101, 10, m, true);
+    CHECK(!u.ok);
+    u = ungapped_align(q.data(), 200, r.data(), static_cast<int>(r.size()),
+                       -1, 10, m, true);
+    CHECK(!u.ok);
+}
+
+int main() {
+    test_scattered_substitutions();
+    test_indel_falls_back();
+
+    TEST_SUMMARY();
+    return g_fail_count > 0 ? 1 : 0;
+}